@@ -0,0 +1,892 @@
+#include "txtgfx.h"
+#include "kernels.h"
+#include "surface.h"
+#include "compose.h"
+#include "sprite.h"
+#include "tilemap.h"
+#include "poly.h"
+#include "circle.h"
+#include "displist.h"
+#include "flood.h"
+#include "rotozoom.h"
+#include "scale.h"
+#include "mode7.h"
+#include "font.h"
+#include "layout.h"
+#include "textout.h"
+#include "charset.h"
+#include "hires.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#include <x86intrin.h>
+	#define HAVE_RDTSC
+#endif
+
+/**
+ * Frame loop benchmark. Runs a few typical scenes for a fixed number of
+ * frames and prints the time and the number of cells written per frame.
+ * Then times full-screen presents with each block packing kernel.
+ *
+ * Builds for DOS like example.c, or natively against the emulated video
+ * device; see README.md.
+ */
+
+#define FRAMES 2000
+
+typedef struct BenchCase {
+	const char* name;
+	void (*setup)(void);
+	void (*frame)(int n);
+} BenchCase;
+
+static void setupTiles(void) {
+	int i, j;
+	for (i = 0; i < 10; i++) {
+		for (j = 0; j < 16; j++) {
+			fillRectToBlockBuffer(j * 5, i * 5, 5, 5, (j + i) % 16);
+		}
+	}
+}
+
+static void setupText(void) {
+	setupTiles();
+	printLargeStringToBuffer(4, 4, "SCROLLING...", 10);
+}
+
+static void frameStatic(int n) {
+	(void)n;
+	drawScreenFromBlockBuffer();
+}
+
+static void frameSprite(int n) {
+	int x = n % (COLS - 8);
+	fillRectToBlockBuffer(x, 20, 8, 8, 0);
+	fillRectToBlockBuffer(x + 1, 20, 8, 8, 15);
+	drawScreenFromBlockBuffer();
+}
+
+static void frameShapes(int n) {
+	clrBlockColorBuffer(0);
+	strokeRectToBlockBuffer(n % 40, 10, 20, 20, 3);
+	fillCircleToBlockBuffer(40, 25, 10 + n % 10, 4);
+	triangleToBlockBuffer(5, 45, 40, n % 50, 75, 45, 5);
+	drawScreenFromBlockBuffer();
+}
+
+static void frameScroll(int n) {
+	(void)n;
+	shiftBlockBuffer(-1, 0);
+	drawScreenFromBlockBuffer();
+}
+
+static void frameParallax(int n) {
+	static int amounts[ROWS * 2];
+	int j;
+	(void)n;
+	for (j = 0; j < ROWS * 2; j++) {
+		amounts[j] = -(1 + j / 10);
+	}
+	shiftBlockBufferRows(amounts);
+	drawScreenFromBlockBuffer();
+}
+
+static void frameWave(int n) {
+	static int offsets[ROWS * 2];
+	int j;
+	for (j = 0; j < ROWS * 2; j++) {
+		offsets[j] = (int)(4 * sin((n + j) * 0.2));
+	}
+	setBlockRowOffsets(offsets);
+	drawScreenFromBlockBuffer();
+}
+
+static void setupTorus(void) {
+	setupText();
+	setToroidalBlockBuffer(true);
+}
+
+static void frameRotate(int n) {
+	setupText();
+	rotateBlockBuffer(n * 0.01);
+	drawScreenFromBlockBuffer();
+}
+
+/**
+ * The same frame drawn into blockColorBuffer (one byte per block) and into
+ * a packed surface (two blocks per byte): fills, a line, a scroll by one
+ * column and one text row, and a present. Scrolling a packed surface by an
+ * odd number of blocks vertically needs an extra pass over every byte.
+ */
+static char packedCells[ROWS][COLS];
+static PackedSurface packed;
+
+static void frameBytes(int n) {
+	clrBlockColorBuffer(1);
+	fillRectToBlockBuffer(n % 60, 10, 20, 21, 4);
+	fillRectToBlockBuffer(10, n % 30, 40, 15, 6);
+	lineToBlockBuffer(0, 0, COLS - 1, n % (ROWS * 2), 15);
+	shiftBlockBuffer(1, 2);
+	drawScreenFromBlockBuffer();
+}
+
+static void setupPacked(void) {
+	initPackedSurface(&packed, COLS, ROWS * 2, &packedCells[0][0]);
+}
+
+static void framePacked(int n) {
+	clrPackedSurface(&packed, 1);
+	fillRectToPackedSurface(&packed, n % 60, 10, 20, 21, 4);
+	fillRectToPackedSurface(&packed, 10, n % 30, 40, 15, 6);
+	lineToPackedSurface(&packed, 0, 0, COLS - 1, n % (ROWS * 2), 15);
+	shiftPackedSurface(&packed, 1, 2);
+	drawScreenFromPackedSurface(&packed);
+}
+
+/**
+ * Four layers: an opaque playfield, a parallax layer and a moving sprite
+ * with color key 0, and a static HUD. "tplayers" stacks them through
+ * blockColorBuffer and drawTpBlocksToBuffer, "compose" with a Compositor.
+ */
+static char layerPixels[4][ROWS * 2][COLS];
+static BlockSurface layerSurfaces[4];
+static Compositor compositor;
+
+static void setupLayers(void) {
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		initBlockSurface(&layerSurfaces[i], COLS, ROWS * 2, &layerPixels[i][0][0]);
+		clrSurface(&layerSurfaces[i], 0);
+	}
+	layerSurfaces[2].width = 12;
+	layerSurfaces[2].height = 12;
+	layerSurfaces[3].height = 8;
+
+	for (i = 0; i < 16; i++) {
+		fillRectToSurface(&layerSurfaces[0], i * 5, 0, 5, ROWS * 2, i == 0 ? 8 : i);
+		fillRectToSurface(&layerSurfaces[1], i * 10, 30 + i % 3 * 5, 4, 20, 7);
+	}
+	fillRectToSurface(&layerSurfaces[2], 2, 2, 8, 8, 14);
+	strokeRectToSurface(&layerSurfaces[3], 0, 0, COLS - 1, 7, 15);
+
+	initPackedSurface(&packed, COLS, ROWS * 2, &packedCells[0][0]);
+	initCompositor(&compositor, &packed, 0);
+	addLayer(&compositor, &layerSurfaces[0], 0, 0, NO_COLOR_KEY);
+	addLayer(&compositor, &layerSurfaces[1], 0, 0, 0);
+	addLayer(&compositor, &layerSurfaces[2], 0, 20, 0);
+	addLayer(&compositor, &layerSurfaces[3], 0, 0, 0);
+}
+
+static void frameTpLayers(int n) {
+	int i;
+
+	memcpy(blockColorBuffer, layerPixels[0], sizeof(blockColorBuffer));
+	drawBlocksToBuffer();
+	for (i = 1; i < 4; i++) {
+		clrBlockColorBuffer(0);
+		drawSurfaceToBlockBuffer(&layerSurfaces[i], i == 2 ? n % COLS : 0, i == 2 ? 20 : 0);
+		drawTpBlocksToBuffer(0);
+	}
+	drawScreenFromBuffer();
+}
+
+static void frameCompose(int n) {
+	moveLayer(&compositor, 2, n % COLS, 20);
+	compositeLayers(&compositor);
+	drawScreenFromPackedSurface(&packed);
+}
+
+/**
+ * SPRITES 12x12 balls per frame over a restored background, drawn with
+ * blitSurfaceTp ("tpblit") and as compiled sprites in one batch ("sprites").
+ */
+#define SPRITES 64
+
+static char ballPixels[12][12];
+static BlockSurface ball;
+static Sprite* ballSprite;
+static SpriteDraw spriteDraws[SPRITES];
+static char background[ROWS * 2][COLS];
+
+static void setupSprites(void) {
+	int i;
+
+	initBlockSurface(&ball, 12, 12, &ballPixels[0][0]);
+	clrSurface(&ball, 0);
+	fillRectToSurface(&ball, 3, 0, 6, 12, 12);
+	fillRectToSurface(&ball, 0, 3, 12, 6, 12);
+	fillRectToSurface(&ball, 1, 1, 10, 10, 4);
+	fillRectToSurface(&ball, 3, 3, 3, 3, 15);
+	if (ballSprite == NULL) {
+		ballSprite = compileSprite(&ball, 0);
+	}
+
+	setupTiles();
+	memcpy(background, blockColorBuffer, sizeof(background));
+	for (i = 0; i < SPRITES; i++) {
+		spriteDraws[i].sprite = ballSprite;
+		spriteDraws[i].flags = i & 1 ? SPRITE_FLIP_H : 0;
+	}
+}
+
+static void moveSprites(int n) {
+	int i;
+
+	memcpy(blockColorBuffer, background, sizeof(background));
+	markBlockBufferDirty(0, 0, COLS, ROWS * 2);
+	for (i = 0; i < SPRITES; i++) {
+		spriteDraws[i].x = (i * 37 + n) % (COLS + 12) - 12;
+		spriteDraws[i].y = (i * 13 + n / 2) % (ROWS * 2 + 12) - 12;
+	}
+}
+
+static void frameTpBlit(int n) {
+	int i;
+
+	moveSprites(n);
+	for (i = 0; i < SPRITES; i++) {
+		blitSurfaceTp(&screenBlockSurface, spriteDraws[i].x, spriteDraws[i].y, &ball, 0);
+	}
+	drawScreenFromBlockBuffer();
+}
+
+static void frameSprites(int n) {
+	moveSprites(n);
+	drawSprites(&screenBlockSurface, spriteDraws, SPRITES);
+	drawScreenFromBlockBuffer();
+}
+
+/**
+ * A camera panning diagonally over a 512x512 map of 8x5 tiles, with the
+ * map in memory ("tilemap") and streamed from a file ("tilefile").
+ */
+#define MAP_SIZE 512
+
+static char tilePixels[16][5][8];
+static uint16_t mapTiles[MAP_SIZE * MAP_SIZE];
+static TileSet tileSet;
+static TileMap residentMap, fileMap;
+static TileView tileView;
+
+static void setupTileSet(void) {
+	int i, j, k;
+
+	for (i = 0; i < 16; i++) {
+		for (j = 0; j < 5; j++) {
+			for (k = 0; k < 8; k++) {
+				tilePixels[i][j][k] = (j == 0 || k == 0) ? 0 : i;
+			}
+		}
+	}
+	for (i = 0; i < MAP_SIZE * MAP_SIZE; i++) {
+		mapTiles[i] = (i * 7 + i / MAP_SIZE) % 16;
+	}
+	initTileSet(&tileSet, 8, 5, 16, &tilePixels[0][0][0]);
+	initTileMap(&residentMap, MAP_SIZE, MAP_SIZE, mapTiles);
+}
+
+static void setupTileMap(void) {
+	setupTileSet();
+	freeTileView(&tileView);
+	initTileView(&tileView, &tileSet, &residentMap, COLS, ROWS * 2);
+}
+
+static void setupTileFile(void) {
+	setupTileSet();
+	closeTileMap(&fileMap);
+	saveTileMap(&residentMap, "BENCH.MAP");
+	openTileMap(&fileMap, "BENCH.MAP");
+	freeTileView(&tileView);
+	initTileView(&tileView, &tileSet, &fileMap, COLS, ROWS * 2);
+}
+
+static void frameTileMap(int n) {
+	setCamera(&tileView, n, n / 2);
+	drawTileView(&tileView, &screenBlockSurface, 0, 0);
+	drawScreenFromBlockBuffer();
+}
+
+/**
+ * A wobbling 16x10 triangle mesh covering the screen, drawn as one batch,
+ * and a five-pointed star filled with the nonzero rule.
+ */
+#define MESH_W 16
+#define MESH_H 10
+
+static void framePolygons(int n) {
+	static int vertices[(MESH_W + 1) * (MESH_H + 1) * 2];
+	static int indices[MESH_W * MESH_H * 6];
+	static char colors[MESH_W * MESH_H * 2];
+	int star[10];
+	int i, j, v, t = 0;
+
+	for (j = 0; j <= MESH_H; j++) {
+		for (i = 0; i <= MESH_W; i++) {
+			v = j * (MESH_W + 1) + i;
+			vertices[v * 2] = i * COLS / MESH_W + ((i % MESH_W) ? (int)(2 * sin(n * 0.1 + j)) : 0);
+			vertices[v * 2 + 1] = j * ROWS * 2 / MESH_H + ((j % MESH_H) ? (int)(2 * cos(n * 0.1 + i)) : 0);
+		}
+	}
+	for (j = 0; j < MESH_H; j++) {
+		for (i = 0; i < MESH_W; i++) {
+			v = j * (MESH_W + 1) + i;
+			indices[t * 3] = v;
+			indices[t * 3 + 1] = v + 1;
+			indices[t * 3 + 2] = v + MESH_W + 2;
+			colors[t] = 1 + (i + j) % 7;
+			t++;
+			indices[t * 3] = v;
+			indices[t * 3 + 1] = v + MESH_W + 2;
+			indices[t * 3 + 2] = v + MESH_W + 1;
+			colors[t] = 9 + (i + j) % 7;
+			t++;
+		}
+	}
+	fillTrianglesToSurface(&screenBlockSurface, vertices, indices, t, colors);
+
+	for (i = 0; i < 5; i++) {
+		star[i * 2] = 40 + (int)(20 * sin(n * 0.05 + i * 2.5133));
+		star[i * 2 + 1] = 25 - (int)(20 * cos(n * 0.05 + i * 2.5133));
+	}
+	fillPolygonToBlockBuffer(star, 5, FILL_NONZERO, 15);
+	drawScreenFromBlockBuffer();
+}
+
+static void frameCircles(int n) {
+	int i;
+
+	clrBlockColorBuffer(0);
+	for (i = 0; i < 8; i++) {
+		fillCircleToBlockBuffer(5 + i * 10, 12, 2 + (n + i) % 6, 1 + i);
+		strokeCircleToBlockBuffer(5 + i * 10, 12, 4 + (n + i) % 6, 9 + i % 7);
+	}
+	fillEllipseToSurface(&screenBlockSurface, 20, 35, 15, 8 + n % 5, 2);
+	fillPieToSurface(&screenBlockSurface, 60, 35, 14, 12, n * 4, n * 4 + 300, 14);
+	strokeArcToSurface(&screenBlockSurface, 60, 35, 16, 14, n * 4 + 300, n * 4 + 360, 15);
+	drawScreenFromBlockBuffer();
+}
+
+static void frameClipped(int n) {
+	int i;
+
+	clrBlockColorBuffer(0);
+	pushClipRect(10, 5, COLS - 20, ROWS * 2 - 10);
+	for (i = 0; i < 16; i++) {
+		lineToBlockBuffer(-40 + i * 8, -20, i * 8 + n % 40, ROWS * 2 + 20, 1 + i % 15);
+		lineToBlockBuffer(-200, i * 4, COLS + 200, i * 3 + n % 20, 1 + i % 15);
+		lineToBlockBuffer(-100 - i, -50, -10, -60 - n % 10, 15);
+	}
+	fillRectToBlockBuffer(n % COLS - 20, 30, 40, 40, 9);
+	strokeRectToBlockBuffer(-5, -5, COLS + 10, 20, 12);
+	fillCircleToBlockBuffer(COLS - 10, 25, 10 + n % 8, 4);
+	popClipRect();
+	drawScreenFromBlockBuffer();
+}
+
+static DisplayList uiList;
+
+/**
+ * A static UI panel: framed boxes, a few labels and a background that the
+ * boxes partly cover. Drawn with direct calls or recorded into uiList.
+ */
+static void drawPanel(DisplayList* l) {
+	int i;
+
+	if (l) {
+		recordFillRect(l, 0, 0, COLS, ROWS * 2, 1);
+	}
+	else {
+		fillRectToBlockBuffer(0, 0, COLS, ROWS * 2, 1);
+	}
+	for (i = 0; i < 6; i++) {
+		if (l) {
+			recordFillRect(l, 2 + i * 13, 2, 12, 20, 8);
+			recordStrokeRect(l, 2 + i * 13, 2, 11, 19, 15);
+			recordText(l, 4 + i * 13, 5, "OK", 14);
+			recordLine(l, 3 + i * 13, 14, 12 + i * 13, 20, 12);
+		}
+		else {
+			fillRectToBlockBuffer(2 + i * 13, 2, 12, 20, 8);
+			strokeRectToBlockBuffer(2 + i * 13, 2, 11, 19, 15);
+			printLargeStringToBuffer(4 + i * 13, 5, "OK", 14);
+			lineToBlockBuffer(3 + i * 13, 14, 12 + i * 13, 20, 12);
+		}
+	}
+	for (i = 0; i < 4; i++) {
+		if (l) {
+			recordFillRect(l, 2 + i * 19, 26, 18, 20, 8);
+			recordFillCircle(l, 11 + i * 19, 36, 6, 4);
+		}
+		else {
+			fillRectToBlockBuffer(2 + i * 19, 26, 18, 20, 8);
+			fillCircleToBlockBuffer(11 + i * 19, 36, 6, 4);
+		}
+	}
+}
+
+// Both uicalls and uilist run this, so the list of the previous case is freed.
+static void setupPanel(void) {
+	freeDisplayList(&uiList);
+	initDisplayList(&uiList, 64, 64);
+	drawPanel(&uiList);
+}
+
+static void framePanelCalls(int n) {
+	(void)n;
+	drawPanel(NULL);
+	drawScreenFromBlockBuffer();
+}
+
+static void framePanelList(int n) {
+	(void)n;
+	drawDisplayList(&uiList);
+	drawScreenFromBlockBuffer();
+}
+
+static void setupPanelCache(void) {
+	cacheDisplayList(&uiList);
+}
+
+/**
+ * Worst cases for the flood fill: a one block wide spiral corridor (every
+ * row is visited many times, from both directions) and an 8-connected
+ * checkerboard (every span is a single block).
+ */
+static void setupSpiral(void) {
+	static const int dirX[4] = { 0, -1, 0, 1 };
+	static const int dirY[4] = { 1, 0, -1, 0 };
+	int x, y, w = COLS - 1, h = ROWS * 2 - 1, len, i;
+
+	clrBlockColorBuffer(0);
+	lineToBlockBuffer(0, 0, w, 0, 15);
+	x = w;
+	y = 0;
+	for (i = 0; ; i++) {
+		len = (i & 1) ? w : h;
+		if (len <= 0) {
+			break;
+		}
+		lineToBlockBuffer(x, y, x + dirX[i & 3] * len, y + dirY[i & 3] * len, 15);
+		x += dirX[i & 3] * len;
+		y += dirY[i & 3] * len;
+		if (i & 1) {
+			w -= 2;
+		}
+		else {
+			h -= 2;
+		}
+	}
+}
+
+static void frameSpiral(int n) {
+	floodFillBlockBuffer(1, 1, 1 + (n & 1), FLOOD_4, NO_BORDER);
+	drawScreenFromBlockBuffer();
+}
+
+static void setupChecker(void) {
+	int x, y;
+
+	for (y = 0; y < ROWS * 2; y++) {
+		for (x = 0; x < COLS; x++) {
+			blockColorBuffer[y][x] = ((x + y) & 1) ? 15 : 0;
+		}
+	}
+	markBlockBufferDirty(0, 0, COLS, ROWS * 2);
+}
+
+static void frameChecker(int n) {
+	floodFillBlockBuffer(0, 0, 1 + (n & 1), FLOOD_8, NO_BORDER);
+	drawScreenFromBlockBuffer();
+}
+
+/**
+ * Rotozoom over the whole screen: a 32x32 texture tiled (power of two, so
+ * the wrap is a mask), and a 48x30 picture with its edges clamped.
+ */
+static char textureBlocks[48 * 32];
+static BlockSurface texture;
+
+static void setupTexture(int w, int h) {
+	int x, y;
+
+	initBlockSurface(&texture, w, h, textureBlocks);
+	for (y = 0; y < h; y++) {
+		for (x = 0; x < w; x++) {
+			textureBlocks[y * w + x] = (((x >> 2) ^ (y >> 2)) & 1) ? 1 + (x + y) % 15 : 0;
+		}
+	}
+}
+
+static void setupRotozoom(void) {
+	setupTexture(32, 32);
+}
+
+static void setupRotoClamp(void) {
+	setupTexture(48, 30);
+}
+
+static void frameRotozoom(int n) {
+	rotozoomSurface(&screenBlockSurface, COLS / 2, ROWS, &texture, texture.width / 2, texture.height / 2,
+		n * 0.01, 0.5 + (n % 200) * 0.02, ROTO_WRAP);
+	drawScreenFromBlockBuffer();
+}
+
+static void frameRotoClamp(int n) {
+	rotozoomSurface(&screenBlockSurface, COLS / 2, ROWS, &texture, texture.width / 2, texture.height / 2,
+		n * 0.01, 0.5 + (n % 200) * 0.02, ROTO_CLAMP);
+	drawScreenFromBlockBuffer();
+}
+
+/**
+ * Zooming the 48x30 picture in and out; the factor changes every eight
+ * frames, so most frames reuse the scaling tables.
+ */
+static void frameZoom(int n) {
+	double f = 0.5 + ((n >> 3) % 32) * 0.1;
+
+	clrBlockColorBuffer(0);
+	scaleSurface(&screenBlockSurface, COLS / 2, ROWS, &texture, texture.width / 2, texture.height / 2, f, f, SCALE_NEAREST);
+	drawScreenFromBlockBuffer();
+}
+
+static void frameZoomDither(int n) {
+	double f = 0.5 + ((n >> 3) % 32) * 0.1;
+
+	clrBlockColorBuffer(0);
+	scaleSurface(&screenBlockSurface, COLS / 2, ROWS, &texture, texture.width / 2, texture.height / 2, f, f, SCALE_DITHER);
+	drawScreenFromBlockBuffer();
+}
+
+/**
+ * A Mode 7 floor under a flat sky, the camera circling over the 32x32
+ * texture, with a per-row callback that makes the far rows wave.
+ */
+static bool waveRow(Mode7Row* r, void* data) {
+	int n = *(int*)data;
+
+	if (r->distance > 200) {
+		return false;
+	}
+	r->u += (long)((r->y + n) & 7) << 13;
+	return true;
+}
+
+static void frameMode7(int n) {
+	Mode7Camera c;
+
+	c.x = 16 + 24 * cos(n * 0.01);
+	c.y = 16 + 24 * sin(n * 0.01);
+	c.height = 6;
+	c.angle = n * 0.01;
+	c.horizon = 12;
+	c.focal = 40;
+	c.centerX = COLS / 2;
+	fillRectToBlockBuffer(0, 0, COLS, c.horizon, 9);
+	drawMode7ToBlockBuffer(&texture, &c, MODE7_FLOOR, ROTO_WRAP, waveRow, &n);
+	drawScreenFromBlockBuffer();
+}
+
+/**
+ * A scoreboard: a dozen large-font strings redrawn every frame, and a
+ * title at double size.
+ */
+static void frameScores(int n) {
+	char line[32];
+	int i;
+
+	clrBlockColorBuffer(0);
+	printScaledStringToBuffer(2, 1, "Scores", 14, 2);
+	for (i = 0; i < 12; i++) {
+		sprintf(line, "%2d. %06d", i + 1, (n * 37 + i * 1111) % 1000000);
+		printLargeStringToBuffer(2 + (i / 6) * 40, 14 + (i % 6) * 6, line, 1 + i);
+	}
+	drawScreenFromBlockBuffer();
+}
+
+/**
+ * A wrapped, centred message box that only changes colour and position,
+ * so layoutText returns early and each frame only draws the glyphs.
+ */
+static TextLayout message;
+
+static void setupMessage(void) {
+	initTextLayout(&message);
+}
+
+static void frameMessage(int n) {
+	clrBlockColorBuffer(0);
+	layoutText(&message, "Press any key to continue your quest", TEXT_LARGE, 1, 60, 30, ALIGN_CENTER);
+	drawTextLayout(&message, 10 + (n & 7), 8, 1 + n % 15);
+	drawScreenFromBlockBuffer();
+}
+
+/**
+ * Two status lines written straight to the screen after each present,
+ * formatted into cells or through sprintf into a temporary line.
+ */
+static void printStatus(int n) {
+	printTextToScreen(0, 0, 0x1f, "Frame %6d  Score " TEXT_COLOR(1E) "%07ld" TEXT_COLOR_RESET "  Speed %q", n, n * 37L, n * 1234L);
+	printTextToScreen(0, 1, 0x1f, "Pos %4d,%-4d  Angle %.3q  Name %-10s", n % COLS, n % ROWS, n * 411L, "player");
+}
+
+static void printStatusSprintf(int n) {
+	char line[COLS + 1];
+
+	sprintf(line, "Frame %6d  Score %07ld  Speed %.2f", n, n * 37L, n * 1234L / 65536.0);
+	printColorStringToScreen(line, 0, 0, 0x1f);
+	sprintf(line, "Pos %4d,%-4d  Angle %.3f  Name %-10s", n % COLS, n % ROWS, n * 411L / 65536.0, "player");
+	printColorStringToScreen(line, 0, 1, 0x1f);
+}
+
+static void frameStatus(int n) {
+	drawScreenFromBlockBuffer();
+	printStatus(n);
+}
+
+/**
+ * A scene change that reloads a whole custom font, of which only a few
+ * glyphs differ from the one already loaded.
+ */
+static GlyphSet glyphs;
+
+static void setupGlyphs(void) {
+	int i, j;
+
+	for (i = 0; i < CHARSET_GLYPHS; i++) {
+		for (j = 0; j < GLYPH_HEIGHT; j++) {
+			glyphs.glyphs[i][j] = (unsigned char)(i * 7 + j * 13);
+		}
+	}
+	glyphs.count = CHARSET_GLYPHS;
+	glyphs.height = GLYPH_HEIGHT;
+}
+
+static void reloadGlyphs(int n) {
+	glyphs.glyphs[n & 255][n & 15] ^= 1;
+	glyphs.glyphs[(n * 5) & 255][0] ^= 2;
+	loadGlyphSet(&glyphs);
+}
+
+/**
+ * A spinning wireframe square in 640x400 pixels: only the cells the lines
+ * cross need glyph slots, the rest are drawn as blocks.
+ */
+static HiresScreen hires;
+
+static void setupHires(void) {
+	initHiresScreen(&hires, 0x1f, 128, 128);
+}
+
+static void frameHires(int n) {
+	int i, x[4], y[4];
+
+	clearHiresScreen(&hires, 0x1f);
+	for (i = 0; i < 4; i++) {
+		x[i] = HIRES_WIDTH / 2 + (int)(150 * cos(n * 0.02 + i * 1.5708));
+		y[i] = HIRES_HEIGHT / 2 + (int)(150 * sin(n * 0.02 + i * 1.5708));
+	}
+	for (i = 0; i < 4; i++) {
+		hiresLine(&hires, x[i], y[i], x[(i + 1) & 3], y[(i + 1) & 3], true);
+	}
+	drawScreenFromHiresScreen(&hires);
+}
+
+static const BlockKernels* kernels[] = {
+	&scalarBlockKernels,
+	&swarBlockKernels,
+#ifdef TXTGFX_X86_SIMD
+	&sse2BlockKernels,
+	&avx2BlockKernels,
+#endif
+};
+
+/**
+ * CPU cycles where the time stamp counter is available, clock ticks otherwise.
+ */
+static unsigned long long readCycles(void) {
+#ifdef HAVE_RDTSC
+	return __rdtsc();
+#else
+	return clock();
+#endif
+}
+
+static BenchCase cases[] = {
+	{ "static", setupTiles, frameStatic },
+	{ "sprite", setupTiles, frameSprite },
+	{ "shapes", setupTiles, frameShapes },
+	{ "scroll", setupText, frameScroll },
+	{ "torus", setupTorus, frameScroll },
+	{ "parallax", setupText, frameParallax },
+	{ "wave", setupText, frameWave },
+	{ "rotate", setupText, frameRotate },
+	{ "bytes", setupTiles, frameBytes },
+	{ "packed", setupPacked, framePacked },
+	{ "tplayers", setupLayers, frameTpLayers },
+	{ "compose", setupLayers, frameCompose },
+	{ "tpblit", setupSprites, frameTpBlit },
+	{ "sprites", setupSprites, frameSprites },
+	{ "tilemap", setupTileMap, frameTileMap },
+	{ "tilefile", setupTileFile, frameTileMap },
+	{ "polygons", setupTiles, framePolygons },
+	{ "circles", setupTiles, frameCircles },
+	{ "clipped", setupTiles, frameClipped },
+	{ "uicalls", setupPanel, framePanelCalls },
+	{ "uilist", setupPanel, framePanelList },
+	{ "uicache", setupPanelCache, framePanelList },
+	{ "spiral", setupSpiral, frameSpiral },
+	{ "checker", setupChecker, frameChecker },
+	{ "rotozoom", setupRotozoom, frameRotozoom },
+	{ "rotoclmp", setupRotoClamp, frameRotoClamp },
+	{ "zoom", setupRotoClamp, frameZoom },
+	{ "zoomdith", setupRotoClamp, frameZoomDither },
+	{ "mode7", setupRotozoom, frameMode7 },
+	{ "scores", setupTiles, frameScores },
+	{ "message", setupMessage, frameMessage },
+	{ "status", setupText, frameStatus },
+	{ "hires", setupHires, frameHires }
+};
+
+int main(void) {
+	int i, n;
+	long cells;
+	clock_t start;
+	double us;
+	unsigned long long cycles;
+	long uploads, slots;
+
+	initTextMode();
+
+	for (i = 0; i < (int)(sizeof(cases) / sizeof(cases[0])); i++) {
+		clrBlockColorBuffer(0);
+		cases[i].setup();
+		drawScreenFromBlockBuffer();
+
+		cells = 0;
+		start = clock();
+		for (n = 0; n < FRAMES; n++) {
+			cases[i].frame(n);
+			cells += getCellsWritten();
+		}
+		us = (double)(clock() - start) * 1000000.0 / CLOCKS_PER_SEC;
+
+		printf("%-8s %10.2f us/frame %8ld cells/frame\n", cases[i].name, us / FRAMES, cells / FRAMES);
+		setToroidalBlockBuffer(false);
+		setBlockRowOffsets(NULL);
+	}
+
+	// Full presents: every cell is packed and written each frame.
+	setupText();
+	for (i = 0; i < (int)(sizeof(kernels) / sizeof(kernels[0])); i++) {
+#ifdef TXTGFX_X86_SIMD
+		if (kernels[i] == &avx2BlockKernels && !__builtin_cpu_supports("avx2")) {
+			continue;
+		}
+#endif
+		setBlockKernels(kernels[i]);
+
+		cycles = readCycles();
+		for (n = 0; n < FRAMES; n++) {
+			invalidateScreen();
+			drawScreenFromBlockBuffer();
+		}
+		cycles = readCycles() - cycles;
+		printf("present  %-8s %10llu cycles/frame", kernels[i]->name, cycles / FRAMES);
+
+		cycles = readCycles();
+		for (n = 0; n < FRAMES; n++) {
+			drawBlocksToBuffer();
+		}
+		cycles = readCycles() - cycles;
+		printf("  drawBlocksToBuffer %10llu cycles/frame", cycles / FRAMES);
+
+		packBlockBuffer(&packed);
+		cycles = readCycles();
+		for (n = 0; n < FRAMES; n++) {
+			invalidateScreen();
+			drawScreenFromPackedSurface(&packed);
+		}
+		cycles = readCycles() - cycles;
+		printf("  packed %10llu cycles/frame", cycles / FRAMES);
+
+		setupRotoClamp();
+		cycles = readCycles();
+		for (n = 0; n < FRAMES; n++) {
+			rotozoomSurface(&screenBlockSurface, 0, 0, &texture, 0, 0, 0.3, 2.0, ROTO_TRANSPARENT);
+		}
+		cycles = readCycles() - cycles;
+		printf("  rotozoom %10llu cycles/frame\n", cycles / FRAMES);
+		setupText();
+	}
+	setBlockKernels(NULL);
+
+	// Sprite drawing alone, without the background restore and present.
+	setupSprites();
+	moveSprites(0);
+	cycles = readCycles();
+	for (n = 0; n < FRAMES; n++) {
+		for (i = 0; i < SPRITES; i++) {
+			blitSurfaceTp(&screenBlockSurface, spriteDraws[i].x, spriteDraws[i].y, &ball, 0);
+		}
+	}
+	cycles = readCycles() - cycles;
+	printf("sprites  tpblit %10llu cycles/sprite", cycles / FRAMES / SPRITES);
+
+	cycles = readCycles();
+	for (n = 0; n < FRAMES; n++) {
+		drawSprites(&screenBlockSurface, spriteDraws, SPRITES);
+	}
+	cycles = readCycles() - cycles;
+	printf("  compiled %10llu cycles/sprite\n", cycles / FRAMES / SPRITES);
+
+	// Status lines alone, without the present.
+	cycles = readCycles();
+	for (n = 0; n < FRAMES; n++) {
+		printStatusSprintf(n);
+	}
+	cycles = readCycles() - cycles;
+	printf("status   sprintf %10llu cycles/frame", cycles / FRAMES);
+
+	cycles = readCycles();
+	for (n = 0; n < FRAMES; n++) {
+		printStatus(n);
+	}
+	cycles = readCycles() - cycles;
+	printf("  printText %10llu cycles/frame\n", cycles / FRAMES);
+
+	// Font reloads: every glyph sent versus only the changed ones.
+	setupGlyphs();
+	cycles = readCycles();
+	for (n = 0; n < FRAMES; n++) {
+		invalidateGlyphs();
+		reloadGlyphs(n);
+	}
+	cycles = readCycles() - cycles;
+	printf("glyphs   full %10llu cycles/frame", cycles / FRAMES);
+
+	uploads = getGlyphsUploaded();
+	cycles = readCycles();
+	for (n = 0; n < FRAMES; n++) {
+		reloadGlyphs(n);
+	}
+	cycles = readCycles() - cycles;
+	printf("  shadowed %10llu cycles/frame %4ld glyphs/frame\n", cycles / FRAMES, (getGlyphsUploaded() - uploads) / FRAMES);
+
+	// Glyph slot pressure and uploads of the hires case.
+	setupHires();
+	slots = 0;
+	uploads = 0;
+	for (n = 0; n < FRAMES; n++) {
+		frameHires(n);
+		slots += hires.slotsUsed;
+		uploads += hires.uploadBytes;
+	}
+	printf("hires    %6ld of %d slots/frame %6ld upload bytes/frame\n", slots / FRAMES, hires.slotCount, uploads / FRAMES);
+
+	freeDisplayList(&uiList);
+	closeTileMap(&fileMap);
+	freeTileView(&tileView);
+	remove("BENCH.MAP");
+
+	return 0;
+}
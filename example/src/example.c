@@ -43,10 +43,12 @@ int main(void) {
 	// s3
 
 	// Screen 4
+	beginColorBatch();
 	setColor(0, 0, 0, 0);
 	for (i = 1; i < 16; i++) {
 		setColor(i, i, i * 2, (i + 1) * 4 - 1);
 	}
+	endColorBatch();
 	drawScreenFromBlockBuffer();
 	printColorStringToScreen("Palette set to blue hues.", 0, 0, 7);
 	promptForKey();
@@ -91,6 +93,8 @@ int main(void) {
 	}
 	printLargeStringToBuffer(4, 4, "SCROLLING...", 10);
 
+	// Scrolling only moves the buffer origin; nothing is copied.
+	setToroidalBlockBuffer(true);
 	while (!kbhit()) {
 		
 		shiftBlockBuffer(-1, 0);
@@ -99,6 +103,7 @@ int main(void) {
 		printColorStringToScreen("Press any key to continue.", 54, 24, 7);
 
 	} getch();
+	setToroidalBlockBuffer(false);
 	// s7
 
 	// Screen 8
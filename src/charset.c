@@ -0,0 +1,173 @@
+/**
+ * Fonttimuistin varjokopio ja fonttitiedostot (ks. charset.h).
+ *
+ * Varjossa on merkkien viimeksi asetettu sislt. known[c] kertoo, onko
+ * merkki c asetettu setGlyphill invalidateGlyphsin jlkeen, ja pending[c],
+ * odottaako se lhetyst. Odottavat merkit ovat vlill pendingMin ...
+ * pendingMax, joten flushGlyphs ky lpi vain sen.
+ */
+
+#include "charset.h"
+#include "video.h"
+
+// PSF1: 2 tavun tunniste, tila ja merkin korkeus. PSF2: 8 32-bittist kentt.
+#define PSF1_HEADER_SIZE 4
+#define PSF1_MODE_512 1
+#define PSF2_HEADER_SIZE 32
+
+static const unsigned char psf1Magic[2] = { 0x36, 0x04 };
+static const unsigned char psf2Magic[4] = { 0x72, 0xb5, 0x4a, 0x86 };
+
+static unsigned char shadow[CHARSET_GLYPHS][GLYPH_HEIGHT];
+static bool known[CHARSET_GLYPHS];
+static bool pending[CHARSET_GLYPHS];
+static int pendingMin = CHARSET_GLYPHS;
+static int pendingMax = -1;
+
+static long glyphsUploaded = 0;
+
+bool setGlyph(int c, const char* data) {
+	if ((unsigned)c >= CHARSET_GLYPHS) {
+		return false;
+	}
+	if (known[c] && memcmp(shadow[c], data, GLYPH_HEIGHT) == 0) {
+		return false;
+	}
+
+	memcpy(shadow[c], data, GLYPH_HEIGHT);
+	known[c] = true;
+	pending[c] = true;
+	if (c < pendingMin) { pendingMin = c; }
+	if (c > pendingMax) { pendingMax = c; }
+	return true;
+}
+
+int flushGlyphs(void) {
+	const VideoBackend* backend = getVideoBackend();
+	int c, first, n = 0;
+
+	for (c = pendingMin; c <= pendingMax; c++) {
+		if (!pending[c]) {
+			continue;
+		}
+		first = c;
+		while (c <= pendingMax && pending[c]) {
+			pending[c] = false;
+			c++;
+		}
+		backend->loadFont(first, c - first, (char*)shadow[first]);
+		n += c - first;
+	}
+
+	pendingMin = CHARSET_GLYPHS;
+	pendingMax = -1;
+	glyphsUploaded += n;
+	return n;
+}
+
+int loadGlyphs(int first, int count, const char* data) {
+	int i;
+
+	for (i = 0; i < count; i++) {
+		setGlyph(first + i, data + i * GLYPH_HEIGHT);
+	}
+	return flushGlyphs();
+}
+
+int loadGlyphSet(const GlyphSet* set) {
+	return loadGlyphs(0, set->count, (const char*)set->glyphs);
+}
+
+const unsigned char* getGlyph(int c) {
+	return shadow[c & (CHARSET_GLYPHS - 1)];
+}
+
+void getGlyphSet(GlyphSet* set) {
+	set->count = CHARSET_GLYPHS;
+	set->height = GLYPH_HEIGHT;
+	memcpy(set->glyphs, shadow, sizeof(shadow));
+}
+
+void invalidateGlyphs(void) {
+	memset(shadow, 0, sizeof(shadow));
+	memset(known, 0, sizeof(known));
+	memset(pending, 0, sizeof(pending));
+	pendingMin = CHARSET_GLYPHS;
+	pendingMax = -1;
+}
+
+long getGlyphsUploaded(void) {
+	return glyphsUploaded;
+}
+
+long getGlyphBytesUploaded(void) {
+	return glyphsUploaded * GLYPH_HEIGHT;
+}
+
+static unsigned long readInt32(const unsigned char* b) {
+	return b[0] | ((unsigned long)b[1] << 8) | ((unsigned long)b[2] << 16) | ((unsigned long)b[3] << 24);
+}
+
+bool readFontFile(GlyphSet* set, const char* filename) {
+	unsigned char header[PSF2_HEADER_SIZE];
+	FILE* f = fopen(filename, "rb");
+	long size, offset;
+	unsigned long count, height;
+	size_t n;
+	int i;
+
+	if (!f) {
+		return false;
+	}
+	fseek(f, 0, SEEK_END);
+	size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	n = fread(header, 1, PSF2_HEADER_SIZE, f);
+
+	if (n >= PSF1_HEADER_SIZE && memcmp(header, psf1Magic, 2) == 0) {
+		offset = PSF1_HEADER_SIZE;
+		count = (header[2] & PSF1_MODE_512) ? 512 : 256;
+		height = header[3];
+	}
+	else if (n == PSF2_HEADER_SIZE && memcmp(header, psf2Magic, 4) == 0) {
+		// Rivin on mahduttava tavuun: leveys enintn 8, merkin koko = korkeus.
+		offset = (long)readInt32(header + 8);
+		count = readInt32(header + 16);
+		height = readInt32(header + 24);
+		if (readInt32(header + 28) > 8 || readInt32(header + 20) != height) {
+			fclose(f);
+			return false;
+		}
+	}
+	else if (size > 0 && size % CHARSET_GLYPHS == 0) {
+		offset = 0;
+		count = CHARSET_GLYPHS;
+		height = size / CHARSET_GLYPHS;
+	}
+	else {
+		fclose(f);
+		return false;
+	}
+
+	if (height == 0 || height > GLYPH_HEIGHT || count == 0) {
+		fclose(f);
+		return false;
+	}
+	if (count > CHARSET_GLYPHS) {
+		count = CHARSET_GLYPHS;
+	}
+
+	set->count = (int)count;
+	set->height = (int)height;
+	memset(set->glyphs, 0, sizeof(set->glyphs));
+	fseek(f, offset, SEEK_SET);
+	for (i = 0; i < set->count; i++) {
+		if (fread(set->glyphs[i], 1, height, f) != height) {
+			fclose(f);
+			return false;
+		}
+	}
+
+	fclose(f);
+	return true;
+}
@@ -0,0 +1,76 @@
+#ifndef _CHARSET_H
+#define _CHARSET_H
+
+#include "txtgfx.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Merkkien mr ja merkin korkeus (rivi eli tavua) 80x25-tekstimoodissa.
+#define CHARSET_GLYPHS 256
+#define GLYPH_HEIGHT 16
+
+/**
+ * Merkist: merkit 0 ... count - 1, kukin GLYPH_HEIGHT rivin bittikarttana
+ * (ylin bitti on vasen pikseli). height on tiedoston merkkien korkeus;
+ * matalampien merkkien alle jvt rivit ovat tyhji.
+ */
+typedef struct GlyphSet {
+	int count;
+	int height;
+	unsigned char glyphs[CHARSET_GLYPHS][GLYPH_HEIGHT];
+} GlyphSet;
+
+/**
+ * Nytn fonttimuistin varjokopio. Merkit kirjoitetaan ensin varjoon, ja
+ * flushGlyphs lhett nyttlaitteelle (ks. VideoBackend.loadFont) vain
+ * muuttuneet merkit, yhteniset merkkijonot yhten siirtona. Merkkej,
+ * joita ei ole tmn jlkeen ladattu (esim. initTextMode palauttaa
+ * ROM-fontin), pidetn tuntemattomina ja ne lhetetn aina.
+ */
+
+/**
+ * Asettaa merkin c bittikartan (GLYPH_HEIGHT tavua) lhetettvksi
+ * seuraavassa flushGlyphsiss. Palauttaa false, jos merkki oli jo sama.
+ */
+bool setGlyph(int c, const char* data);
+
+/**
+ * Lhett setGlyphill muutetut merkit. Palauttaa lhetettyjen merkkien
+ * mrn.
+ */
+int flushGlyphs(void);
+
+/**
+ * Lataa merkit first ... first + count - 1 (count * GLYPH_HEIGHT tavua)
+ * ja lhett muuttuneet heti. Palauttaa lhetettyjen merkkien mrn.
+ */
+int loadGlyphs(int first, int count, const char* data);
+int loadGlyphSet(const GlyphSet* set);
+
+// Merkin c bittikartta varjosta (tuntemattomat merkit ovat tyhji).
+const unsigned char* getGlyph(int c);
+void getGlyphSet(GlyphSet* set);
+
+// Unohtaa varjon sislln, esim. kun tekstimoodi alustetaan uudelleen.
+void invalidateGlyphs(void);
+
+// Nyttlaitteelle lhetettyjen merkkien ja tavujen mrt yhteens.
+long getGlyphsUploaded(void);
+long getGlyphBytesUploaded(void);
+
+/**
+ * Lukee 8 pikseli leven fontin: PSF1- tai PSF2-tiedoston tai raa'an
+ * .fnt-tiedoston (256 merkki perkkin, merkin korkeus on tiedoston koko
+ * / 256). Enintn GLYPH_HEIGHT rivin korkuiset fontit kelpaavat, ja
+ * 512 merkin PSF-fonteista luetaan 256 ensimmist. Palauttaa false, jos
+ * tiedostoa ei voi lukea tai muoto ei kelpaa.
+ */
+bool readFontFile(GlyphSet* set, const char* filename);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
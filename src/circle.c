@@ -0,0 +1,384 @@
+/**
+ * Ympyrt, ellipsit, kaaret ja sektorit (ks. circle.h).
+ *
+ * Reuna jljitetn ensin yhteen neljnnekseen: rowMin[dy] ja rowMax[dy]
+ * ovat reunan ensimminen ja viimeinen x keskipisteest rivill dy. Muut
+ * neljnnekset saadaan peilaamalla, ja sek reuna ett tytt piirretn
+ * riveittin yhtenisin ptkin.
+ */
+
+#include "circle.h"
+
+#define ANGLE_BIG 0x7fff
+
+static int rowMin[MAX_ELLIPSE_RADIUS + 1];
+static int rowMax[MAX_ELLIPSE_RADIUS + 1];
+
+static bool aspectCorrection = false;
+
+// sin(0...90 astetta) * 1024
+static const short sineTable[91] = {
+	0, 18, 36, 54, 71, 89, 107, 125, 143, 160,
+	178, 195, 213, 230, 248, 265, 282, 299, 316, 333,
+	350, 367, 384, 400, 416, 433, 449, 465, 481, 496,
+	512, 527, 543, 558, 573, 587, 602, 616, 630, 644,
+	658, 672, 685, 698, 711, 724, 737, 749, 761, 773,
+	784, 796, 807, 818, 828, 839, 849, 859, 868, 878,
+	887, 896, 904, 912, 920, 928, 935, 943, 949, 956,
+	962, 968, 974, 979, 984, 989, 994, 998, 1002, 1005,
+	1008, 1011, 1014, 1016, 1018, 1020, 1022, 1023, 1023, 1024,
+	1024
+};
+
+static int isin(int a) {
+	a %= 360;
+	if (a < 0) { a += 360; }
+	if (a <= 90) { return sineTable[a]; }
+	if (a <= 180) { return sineTable[180 - a]; }
+	if (a <= 270) { return -sineTable[a - 180]; }
+	return -sineTable[360 - a];
+}
+
+static int icos(int a) {
+	return isin(a + 90);
+}
+
+void setAspectCorrection(bool b) {
+	aspectCorrection = b;
+}
+
+bool getAspectCorrection(void) {
+	return aspectCorrection;
+}
+
+static int correctedRadius(int radius) {
+	return aspectCorrection ? (radius * 5 + 3) / 6 : radius;
+}
+
+static void record(int x, int y) {
+	if (x < rowMin[y]) { rowMin[y] = x; }
+	if (x > rowMax[y]) { rowMax[y] = x; }
+}
+
+/**
+ * Keskipisteympyr: yksi kahdeksannes lasketaan ja peilataan lvistjn
+ * yli toiseksi.
+ */
+static void traceCircle(int r) {
+	int x = r, y = 0, d = 1 - r;
+
+	while (x >= y) {
+		record(x, y);
+		record(y, x);
+		y++;
+		if (d < 0) {
+			d += 2 * y + 1;
+		}
+		else {
+			x--;
+			d += 2 * (y - x) + 1;
+		}
+	}
+}
+
+/**
+ * Keskipisteellipsi kahdessa osassa: ensin jyrkk osa rivi kerrallaan,
+ * sitten loiva osa sarake kerrallaan. Virhetermit kasvavat steen kolmanteen
+ * potenssiin, mist MAX_ELLIPSE_RADIUS.
+ */
+static void traceEllipse(int rx, int ry) {
+	long twoA2 = 2L * rx * rx, twoB2 = 2L * ry * ry;
+	long xChange, yChange, err, stopX, stopY;
+	int x, y;
+
+	x = rx;
+	y = 0;
+	xChange = (long)ry * ry * (1 - 2 * rx);
+	yChange = (long)rx * rx;
+	err = 0;
+	stopX = twoB2 * rx;
+	stopY = 0;
+	while (stopX >= stopY) {
+		record(x, y);
+		y++;
+		stopY += twoA2;
+		err += yChange;
+		yChange += twoA2;
+		if (2 * err + xChange > 0) {
+			x--;
+			stopX -= twoB2;
+			err += xChange;
+			xChange += twoB2;
+		}
+	}
+
+	x = 0;
+	y = ry;
+	xChange = (long)ry * ry;
+	yChange = (long)rx * rx * (1 - 2 * ry);
+	err = 0;
+	stopX = 0;
+	stopY = twoA2 * ry;
+	while (stopX <= stopY) {
+		record(x, y);
+		x++;
+		stopX += twoB2;
+		err += xChange;
+		xChange += twoB2;
+		if (2 * err + yChange > 0) {
+			y--;
+			stopY -= twoA2;
+			err += yChange;
+			yChange += twoA2;
+		}
+	}
+}
+
+/**
+ * Tytt rowMin- ja rowMax-taulukot riveille 0 ... ry. Palauttaa false,
+ * jos steet eivt kelpaa.
+ */
+static bool trace(int rx, int ry) {
+	int i;
+
+	if (rx < 0 || ry < 0 || rx > MAX_ELLIPSE_RADIUS || ry > MAX_ELLIPSE_RADIUS) {
+		return false;
+	}
+	for (i = 0; i <= ry; i++) {
+		rowMin[i] = ANGLE_BIG;
+		rowMax[i] = -1;
+	}
+
+	if (rx == 0) {
+		for (i = 0; i <= ry; i++) {
+			record(0, i);
+		}
+	}
+	else if (ry == 0) {
+		record(0, 0);
+		record(rx, 0);
+	}
+	else if (rx == ry) {
+		traceCircle(rx);
+	}
+	else {
+		traceEllipse(rx, ry);
+	}
+	return true;
+}
+
+/**
+ * Kokonaan pinnan ulkopuolelle jvt kuviot hyltn ennen jljityst.
+ */
+static bool visible(const BlockSurface* s, int x, int y, int rx, int ry) {
+	return x + rx >= 0 && y + ry >= 0 && x - rx < s->width && y - ry < s->height;
+}
+
+static void span(BlockSurface* s, int x0, int x1, int y, int color) {
+	if ((unsigned)y >= (unsigned)s->height) {
+		return;
+	}
+	if (x0 < 0) { x0 = 0; }
+	if (x1 >= s->width) { x1 = s->width - 1; }
+	if (x0 <= x1) {
+		memset(s->pixels + y * s->stride + x0, color, x1 - x0 + 1);
+	}
+}
+
+static void changed(BlockSurface* s, int x, int y, int rx, int ry) {
+	if (s->pixels == (char*)blockColorBuffer) {
+		markBlockBufferDirty(x - rx, y - ry, 2 * rx + 1, 2 * ry + 1);
+	}
+}
+
+void strokeEllipseToSurface(BlockSurface* s, int x, int y, int rx, int ry, int color) {
+	int i;
+
+	if (!visible(s, x, y, rx, ry) || !trace(rx, ry)) {
+		return;
+	}
+	for (i = 0; i <= ry; i++) {
+		span(s, x + rowMin[i], x + rowMax[i], y - i, color);
+		span(s, x - rowMax[i], x - rowMin[i], y - i, color);
+		if (i > 0) {
+			span(s, x + rowMin[i], x + rowMax[i], y + i, color);
+			span(s, x - rowMax[i], x - rowMin[i], y + i, color);
+		}
+	}
+	changed(s, x, y, rx, ry);
+}
+
+void fillEllipseToSurface(BlockSurface* s, int x, int y, int rx, int ry, int color) {
+	int i;
+
+	if (!visible(s, x, y, rx, ry) || !trace(rx, ry)) {
+		return;
+	}
+	for (i = 0; i <= ry; i++) {
+		span(s, x - rowMax[i], x + rowMax[i], y - i, color);
+		if (i > 0) {
+			span(s, x - rowMax[i], x + rowMax[i], y + i, color);
+		}
+	}
+	changed(s, x, y, rx, ry);
+}
+
+void strokeCircleToSurface(BlockSurface* s, int x, int y, int radius, int color) {
+	strokeEllipseToSurface(s, x, y, radius, correctedRadius(radius), color);
+}
+
+void fillCircleToSurface(BlockSurface* s, int x, int y, int radius, int color) {
+	fillEllipseToSurface(s, x, y, radius, correctedRadius(radius), color);
+}
+
+/**
+ * Sektori kulmasta start vastapivn kulmaan end. Piste p (y ylspin) on
+ * sektorissa, jos se on steen a vasemmalla ja steen b oikealla puolella;
+ * yli 180 asteen sektorissa riitt toinen ehdoista.
+ */
+typedef struct Sector {
+	int ax, ay, bx, by;
+	bool full;
+	bool wide;
+	bool empty;
+} Sector;
+
+static void initSector(Sector* sc, int start, int end) {
+	int sweep = end - start;
+
+	sc->full = sweep >= 360 || sweep <= -360;
+	sweep %= 360;
+	if (sweep < 0) { sweep += 360; }
+	sc->empty = !sc->full && sweep == 0;
+	sc->wide = sweep > 180;
+	sc->ax = icos(start);
+	sc->ay = isin(start);
+	sc->bx = icos(end);
+	sc->by = isin(end);
+}
+
+static bool inSector(const Sector* sc, int px, int qy) {
+	bool a = sc->ax * qy - sc->ay * px >= 0;
+	bool b = px * sc->by - qy * sc->bx >= 0;
+	return sc->full || (sc->wide ? a || b : a && b);
+}
+
+static int floorDiv(int a, int b) {
+	int q = a / b;
+	if (a % b != 0 && (a < 0) != (b < 0)) {
+		q--;
+	}
+	return q;
+}
+
+/**
+ * Ratkaisee epyhtln k * px <= c: px kuuluu vliin lo ... hi.
+ */
+static void solveHalfPlane(int k, int c, int* lo, int* hi) {
+	if (k > 0) {
+		*lo = -ANGLE_BIG;
+		*hi = floorDiv(c, k);
+	}
+	else if (k < 0) {
+		*lo = -floorDiv(c, -k);
+		*hi = ANGLE_BIG;
+	}
+	else if (c >= 0) {
+		*lo = -ANGLE_BIG;
+		*hi = ANGLE_BIG;
+	}
+	else {
+		*lo = ANGLE_BIG;
+		*hi = -ANGLE_BIG;
+	}
+}
+
+/**
+ * Piirt reunaptkn x0 ... x1 (keskipisteest) rivill dy ne palikat,
+ * jotka ovat sektorissa.
+ */
+static void arcSpan(BlockSurface* s, const Sector* sc, int x, int y, int x0, int x1, int dy, int color) {
+	int i;
+	for (i = x0; i <= x1; i++) {
+		if (inSector(sc, i, -dy) && (unsigned)(x + i) < (unsigned)s->width && (unsigned)(y + dy) < (unsigned)s->height) {
+			s->pixels[(y + dy) * s->stride + x + i] = color;
+		}
+	}
+}
+
+void strokeArcToSurface(BlockSurface* s, int x, int y, int rx, int ry, int start, int end, int color) {
+	Sector sc;
+	int i;
+
+	initSector(&sc, start, end);
+	if (sc.empty || !visible(s, x, y, rx, ry) || !trace(rx, ry)) {
+		return;
+	}
+	for (i = 0; i <= ry; i++) {
+		arcSpan(s, &sc, x, y, rowMin[i], rowMax[i], -i, color);
+		arcSpan(s, &sc, x, y, -rowMax[i], -rowMin[i], -i, color);
+		if (i > 0) {
+			arcSpan(s, &sc, x, y, rowMin[i], rowMax[i], i, color);
+			arcSpan(s, &sc, x, y, -rowMax[i], -rowMin[i], i, color);
+		}
+	}
+	changed(s, x, y, rx, ry);
+}
+
+void strokePieToSurface(BlockSurface* s, int x, int y, int rx, int ry, int start, int end, int color) {
+	strokeArcToSurface(s, x, y, rx, ry, start, end, color);
+	if (end - start < 360 && end - start > -360) {
+		lineToSurface(s, x, y, x + (rx * icos(start) + 512) / 1024, y - (ry * isin(start) + 512) / 1024, color);
+		lineToSurface(s, x, y, x + (rx * icos(end) + 512) / 1024, y - (ry * isin(end) + 512) / 1024, color);
+	}
+}
+
+/**
+ * Tytetty sektori. Kummankin steen puolitaso rajaa rivill vlin, joten
+ * rivill on ellipsin ptkn ja puolitasojen leikkaus (tai yli 180 asteen
+ * sektorissa yhdiste) eli enintn kaksi ptk.
+ */
+void fillPieToSurface(BlockSurface* s, int x, int y, int rx, int ry, int start, int end, int color) {
+	Sector sc;
+	int i, j, dy, w, loA, hiA, loB, hiB, lo, hi;
+
+	initSector(&sc, start, end);
+	if (sc.empty || !visible(s, x, y, rx, ry) || !trace(rx, ry)) {
+		return;
+	}
+	if (sc.full) {
+		fillEllipseToSurface(s, x, y, rx, ry, color);
+		return;
+	}
+
+	for (i = -ry; i <= ry; i++) {
+		dy = (i < 0) ? -i : i;
+		w = rowMax[dy];
+
+		// Rivill qy = -i: ay * px <= ax * qy ja -by * px <= -bx * qy.
+		solveHalfPlane(sc.ay, sc.ax * -i, &loA, &hiA);
+		solveHalfPlane(-sc.by, -sc.bx * -i, &loB, &hiB);
+
+		if (sc.wide) {
+			for (j = 0; j < 2; j++) {
+				lo = (j == 0) ? loA : loB;
+				hi = (j == 0) ? hiA : hiB;
+				if (lo < -w) { lo = -w; }
+				if (hi > w) { hi = w; }
+				if (lo <= hi) {
+					span(s, x + lo, x + hi, y + i, color);
+				}
+			}
+		}
+		else {
+			lo = (loA > loB) ? loA : loB;
+			hi = (hiA < hiB) ? hiA : hiB;
+			if (lo < -w) { lo = -w; }
+			if (hi > w) { hi = w; }
+			if (lo <= hi) {
+				span(s, x + lo, x + hi, y + i, color);
+			}
+		}
+	}
+	changed(s, x, y, rx, ry);
+}
@@ -0,0 +1,43 @@
+#ifndef _CIRCLE_H
+#define _CIRCLE_H
+
+#include "surface.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Suurin sallittu sde; tt suuremmat ympyrt ja ellipsit jtetn piirtmtt.
+#define MAX_ELLIPSE_RADIUS 640
+
+/**
+ * Ympyrt, ellipsit, kaaret ja sektorit kokonaislukuaritmetiikalla
+ * (keskipistealgoritmit). Jokaiselle riville lasketaan vain reunan alku ja
+ * loppu, joten tytetyt kuviot piirretn memsetill riveittin.
+ *
+ * Kulmat ovat asteina, 0 oikealle ja kasvavat vastapivn (90 yls).
+ * Kaari kulkee kulmasta start vastapivn kulmaan end.
+ */
+void strokeCircleToSurface(BlockSurface* s, int x, int y, int radius, int color);
+void fillCircleToSurface(BlockSurface* s, int x, int y, int radius, int color);
+void strokeEllipseToSurface(BlockSurface* s, int x, int y, int rx, int ry, int color);
+void fillEllipseToSurface(BlockSurface* s, int x, int y, int rx, int ry, int color);
+
+void strokeArcToSurface(BlockSurface* s, int x, int y, int rx, int ry, int start, int end, int color);
+void strokePieToSurface(BlockSurface* s, int x, int y, int rx, int ry, int start, int end, int color);
+void fillPieToSurface(BlockSurface* s, int x, int y, int rx, int ry, int start, int end, int color);
+
+/**
+ * Palikat ovat 4:3-nytll korkeampia kuin leveit (leveys:korkeus = 5:6).
+ * Kun korjaus on pll, ympyrfunktiot (mys strokeCircleToBlockBuffer ja
+ * fillCircleToBlockBuffer) piirtvt ellipsin, jonka pystysde on 5/6
+ * steest, jolloin ympyr nytt ruudulla pyrelt.
+ */
+void setAspectCorrection(bool b);
+bool getAspectCorrection(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
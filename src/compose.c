@@ -0,0 +1,164 @@
+/**
+ * Tasokompositori (ks. compose.h). Muuttunut alue kydn lpi solurivi
+ * kerrallaan: kummallekin palikkariville tytetn ensin taustavri, sitten
+ * jokaisen rivin kohdalle osuvan tason ptk keyBlend-funktiolla, ja lopuksi
+ * rivipari pakataan kohdepinnan vritavuiksi. Jokainen kohdetavu kirjoitetaan
+ * siis kerran riippumatta tasojen mrst.
+ */
+
+#include "compose.h"
+#include "kernels.h"
+
+// Rivit ksitelln enintn nin levein ptkin.
+#define COMPOSE_CHUNK 128
+
+static void clearDirty(Compositor* c) {
+	c->dirtyX0 = c->dirtyY0 = 0;
+	c->dirtyX1 = c->dirtyY1 = -1;
+}
+
+void initCompositor(Compositor* c, PackedSurface* target, int background) {
+	c->target = target;
+	c->background = background;
+	c->layerCount = 0;
+	clearDirty(c);
+	markCompositorDirty(c, 0, 0, target->width, target->height);
+}
+
+int addLayer(Compositor* c, BlockSurface* surface, int x, int y, int colorKey) {
+	BlockLayer* l;
+
+	if (c->layerCount == MAX_LAYERS) {
+		return -1;
+	}
+
+	l = &c->layers[c->layerCount];
+	l->surface = surface;
+	l->x = x;
+	l->y = y;
+	l->colorKey = colorKey;
+	l->visible = true;
+	markLayerChanged(c, c->layerCount);
+
+	return c->layerCount++;
+}
+
+/**
+ * Laajentaa muuttunutta aluetta. Alue leikataan kohdepinnan rajoihin.
+ */
+void markCompositorDirty(Compositor* c, int x, int y, int w, int h) {
+	int x1 = x + w - 1, y1 = y + h - 1;
+
+	if (x < 0) { x = 0; }
+	if (y < 0) { y = 0; }
+	if (x1 >= c->target->width) { x1 = c->target->width - 1; }
+	if (y1 >= c->target->height) { y1 = c->target->height - 1; }
+	if (x > x1 || y > y1) {
+		return;
+	}
+
+	if (c->dirtyX0 > c->dirtyX1) {
+		c->dirtyX0 = x;
+		c->dirtyY0 = y;
+		c->dirtyX1 = x1;
+		c->dirtyY1 = y1;
+		return;
+	}
+	if (x < c->dirtyX0) { c->dirtyX0 = x; }
+	if (y < c->dirtyY0) { c->dirtyY0 = y; }
+	if (x1 > c->dirtyX1) { c->dirtyX1 = x1; }
+	if (y1 > c->dirtyY1) { c->dirtyY1 = y1; }
+}
+
+void markLayerChanged(Compositor* c, int layer) {
+	BlockLayer* l = &c->layers[layer];
+	markCompositorDirty(c, l->x, l->y, l->surface->width, l->surface->height);
+}
+
+void markLayerAreaChanged(Compositor* c, int layer, int x, int y, int w, int h) {
+	BlockLayer* l = &c->layers[layer];
+	markCompositorDirty(c, l->x + x, l->y + y, w, h);
+}
+
+void moveLayer(Compositor* c, int layer, int x, int y) {
+	BlockLayer* l = &c->layers[layer];
+
+	if (l->x == x && l->y == y) {
+		return;
+	}
+	markLayerChanged(c, layer);
+	l->x = x;
+	l->y = y;
+	markLayerChanged(c, layer);
+}
+
+void setLayerVisible(Compositor* c, int layer, bool b) {
+	if (c->layers[layer].visible != b) {
+		c->layers[layer].visible = b;
+		markLayerChanged(c, layer);
+	}
+}
+
+/**
+ * Kokoaa kohdepinnan palikkarivin y sarakkeet x ... x + n - 1 riviin row.
+ */
+static void composeRow(Compositor* c, const BlockKernels* kernels, char* row, int x, int y, int n) {
+	BlockLayer* l;
+	const char* src;
+	int i, lx, x0, x1;
+
+	memset(row, c->background, n);
+	for (i = 0; i < c->layerCount; i++) {
+		l = &c->layers[i];
+		if (!l->visible || y < l->y || y >= l->y + l->surface->height) {
+			continue;
+		}
+
+		x0 = (l->x > x) ? l->x : x;
+		x1 = (l->x + l->surface->width < x + n) ? l->x + l->surface->width : x + n;
+		if (x0 >= x1) {
+			continue;
+		}
+
+		lx = x0 - l->x;
+		src = l->surface->pixels + (y - l->y) * l->surface->stride + lx;
+		if (l->colorKey == NO_COLOR_KEY) {
+			memcpy(row + x0 - x, src, x1 - x0);
+		}
+		else {
+			kernels->keyBlend(row + x0 - x, src, l->colorKey, x1 - x0);
+		}
+	}
+}
+
+bool compositeLayers(Compositor* c) {
+	static char top[COMPOSE_CHUNK];
+	static char bottom[COMPOSE_CHUNK];
+	const BlockKernels* kernels;
+	PackedSurface* t = c->target;
+	int i, x, n, y0, y1;
+
+	if (c->dirtyX0 > c->dirtyX1) {
+		return false;
+	}
+
+	kernels = getBlockKernels();
+
+	// Kohteeseen kirjoitetaan kokonaisia soluja, joten alue laajennetaan
+	// parillisesta parittomaan riviin.
+	y0 = c->dirtyY0 & ~1;
+	y1 = c->dirtyY1 | 1;
+	for (i = y0; i < y1; i += 2) {
+		for (x = c->dirtyX0; x <= c->dirtyX1; x += COMPOSE_CHUNK) {
+			n = c->dirtyX1 - x + 1;
+			if (n > COMPOSE_CHUNK) { n = COMPOSE_CHUNK; }
+
+			composeRow(c, kernels, top, x, i, n);
+			composeRow(c, kernels, bottom, x, i + 1, n);
+			kernels->packAttrs(t->cells + (i / 2) * t->stride + x, top, bottom, n);
+		}
+	}
+
+	clearDirty(c);
+	return true;
+}
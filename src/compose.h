@@ -0,0 +1,72 @@
+#ifndef _COMPOSE_H
+#define _COMPOSE_H
+
+#include "surface.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MAX_LAYERS 8
+
+// Lpinkyvn vrin paikalla: taso on kokonaan peittv.
+#define NO_COLOR_KEY -1
+
+/**
+ * Kompositorin taso: palikkapinta kohdassa (x, y). Tason colorKey-vriset
+ * palikat ovat lpinkyvi.
+ */
+typedef struct BlockLayer {
+	BlockSurface* surface;
+	int x;
+	int y;
+	int colorKey;
+	bool visible;
+} BlockLayer;
+
+/**
+ * Yhdist tasot (alin ensin) taustavrin plle pakattuun pintaan, jonka
+ * vritavut voi piirt suoraan ruudulle (drawScreenFromPackedSurface).
+ *
+ * Kompositori muistaa muuttuneen alueen: compositeLayers laskee uudelleen
+ * vain sen, joten muuttumattomat tasot ja alueet ohitetaan kokonaan. Tasoa
+ * muutettaessa on siksi kutsuttava markLayerChanged tai
+ * markLayerAreaChanged; sijainnin ja nkyvyyden muutokset merkitn itse.
+ */
+typedef struct Compositor {
+	PackedSurface* target;
+	int background;
+	int layerCount;
+	BlockLayer layers[MAX_LAYERS];
+
+	// Muuttunut alue palikkakoordinaateissa (x0, y0) - (x1, y1).
+	int dirtyX0, dirtyY0, dirtyX1, dirtyY1;
+} Compositor;
+
+void initCompositor(Compositor* c, PackedSurface* target, int background);
+
+/**
+ * Lis tason ylimmksi. Palauttaa tason numeron tai -1, jos tasoja on jo
+ * MAX_LAYERS.
+ */
+int addLayer(Compositor* c, BlockSurface* surface, int x, int y, int colorKey);
+
+void moveLayer(Compositor* c, int layer, int x, int y);
+void setLayerVisible(Compositor* c, int layer, bool b);
+
+void markLayerChanged(Compositor* c, int layer);
+// Alue tason omissa koordinaateissa.
+void markLayerAreaChanged(Compositor* c, int layer, int x, int y, int w, int h);
+void markCompositorDirty(Compositor* c, int x, int y, int w, int h);
+
+/**
+ * Laskee muuttuneen alueen uudelleen. Palauttaa false, jos mikn ei ollut
+ * muuttunut.
+ */
+bool compositeLayers(Compositor* c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,484 @@
+/**
+ * Piirtokomentolistat (ks. displist.h).
+ */
+
+#include "displist.h"
+#include "circle.h"
+#include "poly.h"
+#include "kernels.h"
+
+// Vlimuistipinnan vri palikoille, joihin lista ei piirr (vrit ovat 0-15).
+#define CACHE_KEY 16
+
+bool initDisplayList(DisplayList* l, int capacity, int textCapacity) {
+	l->commands = (DrawCommand*)malloc(capacity * sizeof(DrawCommand));
+	l->text = (char*)malloc(textCapacity);
+	if (l->commands == NULL || l->text == NULL) {
+		free(l->commands);
+		free(l->text);
+		l->commands = NULL;
+		l->text = NULL;
+		return false;
+	}
+	l->capacity = capacity;
+	l->textCapacity = textCapacity;
+	l->cache.pixels = NULL;
+	clearDisplayList(l);
+	return true;
+}
+
+static void dropCache(DisplayList* l) {
+	free(l->cache.pixels);
+	l->cache.pixels = NULL;
+}
+
+void freeDisplayList(DisplayList* l) {
+	dropCache(l);
+	free(l->commands);
+	free(l->text);
+	l->commands = NULL;
+	l->text = NULL;
+	l->capacity = 0;
+	l->count = 0;
+}
+
+void clearDisplayList(DisplayList* l) {
+	dropCache(l);
+	l->count = 0;
+	l->textSize = 0;
+	l->analyzed = false;
+	l->damageX0 = 0;
+	l->damageY0 = 0;
+	l->damageX1 = -1;
+	l->damageY1 = -1;
+	l->commandsDrawn = 0;
+}
+
+static DrawCommand* newCommand(DisplayList* l, int type, int color, int x0, int y0, int x1, int y1) {
+	DrawCommand* c;
+
+	if (l->count == l->capacity) {
+		return NULL;
+	}
+	dropCache(l);
+	l->analyzed = false;
+
+	c = &l->commands[l->count++];
+	c->type = type;
+	c->flags = 0;
+	c->color = color;
+	c->x0 = x0;
+	c->y0 = y0;
+	c->x1 = x1;
+	c->y1 = y1;
+	c->surface = NULL;
+	return c;
+}
+
+static void setParams(DrawCommand* c, int a, int b, int d, int e, int f, int g) {
+	c->p[0] = a;
+	c->p[1] = b;
+	c->p[2] = d;
+	c->p[3] = e;
+	c->p[4] = f;
+	c->p[5] = g;
+}
+
+/**
+ * Yritt yhdist tytetyn suorakaiteen listan viimeiseen komentoon: saman
+ * vrinen suorakaide, joka jatkaa sit vaaka- tai pystysuunnassa samalla
+ * leveydell tai on sen sisll.
+ */
+static bool mergeFillRect(DisplayList* l, int x0, int y0, int x1, int y1, int color) {
+	DrawCommand* c;
+
+	if (l->count == 0) {
+		return false;
+	}
+	c = &l->commands[l->count - 1];
+	if (c->type != CMD_FILL_RECT || c->color != (char)color) {
+		return false;
+	}
+
+	if (x0 >= c->x0 && x1 <= c->x1 && y0 >= c->y0 && y1 <= c->y1) {
+		return true;
+	}
+	if (y0 == c->y0 && y1 == c->y1 && x0 <= c->x1 + 1 && x1 >= c->x0 - 1) {
+		if (x0 < c->x0) { c->x0 = x0; }
+		if (x1 > c->x1) { c->x1 = x1; }
+	}
+	else if (x0 == c->x0 && x1 == c->x1 && y0 <= c->y1 + 1 && y1 >= c->y0 - 1) {
+		if (y0 < c->y0) { c->y0 = y0; }
+		if (y1 > c->y1) { c->y1 = y1; }
+	}
+	else {
+		return false;
+	}
+
+	setParams(c, c->x0, c->y0, c->x1 - c->x0 + 1, c->y1 - c->y0 + 1, 0, 0);
+	dropCache(l);
+	l->analyzed = false;
+	return true;
+}
+
+bool recordFillRect(DisplayList* l, int x, int y, int w, int h, int color) {
+	DrawCommand* c;
+
+	if (w <= 0 || h <= 0) {
+		return true;
+	}
+	if (mergeFillRect(l, x, y, x + w - 1, y + h - 1, color)) {
+		return true;
+	}
+	c = newCommand(l, CMD_FILL_RECT, color, x, y, x + w - 1, y + h - 1);
+	if (c == NULL) {
+		return false;
+	}
+	c->flags = CMD_OPAQUE;
+	setParams(c, x, y, w, h, 0, 0);
+	return true;
+}
+
+bool recordStrokeRect(DisplayList* l, int x, int y, int w, int h, int color) {
+	DrawCommand* c = newCommand(l, CMD_STROKE_RECT, color, x, y, x + w, y + h);
+	if (c == NULL) {
+		return false;
+	}
+	setParams(c, x, y, w, h, 0, 0);
+	return true;
+}
+
+bool recordLine(DisplayList* l, int x0, int y0, int x1, int y1, int color) {
+	DrawCommand* c = newCommand(l, CMD_LINE, color, (x0 < x1) ? x0 : x1, (y0 < y1) ? y0 : y1, (x0 < x1) ? x1 : x0, (y0 < y1) ? y1 : y0);
+	if (c == NULL) {
+		return false;
+	}
+	setParams(c, x0, y0, x1, y1, 0, 0);
+	return true;
+}
+
+static bool recordCircle(DisplayList* l, int type, int x, int y, int radius, int color) {
+	DrawCommand* c;
+
+	if (radius < 0) {
+		return true;
+	}
+	c = newCommand(l, type, color, x - radius, y - radius, x + radius, y + radius);
+	if (c == NULL) {
+		return false;
+	}
+	setParams(c, x, y, radius, 0, 0, 0);
+	return true;
+}
+
+bool recordFillCircle(DisplayList* l, int x, int y, int radius, int color) {
+	return recordCircle(l, CMD_FILL_CIRCLE, x, y, radius, color);
+}
+
+bool recordStrokeCircle(DisplayList* l, int x, int y, int radius, int color) {
+	return recordCircle(l, CMD_STROKE_CIRCLE, x, y, radius, color);
+}
+
+static int min3(int a, int b, int c) {
+	return (a < b) ? ((a < c) ? a : c) : ((b < c) ? b : c);
+}
+
+static int max3(int a, int b, int c) {
+	return (a > b) ? ((a > c) ? a : c) : ((b > c) ? b : c);
+}
+
+static bool recordTriangleCommand(DisplayList* l, int type, int x0, int y0, int x1, int y1, int x2, int y2, int color) {
+	DrawCommand* c = newCommand(l, type, color, min3(x0, x1, x2), min3(y0, y1, y2), max3(x0, x1, x2), max3(y0, y1, y2));
+	if (c == NULL) {
+		return false;
+	}
+	setParams(c, x0, y0, x1, y1, x2, y2);
+	return true;
+}
+
+bool recordTriangle(DisplayList* l, int x0, int y0, int x1, int y1, int x2, int y2, int color) {
+	return recordTriangleCommand(l, CMD_TRIANGLE, x0, y0, x1, y1, x2, y2, color);
+}
+
+bool recordFillTriangle(DisplayList* l, int x0, int y0, int x1, int y1, int x2, int y2, int color) {
+	return recordTriangleCommand(l, CMD_FILL_TRIANGLE, x0, y0, x1, y1, x2, y2, color);
+}
+
+/**
+ * Tekstin alueeksi arvioidaan ylrajat: merkki on enintn viisi palikkaa
+ * leve (ja vli yksi) ja rivi ulottuu rivilt y - 1 riville y + 5.
+ */
+bool recordText(DisplayList* l, int x, int y, const char* s, int color) {
+	DrawCommand* c;
+	int length = strlen(s), lines = 1, column = 0, maxColumn = 0, i;
+
+	if (length == 0) {
+		return true;
+	}
+	if (l->textSize + length + 1 > l->textCapacity || l->textSize > 0x7fff) {
+		return false;
+	}
+	for (i = 0; i < length; i++) {
+		if (s[i] == '\n') {
+			lines++;
+			column = 0;
+		}
+		else if (++column > maxColumn) {
+			maxColumn = column;
+		}
+	}
+
+	c = newCommand(l, CMD_TEXT, color, x, y - 1, x + maxColumn * 6 - 2, y + (lines - 1) * 6 + 5);
+	if (c == NULL) {
+		return false;
+	}
+	setParams(c, x, y, l->textSize, 0, 0, 0);
+	memcpy(l->text + l->textSize, s, length + 1);
+	l->textSize += length + 1;
+	return true;
+}
+
+static bool recordBlitCommand(DisplayList* l, int type, BlockSurface* src, int x, int y, int tpcolor) {
+	DrawCommand* c;
+
+	if (src->width <= 0 || src->height <= 0) {
+		return true;
+	}
+	c = newCommand(l, type, 0, x, y, x + src->width - 1, y + src->height - 1);
+	if (c == NULL) {
+		return false;
+	}
+	if (type == CMD_BLIT) {
+		c->flags = CMD_OPAQUE;
+	}
+	c->surface = src;
+	setParams(c, x, y, tpcolor, 0, 0, 0);
+	return true;
+}
+
+bool recordBlit(DisplayList* l, BlockSurface* src, int x, int y) {
+	return recordBlitCommand(l, CMD_BLIT, src, x, y, 0);
+}
+
+bool recordBlitTp(DisplayList* l, BlockSurface* src, int x, int y, int tpcolor) {
+	return recordBlitCommand(l, CMD_BLIT_TP, src, x, y, tpcolor);
+}
+
+/**
+ * Merkitsee peitetyiksi komennot, joiden alueen jokin myhempi peittv
+ * komento kattaa kokonaan. Lasketaan vain kerran listan muuttumisen jlkeen.
+ */
+static void analyze(DisplayList* l) {
+	DrawCommand* c;
+	DrawCommand* d;
+	int i, j;
+
+	for (i = 0; i < l->count; i++) {
+		c = &l->commands[i];
+		c->flags &= ~CMD_OCCLUDED;
+		for (j = l->count - 1; j > i; j--) {
+			d = &l->commands[j];
+			if ((d->flags & CMD_OPAQUE) && d->x0 <= c->x0 && d->x1 >= c->x1 && d->y0 <= c->y0 && d->y1 >= c->y1) {
+				c->flags |= CMD_OCCLUDED;
+				break;
+			}
+		}
+	}
+	l->analyzed = true;
+}
+
+/**
+ * Kopioi pinnan blockBufferiin leikkausalueen rajaamana.
+ */
+static void blitToClip(BlockSurface* src, int x, int y, int tpcolor) {
+	BlockSurface view;
+	int cx, cy, cw, ch;
+
+	getClipRect(&cx, &cy, &cw, &ch);
+	getClipSurface(&view);
+	if (tpcolor < 0) {
+		blitSurface(&view, x - cx, y - cy, src, 0, 0, src->width, src->height);
+	}
+	else {
+		blitSurfaceTp(&view, x - cx, y - cy, src, tpcolor);
+	}
+	markBlockBufferDirty(x, y, src->width, src->height);
+}
+
+static void addDamage(DisplayList* l, int x0, int y0, int x1, int y1) {
+	if (l->damageX0 > l->damageX1) {
+		l->damageX0 = x0;
+		l->damageY0 = y0;
+		l->damageX1 = x1;
+		l->damageY1 = y1;
+		return;
+	}
+	if (x0 < l->damageX0) { l->damageX0 = x0; }
+	if (y0 < l->damageY0) { l->damageY0 = y0; }
+	if (x1 > l->damageX1) { l->damageX1 = x1; }
+	if (y1 > l->damageY1) { l->damageY1 = y1; }
+}
+
+static void drawCommand(DisplayList* l, const DrawCommand* c) {
+	const short* p = c->p;
+
+	switch (c->type) {
+		case CMD_FILL_RECT:
+			fillRectToBlockBuffer(p[0], p[1], p[2], p[3], c->color);
+			break;
+		case CMD_STROKE_RECT:
+			strokeRectToBlockBuffer(p[0], p[1], p[2], p[3], c->color);
+			break;
+		case CMD_LINE:
+			lineToBlockBuffer(p[0], p[1], p[2], p[3], c->color);
+			break;
+		case CMD_FILL_CIRCLE:
+			fillCircleToBlockBuffer(p[0], p[1], p[2], c->color);
+			break;
+		case CMD_STROKE_CIRCLE:
+			strokeCircleToBlockBuffer(p[0], p[1], p[2], c->color);
+			break;
+		case CMD_TRIANGLE:
+			triangleToBlockBuffer(p[0], p[1], p[2], p[3], p[4], p[5], c->color);
+			break;
+		case CMD_FILL_TRIANGLE:
+			fillTriangleToBlockBuffer(p[0], p[1], p[2], p[3], p[4], p[5], c->color);
+			break;
+		case CMD_TEXT:
+			printLargeStringToBuffer(p[0], p[1], l->text + (unsigned short)p[2], c->color);
+			break;
+		case CMD_BLIT:
+			blitToClip(c->surface, p[0], p[1], -1);
+			break;
+		case CMD_BLIT_TP:
+			blitToClip(c->surface, p[0], p[1], p[2]);
+			break;
+	}
+}
+
+/**
+ * Piirt nkyvt komennot ja ker niiden alueet (leikkausalueen
+ * rajaamina) damage-kenttiin.
+ */
+static void drawCommands(DisplayList* l) {
+	const DrawCommand* c;
+	int cx0, cy0, cx1, cy1, w, h, i;
+
+	getClipRect(&cx0, &cy0, &w, &h);
+	cx1 = cx0 + w - 1;
+	cy1 = cy0 + h - 1;
+
+	if (!l->analyzed) {
+		analyze(l);
+	}
+	for (i = 0; i < l->count; i++) {
+		c = &l->commands[i];
+		if ((c->flags & CMD_OCCLUDED) || c->x1 < cx0 || c->x0 > cx1 || c->y1 < cy0 || c->y0 > cy1) {
+			continue;
+		}
+		drawCommand(l, c);
+		addDamage(l, (c->x0 > cx0) ? c->x0 : cx0, (c->y0 > cy0) ? c->y0 : cy0, (c->x1 < cx1) ? c->x1 : cx1, (c->y1 < cy1) ? c->y1 : cy1);
+		l->commandsDrawn++;
+	}
+}
+
+void drawDisplayList(DisplayList* l) {
+	const BlockKernels* kernels;
+	const char* src;
+	int x0, y0, x1, y1, w, h, j;
+
+	l->damageX0 = 0;
+	l->damageY0 = 0;
+	l->damageX1 = -1;
+	l->damageY1 = -1;
+	l->commandsDrawn = 0;
+
+	if (l->cache.pixels == NULL) {
+		drawCommands(l);
+		return;
+	}
+
+	// Vlimuisti kopioidaan leikkausalueen rajaamana riveittin; jos siin ei
+	// ole lpinkyvi palikoita, rivit kopioidaan suoraan.
+	getClipRect(&x0, &y0, &w, &h);
+	x1 = x0 + w - 1;
+	y1 = y0 + h - 1;
+	if (l->cacheX > x0) { x0 = l->cacheX; }
+	if (l->cacheY > y0) { y0 = l->cacheY; }
+	if (l->cacheX + l->cache.width - 1 < x1) { x1 = l->cacheX + l->cache.width - 1; }
+	if (l->cacheY + l->cache.height - 1 < y1) { y1 = l->cacheY + l->cache.height - 1; }
+	if (x0 > x1 || y0 > y1) {
+		return;
+	}
+
+	kernels = getBlockKernels();
+	src = l->cache.pixels + (y0 - l->cacheY) * l->cache.stride + x0 - l->cacheX;
+	for (j = y0; j <= y1; j++) {
+		if (l->cacheOpaque) {
+			memcpy(&blockColorBuffer[j][x0], src, x1 - x0 + 1);
+		}
+		else {
+			kernels->keyBlend(&blockColorBuffer[j][x0], src, CACHE_KEY, x1 - x0 + 1);
+		}
+		src += l->cache.stride;
+	}
+	markBlockBufferDirty(x0, y0, x1 - x0 + 1, y1 - y0 + 1);
+	addDamage(l, x0, y0, x1, y1);
+}
+
+/**
+ * Piirt listan blockColorBufferiin, jonka piirtoalue on ensin tytetty
+ * vrill CACHE_KEY, ja kopioi alueen vlimuistiin. blockColorBufferin
+ * sislt on sill vlin tallessa transformBufferissa.
+ */
+bool cacheDisplayList(DisplayList* l) {
+	char* pixels;
+	int x0, y0, x1, y1, w, h, j;
+
+	dropCache(l);
+	l->damageX0 = 0;
+	l->damageY0 = 0;
+	l->damageX1 = -1;
+	l->damageY1 = -1;
+
+	// Ruudun ulkopuolinen tai tyhj leikkausalue: vlimuistiin ei tule mitn.
+	getClipRect(&x0, &y0, &w, &h);
+	if (x0 < 0) { w += x0; x0 = 0; }
+	if (y0 < 0) { h += y0; y0 = 0; }
+	if (x0 + w > COLS) { w = COLS - x0; }
+	if (y0 + h > ROWS * 2) { h = ROWS * 2 - y0; }
+	if (w <= 0 || h <= 0) {
+		return true;
+	}
+
+	memcpy(transformBuffer, blockColorBuffer, sizeof(transformBuffer));
+	for (j = y0; j < y0 + h; j++) {
+		memset(&blockColorBuffer[j][x0], CACHE_KEY, w);
+	}
+	drawCommands(l);
+
+	x0 = l->damageX0;
+	y0 = l->damageY0;
+	x1 = l->damageX1;
+	y1 = l->damageY1;
+	pixels = NULL;
+	if (x0 <= x1) {
+		pixels = (char*)malloc((x1 - x0 + 1) * (y1 - y0 + 1));
+		if (pixels != NULL) {
+			initBlockSurface(&l->cache, x1 - x0 + 1, y1 - y0 + 1, pixels);
+			for (j = y0; j <= y1; j++) {
+				memcpy(pixels + (j - y0) * l->cache.stride, &blockColorBuffer[j][x0], l->cache.width);
+			}
+			l->cacheX = x0;
+			l->cacheY = y0;
+			l->cacheOpaque = memchr(pixels, CACHE_KEY, l->cache.width * l->cache.height) == NULL;
+		}
+	}
+	memcpy(blockColorBuffer, transformBuffer, sizeof(transformBuffer));
+
+	l->damageX0 = 0;
+	l->damageY0 = 0;
+	l->damageX1 = -1;
+	l->damageY1 = -1;
+	return pixels != NULL || x0 > x1;
+}
@@ -0,0 +1,112 @@
+#ifndef _DISPLIST_H
+#define _DISPLIST_H
+
+#include "surface.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Komentojen tyypit.
+#define CMD_FILL_RECT 0
+#define CMD_STROKE_RECT 1
+#define CMD_LINE 2
+#define CMD_FILL_CIRCLE 3
+#define CMD_STROKE_CIRCLE 4
+#define CMD_TRIANGLE 5
+#define CMD_FILL_TRIANGLE 6
+#define CMD_TEXT 7
+#define CMD_BLIT 8
+#define CMD_BLIT_TP 9
+
+// Komennon liput: peitt rajauksensa kokonaan / j kokonaan peittoon.
+#define CMD_OPAQUE 1
+#define CMD_OCCLUDED 2
+
+/**
+ * Tallennettu piirtokomento. p sislt komennon parametrit (esim.
+ * suorakaiteelle x, y, w, h ja kolmiolle krkipisteet) ja x0, y0, x1, y1
+ * alueen, johon komento voi piirt (reunat mukaan luettuina). Teksti on
+ * listan omassa merkkipuskurissa kohdassa p[2], pinta osoitteessa surface.
+ */
+typedef struct DrawCommand {
+	unsigned char type;
+	unsigned char flags;
+	char color;
+	short p[6];
+	short x0, y0, x1, y1;
+	BlockSurface* surface;
+} DrawCommand;
+
+/**
+ * Piirtokomentolista. Komennot tallennetaan record-funktioilla ja
+ * piirretn blockBufferiin drawDisplayListill; samaa listaa voi piirt
+ * uudelleen joka ruudulla.
+ *
+ * Piirrettess ohitetaan leikkausalueen (ks. pushClipRect) ulkopuolelle
+ * jvt komennot sek komennot, jotka myhempi peittv komento
+ * (tytetty suorakaide tai lpinkymtn pinta) peitt kokonaan.
+ * Perkkiset saman vriset toisiinsa liittyvt tytetyt suorakaiteet
+ * yhdistetn jo tallennettaessa.
+ *
+ * cacheDisplayList piirt listan kerran omaan pintaansa, mink jlkeen
+ * drawDisplayList vain kopioi sen (esim. muuttumaton kyttliittym).
+ * Vlimuisti hyltn, kun listaan tallennetaan; jos listan pinnat
+ * muuttuvat, cacheDisplayList on kutsuttava uudelleen.
+ *
+ * Viimeisimmss drawDisplayListiss piirretty alue on damageX0 ...
+ * damageX1, damageY0 ... damageY1 (tyhj, jos damageX0 > damageX1).
+ */
+typedef struct DisplayList {
+	int count;
+	int capacity;
+	DrawCommand* commands;
+	int textSize;
+	int textCapacity;
+	char* text;
+	bool analyzed;
+
+	BlockSurface cache;
+	int cacheX;
+	int cacheY;
+	bool cacheOpaque;
+
+	int damageX0, damageY0, damageX1, damageY1;
+	int commandsDrawn;
+} DisplayList;
+
+bool initDisplayList(DisplayList* l, int capacity, int textCapacity);
+void freeDisplayList(DisplayList* l);
+void clearDisplayList(DisplayList* l);
+
+/**
+ * Tallentavat komennon listaan; parametrit kuten vastaavilla
+ * ...ToBlockBuffer-funktioilla. Palauttavat false, jos lista on tynn.
+ * Koordinaattien on mahduttava shortiin.
+ */
+bool recordFillRect(DisplayList* l, int x, int y, int w, int h, int color);
+bool recordStrokeRect(DisplayList* l, int x, int y, int w, int h, int color);
+bool recordLine(DisplayList* l, int x0, int y0, int x1, int y1, int color);
+bool recordFillCircle(DisplayList* l, int x, int y, int radius, int color);
+bool recordStrokeCircle(DisplayList* l, int x, int y, int radius, int color);
+bool recordTriangle(DisplayList* l, int x0, int y0, int x1, int y1, int x2, int y2, int color);
+bool recordFillTriangle(DisplayList* l, int x0, int y0, int x1, int y1, int x2, int y2, int color);
+// Suuri teksti (printLargeStringToBuffer); merkkijono kopioidaan listaan.
+bool recordText(DisplayList* l, int x, int y, const char* s, int color);
+// Pinta piirretn listaa suoritettaessa, joten sen on oltava silloin tallessa.
+bool recordBlit(DisplayList* l, BlockSurface* src, int x, int y);
+bool recordBlitTp(DisplayList* l, BlockSurface* src, int x, int y, int tpcolor);
+
+void drawDisplayList(DisplayList* l);
+
+/**
+ * Piirt listan vlimuistiinsa (nykyisen leikkausalueen rajaamana).
+ * Palauttaa false, jos muisti ei riit.
+ */
+bool cacheDisplayList(DisplayList* l);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,291 @@
+/**
+ * Aluetytt (ks. flood.h).
+ *
+ * Pinossa on tytettyj ptki: rivin y palikat x0 ... x1 on tytetty ja
+ * rivilt y + dy etsitn niihin liittyvt palikat (8-yhtenisyydell mys
+ * kulmittain, eli palikkaa levemmlt vlilt). Lydetty ptk tytetn
+ * kerralla memsetill ja laitetaan pinoon samaan suuntaan jatkettavaksi.
+ * Jos ptk ulottuu edeltjns pidemmlle, ylimenev osa tutkitaan mys
+ * takaisinpin, koska sielt alue voi knty U:n muotoisesti.
+ *
+ * Tytetyt palikat merkitn ensin vrill FLOOD_MARK, joka ei voi olla
+ * pinnalla valmiina. Merkki erottaa tytetyn alueen sek kuviotytss
+ * ett pinon tyttyess, ja lopuksi merkityt palikat vritetn alueen
+ * rajaavan suorakaiteen sislt.
+ */
+
+#include "flood.h"
+
+#define FLOOD_MARK 16
+
+typedef struct FloodSpan {
+	short x0;
+	short x1;
+	short y;
+	short dy;
+} FloodSpan;
+
+static FloodSpan floodStack[FLOOD_STACK_SIZE];
+static int floodTop;
+static bool floodOverflow;
+
+// Kynniss olevan tytn tiedot.
+static BlockSurface* target;
+static int targetColor;
+static int borderColor;
+static int reach;
+static int filled;
+static int minX, minY, maxX, maxY;
+
+#define INSIDE(v) ((borderColor < 0) ? (v) == targetColor : ((v) != borderColor && (v) != FLOOD_MARK))
+
+static void push(int x0, int x1, int y, int dy) {
+	if (y + dy < 0 || y + dy >= target->height) {
+		return;
+	}
+	if (floodTop == FLOOD_STACK_SIZE) {
+		floodOverflow = true;
+		return;
+	}
+	floodStack[floodTop].x0 = x0;
+	floodStack[floodTop].x1 = x1;
+	floodStack[floodTop].y = y;
+	floodStack[floodTop].dy = dy;
+	floodTop++;
+}
+
+/**
+ * Tytt rivin y ptkn, johon palikka x kuuluu. Palauttaa ptkn
+ * viimeisen palikan; ensimminen *start:iin.
+ */
+static int fillRun(char* row, int x, int y, int* start) {
+	int rs = x;
+
+	while (rs > 0 && INSIDE(row[rs - 1])) {
+		rs--;
+	}
+	while (x < target->width && INSIDE(row[x])) {
+		x++;
+	}
+	memset(row + rs, FLOOD_MARK, x - rs);
+
+	filled += x - rs;
+	if (rs < minX) { minX = rs; }
+	if (x - 1 > maxX) { maxX = x - 1; }
+	if (y < minY) { minY = y; }
+	if (y > maxY) { maxY = y; }
+
+	*start = rs;
+	return x - 1;
+}
+
+static void seed(int x, int y) {
+	int rs, re;
+
+	re = fillRun(target->pixels + y * target->stride, x, y, &rs);
+	push(rs, re, y, 1);
+	push(rs, re, y, -1);
+}
+
+/**
+ * Psilmukka. Tytn tiedot luetaan paikallisiin muuttujiin, koska
+ * palikoiden kirjoitukset char-osoittimen kautta pakottaisivat muuten
+ * lukemaan staattiset muuttujat uudelleen jokaisen palikan kohdalla.
+ */
+static void scan(void) {
+	FloodSpan sp;
+	char* const pixels = target->pixels;
+	const int width = target->width, stride = target->stride;
+	const int t = targetColor, border = borderColor, e = reach;
+	char* row;
+	int y, x, lo, hi, rs, re;
+
+	while (floodTop > 0) {
+		sp = floodStack[--floodTop];
+		y = sp.y + sp.dy;
+		row = pixels + y * stride;
+		lo = sp.x0 - e;
+		hi = sp.x1 + e;
+		if (lo < 0) { lo = 0; }
+		if (hi >= width) { hi = width - 1; }
+
+		for (x = lo; x <= hi; x++) {
+			if (border < 0 ? row[x] != t : (row[x] == border || row[x] == FLOOD_MARK)) {
+				continue;
+			}
+
+			rs = x;
+			if (border < 0) {
+				while (rs > 0 && row[rs - 1] == t) { rs--; }
+				while (x < width && row[x] == t) { x++; }
+			}
+			else {
+				while (rs > 0 && row[rs - 1] != border && row[rs - 1] != FLOOD_MARK) { rs--; }
+				while (x < width && row[x] != border && row[x] != FLOOD_MARK) { x++; }
+			}
+			// Lyhyet ptkt (esim. shakkilauta) suoraan, pitkt memsetill.
+			re = x - 1;
+			if (re - rs < 8) {
+				for (x = rs; x <= re; x++) {
+					row[x] = FLOOD_MARK;
+				}
+			}
+			else {
+				memset(row + rs, FLOOD_MARK, x - rs);
+			}
+
+			filled += x - rs;
+			if (rs < minX) { minX = rs; }
+			if (re > maxX) { maxX = re; }
+			if (y < minY) { minY = y; }
+			if (y > maxY) { maxY = y; }
+
+			push(rs, re, y, sp.dy);
+			if (rs < sp.x0) {
+				push(rs, (re < sp.x0 - 1) ? re : sp.x0 - 1, y, -sp.dy);
+			}
+			if (re > sp.x1) {
+				push((rs > sp.x1 + 1) ? rs : sp.x1 + 1, re, y, -sp.dy);
+			}
+		}
+	}
+}
+
+static bool markedNeighbour(int x, int y) {
+	int i, j;
+
+	for (j = y - 1; j <= y + 1; j++) {
+		for (i = x - 1; i <= x + 1; i++) {
+			if ((unsigned)i >= (unsigned)target->width || (unsigned)j >= (unsigned)target->height) {
+				continue;
+			}
+			if (reach == 0 && i != x && j != y) {
+				continue;
+			}
+			if (target->pixels[j * target->stride + i] == FLOOD_MARK) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+/**
+ * Pinon tytytty jatketaan palikoista, jotka ovat alueessa ja tytetyn
+ * palikan vieress, kunnes yksikn kierros ei en tyt pinoa.
+ */
+static void recover(void) {
+	int x, y, x0, y0, x1, y1;
+
+	while (floodOverflow) {
+		floodOverflow = false;
+		x0 = (minX > 0) ? minX - 1 : 0;
+		y0 = (minY > 0) ? minY - 1 : 0;
+		x1 = (maxX < target->width - 1) ? maxX + 1 : target->width - 1;
+		y1 = (maxY < target->height - 1) ? maxY + 1 : target->height - 1;
+		for (y = y0; y <= y1; y++) {
+			for (x = x0; x <= x1; x++) {
+				if (INSIDE(target->pixels[y * target->stride + x]) && markedNeighbour(x, y)) {
+					seed(x, y);
+					scan();
+				}
+			}
+		}
+	}
+}
+
+/**
+ * Vritetn merkityt palikat: yksi vri, tai kuvio, jonka (0, 0) on pinnan
+ * kohdassa (-ox, -oy).
+ */
+static void paint(int color, const BlockSurface* pattern, int ox, int oy) {
+	const char* p;
+	char* row;
+	int x, y, px;
+
+	for (y = minY; y <= maxY; y++) {
+		row = target->pixels + y * target->stride;
+		if (pattern == NULL) {
+			for (x = minX; x <= maxX; x++) {
+				if (row[x] == FLOOD_MARK) {
+					row[x] = color;
+				}
+			}
+		}
+		else {
+			p = pattern->pixels + ((y + oy) % pattern->height) * pattern->stride;
+			px = (minX + ox) % pattern->width;
+			for (x = minX; x <= maxX; x++) {
+				if (row[x] == FLOOD_MARK) {
+					row[x] = p[px];
+				}
+				if (++px == pattern->width) {
+					px = 0;
+				}
+			}
+		}
+	}
+}
+
+static int fill(BlockSurface* s, int x, int y, int color, const BlockSurface* pattern, int ox, int oy, int connectivity, int border) {
+	int v;
+
+	if ((unsigned)x >= (unsigned)s->width || (unsigned)y >= (unsigned)s->height) {
+		return 0;
+	}
+	v = s->pixels[y * s->stride + x];
+	if ((border < 0 && pattern == NULL && v == color) || v == FLOOD_MARK || v == border) {
+		return 0;
+	}
+
+	target = s;
+	targetColor = v;
+	borderColor = border;
+	reach = (connectivity == FLOOD_8) ? 1 : 0;
+	filled = 0;
+	minX = x;
+	minY = y;
+	maxX = x;
+	maxY = y;
+	floodTop = 0;
+	floodOverflow = false;
+
+	seed(x, y);
+	scan();
+	recover();
+	paint(color, pattern, ox, oy);
+
+	if (s->pixels == (char*)blockColorBuffer) {
+		markBlockBufferDirty(minX, minY, maxX - minX + 1, maxY - minY + 1);
+	}
+	return filled;
+}
+
+int floodFillSurface(BlockSurface* s, int x, int y, int color, int connectivity, int border) {
+	return fill(s, x, y, color, NULL, 0, 0, connectivity, border);
+}
+
+int patternFillSurface(BlockSurface* s, int x, int y, const BlockSurface* pattern, int connectivity, int border) {
+	return fill(s, x, y, 0, pattern, 0, 0, connectivity, border);
+}
+
+static int fillBlockBuffer(int x, int y, int color, const BlockSurface* pattern, int connectivity, int border) {
+	BlockSurface view;
+	int cx, cy, cw, ch, n;
+
+	getClipRect(&cx, &cy, &cw, &ch);
+	getClipSurface(&view);
+	n = fill(&view, x - cx, y - cy, color, pattern, cx, cy, connectivity, border);
+	if (n > 0) {
+		markBlockBufferDirty(minX + cx, minY + cy, maxX - minX + 1, maxY - minY + 1);
+	}
+	return n;
+}
+
+int floodFillBlockBuffer(int x, int y, int color, int connectivity, int border) {
+	return fillBlockBuffer(x, y, color, NULL, connectivity, border);
+}
+
+int patternFillBlockBuffer(int x, int y, const BlockSurface* pattern, int connectivity, int border) {
+	return fillBlockBuffer(x, y, 0, pattern, connectivity, border);
+}
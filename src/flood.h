@@ -0,0 +1,46 @@
+#ifndef _FLOOD_H
+#define _FLOOD_H
+
+#include "surface.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Yhtenisyys: naapureina vain sivut (4) tai mys kulmat (8).
+#define FLOOD_4 4
+#define FLOOD_8 8
+
+// Rajavrin paikalla: tytetn aloituspisteen vrinen alue.
+#define NO_BORDER -1
+
+// Tytn pinon koko (odottavia palikkaptki).
+#define FLOOD_STACK_SIZE 4096
+
+/**
+ * Tytt pinnan yhtenisen alueen, johon (x, y) kuuluu. Jos border on
+ * NO_BORDER, alue on aloituspisteen vrisi palikoita; muuten alueeseen
+ * kuuluvat kaikki palikat, jotka eivt ole border-vrisi.
+ *
+ * Tytt etenee riveittin palikkaptkin ja odottavat ptkt ovat
+ * kiinten kokoisessa pinossa, joten rekursiota ei ole. Jos pino tyttyy,
+ * tytt jatketaan etsimll tytetyn alueen reunoilta palikat, joihin ei
+ * viel ehditty. Palauttaa tytettyjen palikoiden mrn.
+ */
+int floodFillSurface(BlockSurface* s, int x, int y, int color, int connectivity, int border);
+
+/**
+ * Kuten floodFillSurface, mutta alue tytetn kuviolla: palikka (x, y)
+ * saa kuviopinnan palikan (x % leveys, y % korkeus) vrin.
+ */
+int patternFillSurface(BlockSurface* s, int x, int y, const BlockSurface* pattern, int connectivity, int border);
+
+// blockBufferiin leikkausalueen (ks. pushClipRect) rajaamana.
+int floodFillBlockBuffer(int x, int y, int color, int connectivity, int border);
+int patternFillBlockBuffer(int x, int y, const BlockSurface* pattern, int connectivity, int border);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
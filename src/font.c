@@ -0,0 +1,258 @@
+/**
+ * Iso 3x5-fontti (ks. font.h).
+ *
+ * Merkit on knnetty valmiiksi rivikohtaisiksi bittimaskeiksi. Piirtoa
+ * varten kunkin rivin bitit muutetaan kerran palikkajonoiksi (alku ja
+ * pituus); skaalatessa jonot vain kerrotaan kertoimella.
+ */
+
+#include "font.h"
+
+#define GLYPHS (LARGE_FONT_LAST - LARGE_FONT_FIRST + 1)
+#define MAX_RUNS 3
+
+const LargeGlyph largeFont[GLYPHS] = {
+	{ 0, 3, 5, { 0x00, 0x00, 0x00, 0x00, 0x00 } },	// ' '
+	{ 0, 1, 5, { 0x01, 0x01, 0x01, 0x00, 0x01 } },	// '!'
+	{ 0, 3, 5, { 0x05, 0x05, 0x00, 0x00, 0x00 } },	// '"'
+	{ 0, 5, 5, { 0x0a, 0x1f, 0x0a, 0x1f, 0x0a } },	// '#'
+	{ -1, 3, 7, { 0x02, 0x07, 0x04, 0x07, 0x01, 0x07, 0x02 } },	// '$'
+	{ 0, 3, 5, { 0x04, 0x01, 0x02, 0x04, 0x01 } },	// '%'
+	{ 0, 3, 5, { 0x02, 0x05, 0x02, 0x05, 0x03 } },	// '&'
+	{ 0, 1, 5, { 0x01, 0x01, 0x00, 0x00, 0x00 } },	// '\''
+	{ 0, 3, 5, { 0x01, 0x02, 0x02, 0x02, 0x01 } },	// '('
+	{ 0, 3, 5, { 0x04, 0x02, 0x02, 0x02, 0x04 } },	// ')'
+	{ 0, 3, 5, { 0x00, 0x05, 0x02, 0x05, 0x00 } },	// '*'
+	{ 0, 3, 5, { 0x00, 0x02, 0x07, 0x02, 0x00 } },	// '+'
+	{ 0, 1, 6, { 0x00, 0x00, 0x00, 0x00, 0x01, 0x01 } },	// ','
+	{ 0, 3, 5, { 0x00, 0x00, 0x07, 0x00, 0x00 } },	// '-'
+	{ 0, 1, 5, { 0x00, 0x00, 0x00, 0x00, 0x01 } },	// '.'
+	{ 0, 3, 5, { 0x01, 0x01, 0x02, 0x04, 0x04 } },	// '/'
+	{ 0, 3, 5, { 0x07, 0x05, 0x05, 0x05, 0x07 } },	// '0'
+	{ 0, 3, 5, { 0x02, 0x06, 0x02, 0x02, 0x02 } },	// '1'
+	{ 0, 3, 5, { 0x07, 0x01, 0x07, 0x04, 0x07 } },	// '2'
+	{ 0, 3, 5, { 0x07, 0x01, 0x07, 0x01, 0x07 } },	// '3'
+	{ 0, 3, 5, { 0x05, 0x05, 0x07, 0x01, 0x01 } },	// '4'
+	{ 0, 3, 5, { 0x07, 0x04, 0x07, 0x01, 0x07 } },	// '5'
+	{ 0, 3, 5, { 0x07, 0x04, 0x07, 0x05, 0x07 } },	// '6'
+	{ 0, 3, 5, { 0x07, 0x01, 0x01, 0x01, 0x01 } },	// '7'
+	{ 0, 3, 5, { 0x07, 0x05, 0x07, 0x05, 0x07 } },	// '8'
+	{ 0, 3, 5, { 0x07, 0x05, 0x07, 0x01, 0x01 } },	// '9'
+	{ 0, 3, 5, { 0x00, 0x02, 0x00, 0x02, 0x00 } },	// ':'
+	{ 0, 3, 5, { 0x00, 0x02, 0x00, 0x02, 0x02 } },	// ';'
+	{ 0, 3, 5, { 0x01, 0x02, 0x04, 0x02, 0x01 } },	// '<'
+	{ 0, 3, 5, { 0x00, 0x07, 0x00, 0x07, 0x00 } },	// '='
+	{ 0, 3, 5, { 0x04, 0x02, 0x01, 0x02, 0x04 } },	// '>'
+	{ 0, 3, 5, { 0x07, 0x01, 0x02, 0x00, 0x02 } },	// '?'
+	{ 0, 3, 5, { 0x07, 0x07, 0x07, 0x04, 0x07 } },	// '@'
+	{ 0, 3, 5, { 0x07, 0x05, 0x07, 0x05, 0x05 } },	// 'A'
+	{ 0, 3, 5, { 0x06, 0x05, 0x06, 0x05, 0x06 } },	// 'B'
+	{ 0, 3, 5, { 0x07, 0x04, 0x04, 0x04, 0x07 } },	// 'C'
+	{ 0, 3, 5, { 0x06, 0x05, 0x05, 0x05, 0x06 } },	// 'D'
+	{ 0, 3, 5, { 0x07, 0x04, 0x07, 0x04, 0x07 } },	// 'E'
+	{ 0, 3, 5, { 0x07, 0x04, 0x06, 0x04, 0x04 } },	// 'F'
+	{ 0, 3, 5, { 0x07, 0x04, 0x05, 0x05, 0x07 } },	// 'G'
+	{ 0, 3, 5, { 0x05, 0x05, 0x07, 0x05, 0x05 } },	// 'H'
+	{ 0, 3, 5, { 0x07, 0x02, 0x02, 0x02, 0x07 } },	// 'I'
+	{ 0, 3, 5, { 0x01, 0x01, 0x01, 0x05, 0x07 } },	// 'J'
+	{ 0, 3, 5, { 0x05, 0x05, 0x06, 0x05, 0x05 } },	// 'K'
+	{ 0, 3, 5, { 0x04, 0x04, 0x04, 0x04, 0x07 } },	// 'L'
+	{ 0, 5, 5, { 0x1f, 0x15, 0x15, 0x11, 0x11 } },	// 'M'
+	{ 0, 3, 5, { 0x06, 0x05, 0x05, 0x05, 0x05 } },	// 'N'
+	{ 0, 3, 5, { 0x07, 0x05, 0x05, 0x05, 0x07 } },	// 'O'
+	{ 0, 3, 5, { 0x07, 0x05, 0x07, 0x04, 0x04 } },	// 'P'
+	{ 0, 3, 6, { 0x07, 0x05, 0x05, 0x05, 0x07, 0x01 } },	// 'Q'
+	{ 0, 3, 5, { 0x06, 0x05, 0x06, 0x05, 0x05 } },	// 'R'
+	{ 0, 3, 5, { 0x07, 0x04, 0x07, 0x01, 0x07 } },	// 'S'
+	{ 0, 3, 5, { 0x07, 0x02, 0x02, 0x02, 0x02 } },	// 'T'
+	{ 0, 3, 5, { 0x05, 0x05, 0x05, 0x05, 0x07 } },	// 'U'
+	{ 0, 3, 5, { 0x05, 0x05, 0x05, 0x05, 0x02 } },	// 'V'
+	{ 0, 5, 5, { 0x11, 0x11, 0x15, 0x15, 0x1f } },	// 'W'
+	{ 0, 3, 5, { 0x05, 0x05, 0x02, 0x05, 0x05 } },	// 'X'
+	{ 0, 3, 5, { 0x05, 0x05, 0x02, 0x02, 0x02 } },	// 'Y'
+	{ 0, 3, 5, { 0x07, 0x01, 0x02, 0x04, 0x07 } },	// 'Z'
+	{ 0, 2, 5, { 0x03, 0x02, 0x02, 0x02, 0x03 } },	// '['
+	{ 0, 3, 5, { 0x04, 0x04, 0x02, 0x01, 0x01 } },	// '\\'
+	{ 0, 2, 5, { 0x03, 0x01, 0x01, 0x01, 0x03 } },	// ']'
+	{ 0, 3, 5, { 0x02, 0x05, 0x00, 0x00, 0x00 } },	// '^'
+	{ 0, 3, 5, { 0x00, 0x00, 0x00, 0x00, 0x07 } },	// '_'
+	{ 0, 2, 5, { 0x02, 0x01, 0x00, 0x00, 0x00 } },	// '`'
+	{ 0, 3, 5, { 0x00, 0x03, 0x05, 0x05, 0x03 } },	// 'a'
+	{ 0, 3, 5, { 0x04, 0x06, 0x05, 0x05, 0x06 } },	// 'b'
+	{ 0, 3, 5, { 0x00, 0x03, 0x04, 0x04, 0x03 } },	// 'c'
+	{ 0, 3, 5, { 0x01, 0x03, 0x05, 0x05, 0x03 } },	// 'd'
+	{ 0, 3, 5, { 0x00, 0x02, 0x07, 0x04, 0x03 } },	// 'e'
+	{ 0, 3, 5, { 0x03, 0x02, 0x07, 0x02, 0x02 } },	// 'f'
+	{ 0, 3, 6, { 0x00, 0x03, 0x05, 0x03, 0x01, 0x06 } },	// 'g'
+	{ 0, 3, 5, { 0x04, 0x06, 0x05, 0x05, 0x05 } },	// 'h'
+	{ 0, 1, 5, { 0x01, 0x00, 0x01, 0x01, 0x01 } },	// 'i'
+	{ 0, 2, 6, { 0x01, 0x00, 0x01, 0x01, 0x01, 0x02 } },	// 'j'
+	{ 0, 3, 5, { 0x04, 0x05, 0x06, 0x06, 0x05 } },	// 'k'
+	{ 0, 2, 5, { 0x03, 0x01, 0x01, 0x01, 0x01 } },	// 'l'
+	{ 0, 5, 5, { 0x00, 0x1a, 0x15, 0x15, 0x15 } },	// 'm'
+	{ 0, 3, 5, { 0x00, 0x06, 0x05, 0x05, 0x05 } },	// 'n'
+	{ 0, 3, 5, { 0x00, 0x02, 0x05, 0x05, 0x02 } },	// 'o'
+	{ 0, 3, 6, { 0x00, 0x06, 0x05, 0x05, 0x06, 0x04 } },	// 'p'
+	{ 0, 3, 6, { 0x00, 0x03, 0x05, 0x05, 0x03, 0x01 } },	// 'q'
+	{ 0, 3, 5, { 0x00, 0x05, 0x06, 0x04, 0x04 } },	// 'r'
+	{ 0, 3, 5, { 0x00, 0x03, 0x06, 0x03, 0x06 } },	// 's'
+	{ 0, 3, 5, { 0x02, 0x07, 0x02, 0x02, 0x03 } },	// 't'
+	{ 0, 3, 5, { 0x00, 0x05, 0x05, 0x05, 0x03 } },	// 'u'
+	{ 0, 3, 5, { 0x00, 0x05, 0x05, 0x05, 0x02 } },	// 'v'
+	{ 0, 5, 5, { 0x00, 0x11, 0x15, 0x15, 0x0a } },	// 'w'
+	{ 0, 3, 5, { 0x00, 0x05, 0x02, 0x02, 0x05 } },	// 'x'
+	{ 0, 3, 6, { 0x00, 0x05, 0x05, 0x03, 0x01, 0x06 } },	// 'y'
+	{ 0, 3, 5, { 0x00, 0x07, 0x01, 0x02, 0x07 } },	// 'z'
+	{ 0, 3, 5, { 0x03, 0x02, 0x06, 0x02, 0x03 } },	// '{'
+	{ 0, 1, 5, { 0x01, 0x01, 0x01, 0x01, 0x01 } },	// '|'
+	{ 0, 3, 5, { 0x06, 0x02, 0x03, 0x02, 0x06 } },	// '}'
+	{ 0, 3, 5, { 0x00, 0x03, 0x06, 0x00, 0x00 } }	// '~'
+};
+
+// Tuntemattomien merkkien laatikko.
+static const LargeGlyph unknownGlyph = { 0, 3, 5, { 0x07, 0x07, 0x07, 0x07, 0x07 } };
+
+typedef struct GlyphRuns {
+	unsigned char count[LARGE_GLYPH_ROWS];
+	unsigned char start[LARGE_GLYPH_ROWS][MAX_RUNS];
+	unsigned char length[LARGE_GLYPH_ROWS][MAX_RUNS];
+} GlyphRuns;
+
+// Viimeinen on unknownGlyphin.
+static GlyphRuns glyphRuns[GLYPHS + 1];
+static bool glyphRunsReady = false;
+
+const LargeGlyph* getLargeGlyph(char a) {
+	unsigned i = (unsigned char)a - LARGE_FONT_FIRST;
+	return (i < GLYPHS) ? &largeFont[i] : &unknownGlyph;
+}
+
+static void buildRuns(const LargeGlyph* g, GlyphRuns* r) {
+	int i, x, n;
+	unsigned bit;
+
+	for (i = 0; i < g->height; i++) {
+		n = 0;
+		x = 0;
+		while (x < g->width) {
+			bit = 1u << (g->width - 1 - x);
+			if (g->rows[i] & bit) {
+				r->start[i][n] = x;
+				while (x < g->width && (g->rows[i] & (1u << (g->width - 1 - x)))) {
+					x++;
+				}
+				r->length[i][n] = x - r->start[i][n];
+				n++;
+			}
+			else {
+				x++;
+			}
+		}
+		r->count[i] = n;
+	}
+}
+
+static void prepareRuns(void) {
+	int i;
+
+	for (i = 0; i < GLYPHS; i++) {
+		buildRuns(&largeFont[i], &glyphRuns[i]);
+	}
+	buildRuns(&unknownGlyph, &glyphRuns[GLYPHS]);
+	glyphRunsReady = true;
+}
+
+/**
+ * Piirt merkin leikkausalueeseen x0 ... x1, y0 ... y1 merkitsemtt sit
+ * muuttuneeksi. Palauttaa merkin leveyden.
+ */
+static int drawGlyph(int x, int y, const LargeGlyph* g, int c, int scale, int x0, int y0, int x1, int y1) {
+	const GlyphRuns* r;
+	char* row;
+	int top, i, j, j0, j1, k, s, e, n;
+	unsigned m;
+
+	top = y + g->top * scale;
+
+	// Skaalaamaton, kokonaan leikkausalueen sisll oleva merkki suoraan
+	// bittimaskeista.
+	if (scale == 1 && x >= x0 && x + g->width - 1 <= x1 && top >= y0 && top + g->height - 1 <= y1) {
+		for (i = 0; i < g->height; i++) {
+			row = blockColorBuffer[top + i] + x;
+			for (m = g->rows[i], k = g->width - 1; m != 0; k--) {
+				if (m & (1u << k)) {
+					row[g->width - 1 - k] = c;
+					m &= ~(1u << k);
+				}
+			}
+		}
+		return g->width;
+	}
+
+	if (!glyphRunsReady) {
+		prepareRuns();
+	}
+	r = &glyphRuns[(g == &unknownGlyph) ? GLYPHS : g - largeFont];
+
+	for (i = 0; i < g->height; i++) {
+		j0 = top + i * scale;
+		j1 = j0 + scale - 1;
+		if (j0 < y0) { j0 = y0; }
+		if (j1 > y1) { j1 = y1; }
+
+		for (k = 0; k < r->count[i]; k++) {
+			s = x + r->start[i][k] * scale;
+			e = s + r->length[i][k] * scale - 1;
+			if (s < x0) { s = x0; }
+			if (e > x1) { e = x1; }
+			n = e - s + 1;
+			if (n <= 0) {
+				continue;
+			}
+			for (j = j0; j <= j1; j++) {
+				memset(blockColorBuffer[j] + s, c, n);
+			}
+		}
+	}
+	return g->width * scale;
+}
+
+int printScaledCharToBuffer(int x, int y, char a, int c, int scale) {
+	const LargeGlyph* g = getLargeGlyph(a);
+	int cx, cy, cw, ch;
+
+	if (scale < 1 || scale > MAX_FONT_SCALE) {
+		return 0;
+	}
+	getClipRect(&cx, &cy, &cw, &ch);
+	drawGlyph(x, y, g, c, scale, cx, cy, cx + cw - 1, cy + ch - 1);
+	markBlockBufferDirty(x, y + g->top * scale, g->width * scale, g->height * scale);
+	return g->width * scale;
+}
+
+/**
+ * Leikkausalue haetaan kerran ja muuttunut alue merkitn riveittin
+ * (merkit ulottuvat riveille y - 1 ... y + 5).
+ */
+void printScaledStringToBuffer(int x, int y, const char* s, int c, int scale) {
+	int cx, cy, cw, ch, currentX = x;
+
+	if (scale < 1 || scale > MAX_FONT_SCALE) {
+		return;
+	}
+	getClipRect(&cx, &cy, &cw, &ch);
+
+	for (;; s++) {
+		if (*s == '\n' || *s == '\0') {
+			markBlockBufferDirty(x, y - scale, currentX - x, 7 * scale);
+			if (*s == '\0') {
+				break;
+			}
+			currentX = x;
+			y += 6 * scale;
+		}
+		else {
+			currentX += drawGlyph(currentX, y, getLargeGlyph(*s), c, scale, cx, cy, cx + cw - 1, cy + ch - 1) + scale;
+		}
+	}
+}
@@ -0,0 +1,51 @@
+#ifndef _FONT_H
+#define _FONT_H
+
+#include "txtgfx.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Ison fontin merkit: ASCII 32-126. Muut merkit piirretn tyten laatikkona.
+#define LARGE_FONT_FIRST 32
+#define LARGE_FONT_LAST 126
+#define LARGE_GLYPH_ROWS 7
+
+// Suurin skaalauskerroin (printScaledCharToBuffer).
+#define MAX_FONT_SCALE 16
+
+/**
+ * Ison fontin merkki. Rivi i on kohdassa y + top + i, ja rivin palikat
+ * ovat rows[i]:n bittein vasemmalta oikealle (ylin kytetty bitti on
+ * vasen sarake, ks. width). Merkkien vli on yksi palikka ja rivien kuusi.
+ */
+typedef struct LargeGlyph {
+	signed char top;
+	unsigned char width;
+	unsigned char height;
+	unsigned char rows[LARGE_GLYPH_ROWS];
+} LargeGlyph;
+
+extern const LargeGlyph largeFont[LARGE_FONT_LAST - LARGE_FONT_FIRST + 1];
+
+const LargeGlyph* getLargeGlyph(char a);
+
+/**
+ * Kuten printLargeCharToBuffer ja printLargeStringToBuffer, mutta merkit
+ * suurennetaan kokonaislukukertoimella scale (1 ... MAX_FONT_SCALE):
+ * palikasta tulee scale x scale -neli ja vleist scale kertaa levemmt.
+ *
+ * Merkkien rivit muutetaan ensimmisell kytll yhtenisiksi palikkajonoiksi,
+ * joten piirrettess kukin jono on yksi tytt rivi kohden mill tahansa
+ * kertoimella. Piirto rajataan leikkausalueeseen (ks. pushClipRect).
+ * Palauttaa merkin leveyden.
+ */
+int printScaledCharToBuffer(int x, int y, char a, int c, int scale);
+void printScaledStringToBuffer(int x, int y, const char* s, int c, int scale);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
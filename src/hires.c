@@ -0,0 +1,221 @@
+/**
+ * Pikseliruutu uudelleen mritellyill merkeill (ks. hires.h).
+ *
+ * Solun 16 rivi ksitelln neljn 32-bittisen sanana: puoliskon
+ * yksivrisyys on kahden sanan vertailu, ja hajautusarvo lasketaan
+ * sanoista. Saman bittikartan paikka lytyy hajautustaulun ketjusta;
+ * uusi bittikartta saa paikan, jota ei ole kytetty pisimpn aikaan (ei
+ * kuitenkaan tll ruudulla kytetty). Merkit lhetetn setGlyphill,
+ * joten ruudulla jo olevia merkkej ei lhetet uudelleen.
+ */
+
+#include "hires.h"
+
+#define NO_SLOT -1
+
+static unsigned long hashCell(const uint32_t* w) {
+	uint32_t x = w[0] ^ (w[1] * 0x9e3779b1u) ^ ((w[2] << 7) | (w[2] >> 25)) ^ ((w[3] << 19) | (w[3] >> 13)) * 0x85ebca6bu;
+
+	x ^= x >> 16;
+	x *= 0x7feb352du;
+	x ^= x >> 15;
+	return x & (HIRES_HASH_SIZE - 1);
+}
+
+static void unlinkSlot(HiresScreen* h, int s, unsigned long bucket) {
+	short* p = &h->buckets[bucket];
+
+	while (*p != NO_SLOT) {
+		if (*p == s) {
+			*p = h->slots[s].next;
+			return;
+		}
+		p = &h->slots[*p].next;
+	}
+}
+
+static int findSlot(HiresScreen* h, const unsigned char* cell, unsigned long bucket) {
+	int s = h->buckets[bucket];
+
+	while (s != NO_SLOT && memcmp(h->slots[s].bits, cell, GLYPH_HEIGHT) != 0) {
+		s = h->slots[s].next;
+	}
+	return s;
+}
+
+/**
+ * Antaa bittikartalle pisimpn kyttmtt olleen paikan. Palauttaa
+ * NO_SLOT, jos kaikki paikat ovat jo tmn ruudun kytss.
+ */
+static int allocSlot(HiresScreen* h, const unsigned char* cell, unsigned long bucket) {
+	uint32_t w[GLYPH_HEIGHT / 4];
+	int i, s = NO_SLOT;
+
+	for (i = 0; i < h->slotCount; i++) {
+		if (h->slots[i].lastUse != h->frame && (s == NO_SLOT || h->slots[i].lastUse < h->slots[s].lastUse)) {
+			s = i;
+		}
+	}
+	if (s == NO_SLOT) {
+		return NO_SLOT;
+	}
+
+	if (h->slots[s].lastUse != 0) {
+		memcpy(w, h->slots[s].bits, GLYPH_HEIGHT);
+		unlinkSlot(h, s, hashCell(w));
+	}
+	memcpy(h->slots[s].bits, cell, GLYPH_HEIGHT);
+	h->slots[s].next = h->buckets[bucket];
+	h->buckets[bucket] = s;
+	return s;
+}
+
+static int countBits(const unsigned char* rows, int n) {
+	int i, b, c = 0;
+
+	for (i = 0; i < n; i++) {
+		for (b = rows[i]; b != 0; b &= b - 1) {
+			c++;
+		}
+	}
+	return c;
+}
+
+void initHiresScreen(HiresScreen* h, int color, int firstGlyph, int glyphCount) {
+	int i, c;
+
+	h->slotCount = 0;
+	for (c = firstGlyph; c < firstGlyph + glyphCount && c < CHARSET_GLYPHS; c++) {
+		if (c < 0 || c == 32 || c == 219 || c == 220 || c == 223) {
+			continue;
+		}
+		h->slots[h->slotCount].glyph = c;
+		h->slots[h->slotCount].next = NO_SLOT;
+		h->slots[h->slotCount].lastUse = 0;
+		h->slotCount++;
+	}
+	for (i = 0; i < HIRES_HASH_SIZE; i++) {
+		h->buckets[i] = NO_SLOT;
+	}
+	h->frame = 0;
+	h->slotsUsed = 0;
+	h->glyphsUploaded = 0;
+	h->uploadBytes = 0;
+	h->blockCells = 0;
+	h->overflowCells = 0;
+	clearHiresScreen(h, color);
+}
+
+void clearHiresScreen(HiresScreen* h, int color) {
+	memset(h->bits, 0, sizeof(h->bits));
+	memset(h->colors, color, sizeof(h->colors));
+}
+
+void setHiresPixel(HiresScreen* h, int x, int y, bool on) {
+	if ((unsigned)x >= HIRES_WIDTH || (unsigned)y >= HIRES_HEIGHT) {
+		return;
+	}
+	if (on) {
+		h->bits[y][x >> 3] |= 0x80 >> (x & 7);
+	}
+	else {
+		h->bits[y][x >> 3] &= ~(0x80 >> (x & 7));
+	}
+}
+
+bool getHiresPixel(const HiresScreen* h, int x, int y) {
+	if ((unsigned)x >= HIRES_WIDTH || (unsigned)y >= HIRES_HEIGHT) {
+		return false;
+	}
+	return (h->bits[y][x >> 3] & (0x80 >> (x & 7))) != 0;
+}
+
+/**
+ * Bresenhamin viiva; ruudun ulkopuoliset pikselit jtetn pois.
+ */
+void hiresLine(HiresScreen* h, int x0, int y0, int x1, int y1, bool on) {
+	int dx = abs(x1 - x0), dy = -abs(y1 - y0);
+	int sx = (x0 < x1) ? 1 : -1, sy = (y0 < y1) ? 1 : -1;
+	int e = dx + dy, e2;
+
+	for (;;) {
+		setHiresPixel(h, x0, y0, on);
+		if (x0 == x1 && y0 == y1) {
+			break;
+		}
+		e2 = 2 * e;
+		if (e2 >= dy) { e += dy; x0 += sx; }
+		if (e2 <= dx) { e += dx; y0 += sy; }
+	}
+}
+
+void drawScreenFromHiresScreen(HiresScreen* h) {
+	uint32_t w[GLYPH_HEIGHT / 4];
+	unsigned char* cell = (unsigned char*)w;
+	unsigned long bucket;
+	long uploaded = getGlyphsUploaded();
+	int cx, cy, i, s, a, top, bottom;
+
+	h->frame++;
+	h->slotsUsed = 0;
+	h->blockCells = 0;
+	h->overflowCells = 0;
+
+	for (cy = 0; cy < ROWS; cy++) {
+		for (cx = 0; cx < COLS; cx++) {
+			for (i = 0; i < GLYPH_HEIGHT; i++) {
+				cell[i] = h->bits[cy * GLYPH_HEIGHT + i][cx];
+			}
+			a = h->colors[cy][cx];
+
+			// Yksivriset puoliskot palikkana kuten drawBlocksToBuffer.
+			if (w[0] == w[1] && (w[0] == 0 || w[0] == 0xffffffffu) && w[2] == w[3] && (w[2] == 0 || w[2] == 0xffffffffu)) {
+				top = w[0] ? (a & 15) : (a >> 4);
+				bottom = w[2] ? (a & 15) : (a >> 4);
+				screenCharBuffer[cy][cx] = 223;
+				screenColorBuffer[cy][cx] = top + 16 * bottom;
+				h->blockCells++;
+				continue;
+			}
+
+			// Knteinen muoto, jossa vasen ylkulma on pois plt.
+			if (cell[0] & 0x80) {
+				for (i = 0; i < GLYPH_HEIGHT / 4; i++) {
+					w[i] = ~w[i];
+				}
+				a = ((a & 15) << 4) | (a >> 4);
+			}
+
+			bucket = hashCell(w);
+			s = findSlot(h, cell, bucket);
+			if (s == NO_SLOT) {
+				s = allocSlot(h, cell, bucket);
+			}
+			if (s == NO_SLOT) {
+				top = (countBits(cell, GLYPH_HEIGHT / 2) >= 32) ? (a & 15) : (a >> 4);
+				bottom = (countBits(cell + GLYPH_HEIGHT / 2, GLYPH_HEIGHT / 2) >= 32) ? (a & 15) : (a >> 4);
+				screenCharBuffer[cy][cx] = 223;
+				screenColorBuffer[cy][cx] = top + 16 * bottom;
+				h->overflowCells++;
+				continue;
+			}
+
+			// Ensimmisell kytll ruudulla varmistetaan, ett merkki on
+			// nyttlaitteella (esim. initTextMode on voinut hvitt sen).
+			if (h->slots[s].lastUse != h->frame) {
+				h->slots[s].lastUse = h->frame;
+				h->slotsUsed++;
+				setGlyph(h->slots[s].glyph, (const char*)cell);
+			}
+			screenCharBuffer[cy][cx] = (char)h->slots[s].glyph;
+			screenColorBuffer[cy][cx] = a;
+		}
+	}
+
+	flushGlyphs();
+	h->glyphsUploaded = (int)(getGlyphsUploaded() - uploaded);
+	h->uploadBytes = (long)h->glyphsUploaded * GLYPH_HEIGHT;
+
+	markScreenBufferDirty(0, 0, COLS, ROWS);
+	drawScreenFromBuffer();
+}
@@ -0,0 +1,93 @@
+#ifndef _HIRES_H
+#define _HIRES_H
+
+#include "charset.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Pikseliruudun koko: jokainen merkkisolu on 8x16 pikseli.
+#define HIRES_WIDTH (COLS * 8)
+#define HIRES_HEIGHT (ROWS * GLYPH_HEIGHT)
+
+// Vlimuistin hajautustaulun koko (kahden potenssi).
+#define HIRES_HASH_SIZE 512
+
+/**
+ * Vlimuistin paikka: merkki glyph ja sen bittikartta. lastUse on ruutu,
+ * jolla paikkaa viimeksi kytettiin (0 = vapaa), next seuraava paikka
+ * samassa hajautusketjussa.
+ */
+typedef struct HiresSlot {
+	unsigned char bits[GLYPH_HEIGHT];
+	short glyph;
+	short next;
+	long lastUse;
+} HiresSlot;
+
+/**
+ * 640x400 pikselin kaksivrinen ruutu, joka nytetn uudelleen
+ * mriteltyin merkkein. bits on pikselikartta (rivill COLS tavua, ylin
+ * bitti vasemmalla) ja colors kunkin merkkisolun vri: pll olevat
+ * pikselit ovat alemman nelibitin ja muut ylemmn nelibitin vri.
+ *
+ * Ruudulla jokaiselle erilaiselle solulle tarvitaan oma merkki. Merkit
+ * jaetaan vlimuistista, jonka paikat ovat initHiresScreenille annetun
+ * merkkivlin merkit (paitsi 32, 219, 220 ja 223, joita palikkagrafiikka
+ * kytt). Ruudulta poistuneet bittikartat jvt paikkoihinsa, kunnes
+ * uusi bittikartta tarvitsee paikan; silloin korvataan pisimpn
+ * kyttmtt ollut. Solut, joiden yl- ja alapuolisko ovat kumpikin
+ * yksivrisi, piirretn palikkamerkill 223 ilman paikkaa. Knteinen
+ * bittikartta vaihdetuin vrein kytt samaa merkki.
+ *
+ * Tekniikan rajat nkyvt viimeisimmn drawScreenFromHiresScreenin
+ * tilastoista: slotsUsed on ruudulla kytettyjen paikkojen mr (paine,
+ * enintn slotCount), glyphsUploaded ja uploadBytes lhetettyjen merkkien
+ * mr ja koko, blockCells palikoina piirretyt solut ja overflowCells
+ * solut, joille ei riittnyt paikkaa (ne piirretn puoliskojensa
+ * enemmistvrein palikkoina).
+ *
+ * VGA:n 9 pikselin soluissa merkkien vliin j tyhj sarake; sen voi
+ * poistaa setCharWidth(8):lla. Taustavrej 8-15 varten vilkkuminen on
+ * kytkettv pois (setBlinking(false)).
+ */
+typedef struct HiresScreen {
+	unsigned char bits[HIRES_HEIGHT][COLS];
+	unsigned char colors[ROWS][COLS];
+
+	int slotCount;
+	HiresSlot slots[CHARSET_GLYPHS];
+	short buckets[HIRES_HASH_SIZE];
+	long frame;
+
+	int slotsUsed;
+	int glyphsUploaded;
+	long uploadBytes;
+	int blockCells;
+	int overflowCells;
+} HiresScreen;
+
+/**
+ * Alustaa tyhjn ruudun vrill color. Vlimuistin paikoiksi tulevat
+ * merkit firstGlyph ... firstGlyph + glyphCount - 1.
+ */
+void initHiresScreen(HiresScreen* h, int color, int firstGlyph, int glyphCount);
+void clearHiresScreen(HiresScreen* h, int color);
+
+void setHiresPixel(HiresScreen* h, int x, int y, bool on);
+bool getHiresPixel(const HiresScreen* h, int x, int y);
+void hiresLine(HiresScreen* h, int x0, int y0, int x1, int y1, bool on);
+
+/**
+ * Lhett ruudun uudet bittikartat merkkein (ks. flushGlyphs) ja piirt
+ * ruudun screenChar- ja screenColorBufferin kautta (ks.
+ * drawScreenFromBuffer).
+ */
+void drawScreenFromHiresScreen(HiresScreen* h);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
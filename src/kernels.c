@@ -0,0 +1,385 @@
+/**
+ * Palikkarivien pakkausfunktiot (ks. kernels.h): skalaari-, SWAR-, SSE2- ja
+ * AVX2-versiot sek ajonaikainen valinta niiden vlill.
+ */
+
+#include "kernels.h"
+
+#ifdef TXTGFX_X86_SIMD
+	#include <immintrin.h>
+#endif
+
+/**
+ * 32-bittiset lataukset ja tallennukset kohdistamattomiin osoitteisiin.
+ * x86:lla kelpaa suora osoitinmuunnos; muualla kuljetaan memcpy:n kautta,
+ * jonka kntj muuttaa yhdeksi kskyksi.
+ */
+#ifdef TXTGFX_DOS
+	#define LOAD32(p) (*(const uint32_t*)(p))
+	#define STORE32(p, v) (*(uint32_t*)(p) = (v))
+#else
+	static uint32_t load32(const void* p) { uint32_t v; memcpy(&v, p, 4); return v; }
+	static void store32(void* p, uint32_t v) { memcpy(p, &v, 4); }
+	#define LOAD32(p) load32(p)
+	#define STORE32(p, v) store32((p), (v))
+#endif
+
+/**
+ * Skalaariversiot: sama laskutapa kuin alkuperisess
+ * drawScreenFromBlockBufferissa.
+ */
+static void scalarPackAttrs(char* dst, const char* top, const char* bottom, int n) {
+	int i;
+	for (i = 0; i < n; i++) {
+		dst[i] = top[i] + 16 * bottom[i];
+	}
+}
+
+static void scalarPackCells(uint16_t* dst, const char* top, const char* bottom, int n) {
+	int i;
+	for (i = 0; i < n; i++) {
+		dst[i] = 223 | ((uint16_t)(unsigned char)(top[i] + 16 * bottom[i]) << 8);
+	}
+}
+
+/**
+ * SWAR: nelj vri 32-bittisess rekisteriss. Tavut lasketaan yhteen
+ * ilman muistinumeroa ylimmst bitist, joten tulos on tavuittain sama
+ * kahdeksanbittinen top + 16 * bottom kuin skalaariversiossa mys vreill
+ * 16-255. bottomin ylempi nelibitti putoaisi siirrossa pois, joten sen saa
+ * maskata ennen siirtoa.
+ */
+static uint32_t swarAttrs(uint32_t t, uint32_t b) {
+	b = (b & 0x0f0f0f0fUL) << 4;
+	return ((t & 0x7f7f7f7fUL) + (b & 0x7f7f7f7fUL)) ^ ((t ^ b) & 0x80808080UL);
+}
+
+static void swarPackAttrs(char* dst, const char* top, const char* bottom, int n) {
+	int i;
+	uint32_t a;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		a = swarAttrs(LOAD32(top + i), LOAD32(bottom + i));
+		STORE32(dst + i, a);
+	}
+	scalarPackAttrs(dst + i, top + i, bottom + i, n - i);
+}
+
+static void swarPackCells(uint16_t* dst, const char* top, const char* bottom, int n) {
+	int i;
+	uint32_t a;
+
+	// Vritavut a0..a3 lomitetaan merkin 223 (0xdf) kanssa kahdeksi sanaksi:
+	// [df a0 df a1] ja [df a2 df a3] (little-endian).
+	for (i = 0; i + 4 <= n; i += 4) {
+		a = swarAttrs(LOAD32(top + i), LOAD32(bottom + i));
+		STORE32(dst + i, 0x00df00dfUL | ((a & 0x000000ffUL) << 8) | ((a & 0x0000ff00UL) << 16));
+		STORE32(dst + i + 2, 0x00df00dfUL | ((a & 0x00ff0000UL) >> 8) | (a & 0xff000000UL));
+	}
+	scalarPackCells(dst + i, top + i, bottom + i, n - i);
+}
+
+static void scalarAttrCells(uint16_t* dst, const char* attrs, int n) {
+	int i;
+	for (i = 0; i < n; i++) {
+		dst[i] = 223 | ((uint16_t)(unsigned char)attrs[i] << 8);
+	}
+}
+
+static void swarAttrCells(uint16_t* dst, const char* attrs, int n) {
+	int i;
+	uint32_t a;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		a = LOAD32(attrs + i);
+		STORE32(dst + i, 0x00df00dfUL | ((a & 0x000000ffUL) << 8) | ((a & 0x0000ff00UL) << 16));
+		STORE32(dst + i + 2, 0x00df00dfUL | ((a & 0x00ff0000UL) >> 8) | (a & 0xff000000UL));
+	}
+	scalarAttrCells(dst + i, attrs + i, n - i);
+}
+
+static void scalarKeyBlend(char* dst, const char* src, int key, int n) {
+	int i;
+	for (i = 0; i < n; i++) {
+		if (src[i] != (char)key) {
+			dst[i] = src[i];
+		}
+	}
+}
+
+/**
+ * Tavut, jotka eivt ole nollia, tunnistetaan ilman tavujen vlisi
+ * muistinumeroita: (v & 0x7f) + 0x7f asettaa ylimmn bitin, jos jokin
+ * alemmista on pll, ja | v kattaa ylimmn. Ylin bitti levitetn koko
+ * tavun maskiksi.
+ */
+static void swarKeyBlend(char* dst, const char* src, int key, int n) {
+	uint32_t keys = (uint32_t)(key & 0xff) * 0x01010101UL;
+	uint32_t s, v, m;
+	int i;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		s = LOAD32(src + i);
+		v = s ^ keys;
+		m = (((v & 0x7f7f7f7fUL) + 0x7f7f7f7fUL) | v) & 0x80808080UL;
+		m = (m >> 7) * 0xff;
+		STORE32(dst + i, (s & m) | (LOAD32(dst + i) & ~m));
+	}
+	scalarKeyBlend(dst + i, src + i, key, n - i);
+}
+
+static void scalarAffineRow(char* dst, const char* src, int stride, uint32_t u, uint32_t v, uint32_t du, uint32_t dv, int n) {
+	int i;
+	for (i = 0; i < n; i++) {
+		dst[i] = src[(v >> 16) * stride + (u >> 16)];
+		u += du;
+		v += dv;
+	}
+}
+
+/**
+ * Nelj nytett kootaan rekisteriin ja kirjoitetaan yhdell kskyll.
+ */
+static void swarAffineRow(char* dst, const char* src, int stride, uint32_t u, uint32_t v, uint32_t du, uint32_t dv, int n) {
+	uint32_t a;
+	int i;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		a = (unsigned char)src[(v >> 16) * stride + (u >> 16)];
+		u += du;
+		v += dv;
+		a |= (uint32_t)(unsigned char)src[(v >> 16) * stride + (u >> 16)] << 8;
+		u += du;
+		v += dv;
+		a |= (uint32_t)(unsigned char)src[(v >> 16) * stride + (u >> 16)] << 16;
+		u += du;
+		v += dv;
+		a |= (uint32_t)(unsigned char)src[(v >> 16) * stride + (u >> 16)] << 24;
+		u += du;
+		v += dv;
+		STORE32(dst + i, a);
+	}
+	scalarAffineRow(dst + i, src, stride, u, v, du, dv, n - i);
+}
+
+const BlockKernels scalarBlockKernels = { "scalar", scalarPackAttrs, scalarPackCells, scalarAttrCells, scalarKeyBlend, scalarAffineRow };
+const BlockKernels swarBlockKernels = { "swar32", swarPackAttrs, swarPackCells, swarAttrCells, swarKeyBlend, swarAffineRow };
+
+#ifdef TXTGFX_X86_SIMD
+
+/**
+ * SSE2: 16 solua kerrallaan. Alempi vri maskataan 4 bittiin, joten sen
+ * siirto 16-bittisin sanoina ei vuoda naapuritavuun, ja tavuittainen
+ * yhteenlasku antaa saman kahdeksanbittisen tuloksen kuin skalaariversio.
+ */
+static __m128i sse2Attrs(const char* top, const char* bottom) {
+	const __m128i lo = _mm_set1_epi8(0x0f);
+	__m128i t = _mm_loadu_si128((const __m128i*)top);
+	__m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i*)bottom), lo);
+	return _mm_add_epi8(t, _mm_slli_epi16(b, 4));
+}
+
+static void sse2PackAttrs(char* dst, const char* top, const char* bottom, int n) {
+	int i;
+	for (i = 0; i + 16 <= n; i += 16) {
+		_mm_storeu_si128((__m128i*)(dst + i), sse2Attrs(top + i, bottom + i));
+	}
+	swarPackAttrs(dst + i, top + i, bottom + i, n - i);
+}
+
+static void sse2PackCells(uint16_t* dst, const char* top, const char* bottom, int n) {
+	const __m128i glyph = _mm_set1_epi8((char)223);
+	__m128i a;
+	int i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		a = sse2Attrs(top + i, bottom + i);
+		_mm_storeu_si128((__m128i*)(dst + i), _mm_unpacklo_epi8(glyph, a));
+		_mm_storeu_si128((__m128i*)(dst + i + 8), _mm_unpackhi_epi8(glyph, a));
+	}
+	swarPackCells(dst + i, top + i, bottom + i, n - i);
+}
+
+static void sse2AttrCells(uint16_t* dst, const char* attrs, int n) {
+	const __m128i glyph = _mm_set1_epi8((char)223);
+	__m128i a;
+	int i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		a = _mm_loadu_si128((const __m128i*)(attrs + i));
+		_mm_storeu_si128((__m128i*)(dst + i), _mm_unpacklo_epi8(glyph, a));
+		_mm_storeu_si128((__m128i*)(dst + i + 8), _mm_unpackhi_epi8(glyph, a));
+	}
+	swarAttrCells(dst + i, attrs + i, n - i);
+}
+
+static void sse2KeyBlend(char* dst, const char* src, int key, int n) {
+	const __m128i keys = _mm_set1_epi8((char)key);
+	__m128i s, eq;
+	int i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		s = _mm_loadu_si128((const __m128i*)(src + i));
+		eq = _mm_cmpeq_epi8(s, keys);
+		s = _mm_or_si128(_mm_and_si128(eq, _mm_loadu_si128((const __m128i*)(dst + i))), _mm_andnot_si128(eq, s));
+		_mm_storeu_si128((__m128i*)(dst + i), s);
+	}
+	swarKeyBlend(dst + i, src + i, key, n - i);
+}
+
+/**
+ * Nytteiden osoitteet lasketaan nelj kerrallaan ilman gather-kskyj:
+ * kaistan alempaan 16-bittiseen sanaan siirretn u:n kokonaisosa ja
+ * ylempn jtetn v:n kokonaisosa, jolloin madd (u * 1 + v * stride)
+ * antaa suoraan indeksin. Itse lataukset tehdn tavallisina.
+ */
+static void sse2AffineRow(char* dst, const char* src, int stride, uint32_t u, uint32_t v, uint32_t du, uint32_t dv, int n) {
+	const __m128i hi = _mm_set1_epi32((int)0xffff0000UL);
+	const __m128i mul = _mm_set1_epi32((stride << 16) | 1);
+	const __m128i du4 = _mm_set1_epi32((int)(4 * du));
+	const __m128i dv4 = _mm_set1_epi32((int)(4 * dv));
+	__m128i uu = _mm_setr_epi32((int)u, (int)(u + du), (int)(u + 2 * du), (int)(u + 3 * du));
+	__m128i vv = _mm_setr_epi32((int)v, (int)(v + dv), (int)(v + 2 * dv), (int)(v + 3 * dv));
+	uint32_t idx[4];
+	int i;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		_mm_storeu_si128((__m128i*)idx, _mm_madd_epi16(_mm_or_si128(_mm_srli_epi32(uu, 16), _mm_and_si128(vv, hi)), mul));
+		STORE32(dst + i, (uint32_t)(unsigned char)src[idx[0]] | ((uint32_t)(unsigned char)src[idx[1]] << 8)
+			| ((uint32_t)(unsigned char)src[idx[2]] << 16) | ((uint32_t)(unsigned char)src[idx[3]] << 24));
+		uu = _mm_add_epi32(uu, du4);
+		vv = _mm_add_epi32(vv, dv4);
+	}
+	scalarAffineRow(dst + i, src, stride, u + i * du, v + i * dv, du, dv, n - i);
+}
+
+/**
+ * AVX2: 32 solua kerrallaan. unpack toimii 128-bittisten puoliskojen sisll,
+ * joten puoliskot jrjestetn lopuksi permute2x128:lla. Ennen loppuosan
+ * SSE2-ksittely ylrekisterit nollataan (vzeroupper), muuten AVX- ja
+ * SSE-koodin vaihto on hyvin hidasta.
+ */
+__attribute__((target("avx2")))
+static __m256i avx2Attrs(const char* top, const char* bottom) {
+	const __m256i lo = _mm256_set1_epi8(0x0f);
+	__m256i t = _mm256_loadu_si256((const __m256i*)top);
+	__m256i b = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)bottom), lo);
+	return _mm256_add_epi8(t, _mm256_slli_epi16(b, 4));
+}
+
+__attribute__((target("avx2")))
+static void avx2PackAttrs(char* dst, const char* top, const char* bottom, int n) {
+	int i;
+	for (i = 0; i + 32 <= n; i += 32) {
+		_mm256_storeu_si256((__m256i*)(dst + i), avx2Attrs(top + i, bottom + i));
+	}
+	_mm256_zeroupper();
+	sse2PackAttrs(dst + i, top + i, bottom + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void avx2PackCells(uint16_t* dst, const char* top, const char* bottom, int n) {
+	const __m256i glyph = _mm256_set1_epi8((char)223);
+	__m256i a, l, h;
+	int i;
+
+	for (i = 0; i + 32 <= n; i += 32) {
+		a = avx2Attrs(top + i, bottom + i);
+		l = _mm256_unpacklo_epi8(glyph, a);	// solut 0-7 ja 16-23
+		h = _mm256_unpackhi_epi8(glyph, a);	// solut 8-15 ja 24-31
+		_mm256_storeu_si256((__m256i*)(dst + i), _mm256_permute2x128_si256(l, h, 0x20));
+		_mm256_storeu_si256((__m256i*)(dst + i + 16), _mm256_permute2x128_si256(l, h, 0x31));
+	}
+	_mm256_zeroupper();
+	sse2PackCells(dst + i, top + i, bottom + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void avx2AttrCells(uint16_t* dst, const char* attrs, int n) {
+	const __m256i glyph = _mm256_set1_epi8((char)223);
+	__m256i a, l, h;
+	int i;
+
+	for (i = 0; i + 32 <= n; i += 32) {
+		a = _mm256_loadu_si256((const __m256i*)(attrs + i));
+		l = _mm256_unpacklo_epi8(glyph, a);
+		h = _mm256_unpackhi_epi8(glyph, a);
+		_mm256_storeu_si256((__m256i*)(dst + i), _mm256_permute2x128_si256(l, h, 0x20));
+		_mm256_storeu_si256((__m256i*)(dst + i + 16), _mm256_permute2x128_si256(l, h, 0x31));
+	}
+	_mm256_zeroupper();
+	sse2AttrCells(dst + i, attrs + i, n - i);
+}
+
+// Valinta tehdn kuten SSE2:lla eik _mm256_blendv_epi8:lla: gcc 12
+// muuntaa blendv:n vertailuksi "maski < 0" char-alkioilla, ja
+// -funsigned-char tekee niist etumerkittmi, jolloin blendv palauttaa
+// aina ensimmisen argumenttinsa.
+__attribute__((target("avx2")))
+static void avx2KeyBlend(char* dst, const char* src, int key, int n) {
+	const __m256i keys = _mm256_set1_epi8((char)key);
+	__m256i s, eq;
+	int i;
+
+	for (i = 0; i + 32 <= n; i += 32) {
+		s = _mm256_loadu_si256((const __m256i*)(src + i));
+		eq = _mm256_cmpeq_epi8(s, keys);
+		s = _mm256_or_si256(_mm256_and_si256(eq, _mm256_loadu_si256((const __m256i*)(dst + i))), _mm256_andnot_si256(eq, s));
+		_mm256_storeu_si256((__m256i*)(dst + i), s);
+	}
+	_mm256_zeroupper();
+	sse2KeyBlend(dst + i, src + i, key, n - i);
+}
+
+// Kuten sse2AffineRow, kahdeksan nytett kerrallaan.
+__attribute__((target("avx2")))
+static void avx2AffineRow(char* dst, const char* src, int stride, uint32_t u, uint32_t v, uint32_t du, uint32_t dv, int n) {
+	const __m256i hi = _mm256_set1_epi32((int)0xffff0000UL);
+	const __m256i mul = _mm256_set1_epi32((stride << 16) | 1);
+	const __m256i step = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m256i du8 = _mm256_set1_epi32((int)(8 * du));
+	const __m256i dv8 = _mm256_set1_epi32((int)(8 * dv));
+	__m256i uu = _mm256_add_epi32(_mm256_set1_epi32((int)u), _mm256_mullo_epi32(step, _mm256_set1_epi32((int)du)));
+	__m256i vv = _mm256_add_epi32(_mm256_set1_epi32((int)v), _mm256_mullo_epi32(step, _mm256_set1_epi32((int)dv)));
+	uint32_t idx[8];
+	int i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		_mm256_storeu_si256((__m256i*)idx, _mm256_madd_epi16(_mm256_or_si256(_mm256_srli_epi32(uu, 16), _mm256_and_si256(vv, hi)), mul));
+		STORE32(dst + i, (uint32_t)(unsigned char)src[idx[0]] | ((uint32_t)(unsigned char)src[idx[1]] << 8)
+			| ((uint32_t)(unsigned char)src[idx[2]] << 16) | ((uint32_t)(unsigned char)src[idx[3]] << 24));
+		STORE32(dst + i + 4, (uint32_t)(unsigned char)src[idx[4]] | ((uint32_t)(unsigned char)src[idx[5]] << 8)
+			| ((uint32_t)(unsigned char)src[idx[6]] << 16) | ((uint32_t)(unsigned char)src[idx[7]] << 24));
+		uu = _mm256_add_epi32(uu, du8);
+		vv = _mm256_add_epi32(vv, dv8);
+	}
+	_mm256_zeroupper();
+	sse2AffineRow(dst + i, src, stride, u + i * du, v + i * dv, du, dv, n - i);
+}
+
+const BlockKernels sse2BlockKernels = { "sse2", sse2PackAttrs, sse2PackCells, sse2AttrCells, sse2KeyBlend, sse2AffineRow };
+const BlockKernels avx2BlockKernels = { "avx2", avx2PackAttrs, avx2PackCells, avx2AttrCells, avx2KeyBlend, avx2AffineRow };
+
+#endif
+
+static const BlockKernels* blockKernels = NULL;
+
+const BlockKernels* getBlockKernels(void) {
+	if (blockKernels == NULL) {
+#ifdef TXTGFX_X86_SIMD
+		if (__builtin_cpu_supports("avx2")) {
+			blockKernels = &avx2BlockKernels;
+		}
+		else {
+			blockKernels = &sse2BlockKernels;
+		}
+#else
+		blockKernels = &swarBlockKernels;
+#endif
+	}
+	return blockKernels;
+}
+
+void setBlockKernels(const BlockKernels* kernels) {
+	blockKernels = kernels;
+}
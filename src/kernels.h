@@ -0,0 +1,67 @@
+#ifndef _KERNELS_H
+#define _KERNELS_H
+
+#include "txtgfx.h"
+
+// x86-64-isnnill (gcc/clang) kytettviss on mys SSE2- ja AVX2-versiot.
+#if defined(__GNUC__) && defined(__x86_64__)
+	#define TXTGFX_X86_SIMD
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Palikkarivien pakkausfunktiot. packAttrs ja packCells ottavat kaksi
+ * blockColorBufferin rivi (top = parillinen, bottom = pariton) ja tekevt
+ * niist n solun vrit (top + 16 * bottom). packAttrs kirjoittaa pelkt
+ * vritavut, packCells 16-bittiset solut (merkki 223 alatavussa, vri
+ * yltavussa) suoraan nyttmuistin muodossa. attrCells tekee samat solut
+ * valmiiksi pakatuista vritavuista (PackedSurface). Vrit 16-255 (esim.
+ * FLOOD_MARK) antavat kaikissa versioissa saman kahdeksanbittisen tuloksen.
+ *
+ * keyBlend kopioi n palikkaa src:st dst:hen paitsi ne, joiden vri on key
+ * (lpinkyv vri). Valinta tehdn maskeilla ilman haarautumista.
+ *
+ * affineRow nytteist n palikkaa src-pinnasta (rivin pituus stride)
+ * 16.16-kiintolukukoordinaateista: palikka i on src:n kohta (u + i * du,
+ * v + i * dv). Kaikkien nytteiden on oltava pinnan sisll, eivtk
+ * kokonaisosat ja stride saa olla yli 32767 (ks. rotozoom.h).
+ */
+typedef struct BlockKernels {
+	const char* name;
+	void (*packAttrs)(char* dst, const char* top, const char* bottom, int n);
+	void (*packCells)(uint16_t* dst, const char* top, const char* bottom, int n);
+	void (*attrCells)(uint16_t* dst, const char* attrs, int n);
+	void (*keyBlend)(char* dst, const char* src, int key, int n);
+	void (*affineRow)(char* dst, const char* src, int stride, uint32_t u, uint32_t v, uint32_t du, uint32_t dv, int n);
+} BlockKernels;
+
+// Alkuperinen tavu kerrallaan -toteutus (vertailukohdaksi).
+extern const BlockKernels scalarBlockKernels;
+// 32-bittinen SWAR, nelj solua kerrallaan. Oletus DOSissa.
+extern const BlockKernels swarBlockKernels;
+
+#ifdef TXTGFX_X86_SIMD
+	extern const BlockKernels sse2BlockKernels;
+	extern const BlockKernels avx2BlockKernels;
+#endif
+
+/**
+ * Palauttaa kytss olevat pakkausfunktiot. Ensimmisell kutsulla valitaan
+ * nopein prosessorin tukema versio.
+ */
+const BlockKernels* getBlockKernels(void);
+
+/**
+ * Pakottaa kyttn tietyt pakkausfunktiot (esim. vertailua varten).
+ * NULL palauttaa automaattisen valinnan.
+ */
+void setBlockKernels(const BlockKernels* kernels);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
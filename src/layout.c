@@ -0,0 +1,195 @@
+/**
+ * Tekstin asettelu (ks. layout.h).
+ */
+
+#include "layout.h"
+
+// Merkin viem tila seuraavan merkin alkuun asti (vlin kanssa).
+static int advance(char c, int font, int scale) {
+	return (font == TEXT_LARGE) ? (getLargeGlyph(c)->width + 1) * scale : 1;
+}
+
+static int gapOf(int font, int scale) {
+	return (font == TEXT_LARGE) ? scale : 0;
+}
+
+static int lineHeight(int font, int scale) {
+	return (font == TEXT_LARGE) ? 6 * scale : 1;
+}
+
+static int textHeight(int lines, int font, int scale) {
+	return (lines > 0) ? lines * lineHeight(font, scale) - gapOf(font, scale) : 0;
+}
+
+void measureText(const char* s, int font, int scale, int* width, int* height) {
+	const int gap = gapOf(font, scale);
+	int w = 0, maxW = 0, lines = (*s != '\0') ? 1 : 0;
+
+	for (; *s != '\0'; s++) {
+		if (*s == '\n') {
+			lines++;
+			w = 0;
+		}
+		else {
+			w += advance(*s, font, scale);
+			if (w - gap > maxW) {
+				maxW = w - gap;
+			}
+		}
+	}
+	*width = maxW;
+	*height = textHeight(lines, font, scale);
+}
+
+void initTextLayout(TextLayout* l) {
+	l->valid = false;
+	l->width = 0;
+	l->height = 0;
+	l->lines = 0;
+	l->count = 0;
+}
+
+bool layoutText(TextLayout* l, const char* s, int font, int scale, int boxWidth, int boxHeight, int align) {
+	short starts[MAX_LAYOUT_LINES], ends[MAX_LAYOUT_LINES];
+	const char* t = l->text;
+	int gap, lh, n, pos, start, end, next, i, w, a, brk, ref, x;
+	bool more, word;
+
+	if (font == TEXT_NORMAL || scale < 1) {
+		scale = 1;
+	}
+	if (l->valid && l->font == font && l->scale == scale && l->boxWidth == boxWidth && l->boxHeight == boxHeight
+		&& l->align == align && strncmp(l->text, s, MAX_LAYOUT_CHARS) == 0) {
+		return false;
+	}
+	l->font = font;
+	l->scale = scale;
+	l->boxWidth = boxWidth;
+	l->boxHeight = boxHeight;
+	l->align = align;
+	strncpy(l->text, s, MAX_LAYOUT_CHARS);
+	l->text[MAX_LAYOUT_CHARS] = '\0';
+	l->valid = true;
+
+	gap = gapOf(font, scale);
+	lh = lineHeight(font, scale);
+
+	// Rivitys: rivi katkaistaan kohdasta, jossa se ei en mahdu, jos siin
+	// on vlilynti; muuten viimeisest vlilynnist ennen sit tai sen
+	// puuttuessa juuri ennen tt kohtaa. Vlilynti kelpaa katkaisuun vasta
+	// rivin ensimmisen sanan jlkeen, jottei rivi j tyhjksi, ja katkaisua
+	// seuraava '\n' ei aloita uutta rivi.
+	n = 0;
+	pos = 0;
+	l->width = 0;
+	more = (t[0] != '\0');
+	while (more && n < MAX_LAYOUT_LINES) {
+		if (boxHeight > 0 && textHeight(n + 1, font, scale) > boxHeight) {
+			break;
+		}
+		start = pos;
+		w = 0;
+		brk = -1;
+		word = false;
+		for (i = pos; t[i] != '\0' && t[i] != '\n'; i++) {
+			a = advance(t[i], font, scale);
+			if (boxWidth > 0 && i > start && w + a - gap > boxWidth) {
+				break;
+			}
+			if (t[i] != ' ') {
+				word = true;
+			}
+			else if (word) {
+				brk = i;
+			}
+			w += a;
+		}
+
+		if (t[i] == '\0' || t[i] == '\n') {
+			end = i;
+			next = i + 1;
+			more = (t[i] == '\n');
+		}
+		else {
+			end = (t[i] == ' ' && word) ? i : (brk > start) ? brk : i;
+			for (next = end; t[next] == ' '; next++) {
+				;
+			}
+			if (t[next] == '\n') {
+				next++;
+				more = true;
+			}
+			else {
+				more = (t[next] != '\0');
+			}
+		}
+		// Rivin lopun vlilynnit eivt vie tilaa.
+		while (end > start && t[end - 1] == ' ') {
+			end--;
+		}
+
+		w = 0;
+		for (i = start; i < end; i++) {
+			w += advance(t[i], font, scale);
+		}
+		starts[n] = start;
+		ends[n] = end;
+		l->lineWidth[n] = (w > 0) ? w - gap : 0;
+		if (l->lineWidth[n] > l->width) {
+			l->width = l->lineWidth[n];
+		}
+		n++;
+		pos = next;
+	}
+	l->lines = n;
+	l->height = textHeight(n, font, scale);
+
+	// Merkkien paikat tasattuina laatikon tai leveimmn rivin mukaan.
+	ref = (boxWidth > 0) ? boxWidth : l->width;
+	l->count = 0;
+	for (n = 0; n < l->lines; n++) {
+		x = (align == ALIGN_CENTER) ? (ref - l->lineWidth[n]) / 2 : (align == ALIGN_RIGHT) ? ref - l->lineWidth[n] : 0;
+		for (i = starts[n]; i < ends[n]; i++) {
+			if (t[i] != ' ') {
+				l->glyphs[l->count].x = x;
+				l->glyphs[l->count].y = n * lh;
+				l->glyphs[l->count].c = t[i];
+				l->count++;
+			}
+			x += advance(t[i], font, scale);
+		}
+	}
+	return true;
+}
+
+void drawTextLayout(const TextLayout* l, int x, int y, int color) {
+	const LayoutGlyph* g = l->glyphs;
+	const LayoutGlyph* last = l->glyphs + l->count;
+	int cx, cy, cw, ch, x0, y0, x1, y1, px, py;
+
+	if (l->font == TEXT_LARGE) {
+		getClipRect(&cx, &cy, &cw, &ch);
+		pushClipRect((l->boxWidth > 0) ? x : cx, (l->boxHeight > 0) ? y : cy,
+			(l->boxWidth > 0) ? l->boxWidth : cw, (l->boxHeight > 0) ? l->boxHeight : ch);
+		for (; g < last; g++) {
+			printScaledCharToBuffer(x + g->x, y + g->y, g->c, color, l->scale);
+		}
+		popClipRect();
+		return;
+	}
+
+	// Tavallinen teksti: laatikko ja ruutu, x1 ja y1 ulkopuolella.
+	x0 = (l->boxWidth > 0 && x > 0) ? x : 0;
+	y0 = (l->boxHeight > 0 && y > 0) ? y : 0;
+	x1 = (l->boxWidth > 0 && x + l->boxWidth < COLS) ? x + l->boxWidth : COLS;
+	y1 = (l->boxHeight > 0 && y + l->boxHeight < ROWS) ? y + l->boxHeight : ROWS;
+	for (; g < last; g++) {
+		px = x + g->x;
+		py = y + g->y;
+		if (px >= x0 && px < x1 && py >= y0 && py < y1) {
+			screenCharBuffer[py][px] = g->c;
+			screenColorBuffer[py][px] = color;
+		}
+	}
+	markScreenBufferDirty(x, y, (l->boxWidth > l->width) ? l->boxWidth : l->width, l->height);
+}
@@ -0,0 +1,91 @@
+#ifndef _LAYOUT_H
+#define _LAYOUT_H
+
+#include "font.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Fontti: iso teksti blockBufferiin (palikoina) tai tavallinen teksti
+// screenCharBufferiin (merkkisoluina).
+#define TEXT_LARGE 0
+#define TEXT_NORMAL 1
+
+#define ALIGN_LEFT 0
+#define ALIGN_CENTER 1
+#define ALIGN_RIGHT 2
+
+#define MAX_LAYOUT_CHARS 255
+#define MAX_LAYOUT_LINES 32
+
+typedef struct LayoutGlyph {
+	short x;
+	short y;
+	char c;
+} LayoutGlyph;
+
+/**
+ * Asetellun tekstin merkit: glyphs[i] piirretn kohtaan (x + glyphs[i].x,
+ * y + glyphs[i].y) laatikon vasemmasta ylkulmasta (x, y) laskien.
+ * Vlilyntej ei tallenneta. width ja height ovat tekstin viem ala, ja
+ * lineWidth kunkin rivin leveys.
+ *
+ * Asettelu tehdn vain, kun teksti tai asetukset muuttuvat, joten saman
+ * tekstin voi piirt joka ruudulla eri vreill ja eri kohtiin ilman
+ * uutta asettelua.
+ */
+typedef struct TextLayout {
+	int font;
+	int scale;
+	int boxWidth;
+	int boxHeight;
+	int align;
+	char text[MAX_LAYOUT_CHARS + 1];
+	bool valid;
+
+	int width;
+	int height;
+	int lines;
+	short lineWidth[MAX_LAYOUT_LINES];
+	int count;
+	LayoutGlyph glyphs[MAX_LAYOUT_CHARS];
+} TextLayout;
+
+/**
+ * Mittaa tekstin leveyden ja korkeuden sellaisenaan (vain '\n' vaihtaa
+ * rivi). Isolla fontilla rivit ovat 6 * scale palikan vlein ja merkkien
+ * vli on scale palikkaa, joten yksirivinen teksti on 5 * scale palikkaa
+ * korkea; tavallisella tekstill merkki ja rivi ovat yhden solun kokoisia.
+ * scale ei vaikuta tavalliseen tekstiin.
+ */
+void measureText(const char* s, int font, int scale, int* width, int* height);
+
+void initTextLayout(TextLayout* l);
+
+/**
+ * Asettelee tekstin boxWidth-levyiseen ja boxHeight-korkeaan laatikkoon:
+ * rivit katkaistaan sanojen vleist (liian pitkt sanat merkkien vleist)
+ * ja tasataan laatikon reunaan tai keskelle. Laatikkoon mahtumattomat rivit
+ * jtetn pois. Leveys 0 ei rivit (tasaus tehdn leveimmn rivin
+ * mukaan) ja korkeus 0 ei rajaa rivej. Teksti katkaistaan
+ * MAX_LAYOUT_CHARS merkin ja MAX_LAYOUT_LINES rivin kohdalta.
+ *
+ * Palauttaa true, jos teksti aseteltiin uudelleen, ja false, jos teksti ja
+ * asetukset olivat samat kuin edellisell kerralla.
+ */
+bool layoutText(TextLayout* l, const char* s, int font, int scale, int boxWidth, int boxHeight, int align);
+
+/**
+ * Piirt asetellun tekstin laatikkoon, jonka vasen ylkulma on (x, y):
+ * isolla fontilla blockBufferiin vrill color (leikkausalueen rajaamana),
+ * tavallisella screenCharBufferiin, jolloin color on koko vritavu.
+ * Piirto rajataan laatikkoon niiss suunnissa, joissa sen koko on annettu.
+ */
+void drawTextLayout(const TextLayout* l, int x, int y, int color);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,75 @@
+/**
+ * Perspektiivitaso (ks. mode7.h).
+ *
+ * Kohderivi j on tasolla etisyydell z = height * focal / dy, miss dy on
+ * rivin keskipisteen etisyys horisontista. Rivill yksi palikka vastaa
+ * tekstuurin matkaa z / focal kameran oikealle osoittavaan suuntaan, joten
+ * rivin sisll lhdekoordinaatit kasvavat vakioaskelin.
+ */
+
+#include "mode7.h"
+
+#define FIX_ONE 65536.0
+
+void drawMode7(BlockSurface* dst, const BlockSurface* texture, const Mode7Camera* camera, int plane, int mode, Mode7RowFunc rowFunc, void* data) {
+	const double fx = sin(camera->angle), fy = -cos(camera->angle);
+	const double rx = -fy, ry = fx;
+	Mode7Row r;
+	double dy, z, step, left;
+	int j, j0, j1;
+
+	if (dst->width <= 0 || texture->width <= 0 || texture->height <= 0 || camera->focal <= 0) {
+		return;
+	}
+
+	if (plane == MODE7_FLOOR) {
+		j0 = (camera->horizon < 0) ? 0 : camera->horizon;
+		j1 = dst->height;
+	}
+	else {
+		j0 = 0;
+		j1 = (camera->horizon > dst->height) ? dst->height : camera->horizon;
+	}
+
+	for (j = j0; j < j1; j++) {
+		dy = (plane == MODE7_FLOOR) ? j + 0.5 - camera->horizon : camera->horizon - j - 0.5;
+		z = camera->height * camera->focal / dy;
+		step = z / camera->focal;
+		left = (0.5 - camera->centerX) * step;
+
+		r.y = j;
+		r.distance = z;
+		r.du = (long)floor(rx * step * FIX_ONE + 0.5);
+		r.dv = (long)floor(ry * step * FIX_ONE + 0.5);
+		r.u = (long)floor((camera->x + fx * z + rx * left) * FIX_ONE + 0.5);
+		r.v = (long)floor((camera->y + fy * z + ry * left) * FIX_ONE + 0.5);
+		r.texture = texture;
+		if (rowFunc != NULL && !rowFunc(&r, data)) {
+			continue;
+		}
+		sampleSurfaceRow(dst->pixels + j * dst->stride, dst->width, r.texture, r.u, r.v, r.du, r.dv, mode);
+	}
+
+	if (dst->pixels == (char*)blockColorBuffer && j0 < j1) {
+		markBlockBufferDirty(0, j0, dst->width, j1 - j0);
+	}
+}
+
+void drawMode7ToBlockBuffer(const BlockSurface* texture, const Mode7Camera* camera, int plane, int mode, Mode7RowFunc rowFunc, void* data) {
+	BlockSurface view, copy;
+	Mode7Camera c = *camera;
+	int cx, cy, cw, ch;
+
+	if (texture == NULL) {
+		memcpy(transformBuffer, blockColorBuffer, sizeof(char) * 2 * ROWS * COLS);
+		initBlockSurface(&copy, COLS, ROWS * 2, (char*)transformBuffer);
+		texture = &copy;
+	}
+
+	getClipRect(&cx, &cy, &cw, &ch);
+	getClipSurface(&view);
+	c.horizon -= cy;
+	c.centerX -= cx;
+	drawMode7(&view, texture, &c, plane, mode, rowFunc, data);
+	markBlockBufferDirty(cx, cy, cw, ch);
+}
@@ -0,0 +1,77 @@
+#ifndef _MODE7_H
+#define _MODE7_H
+
+#include "rotozoom.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Piirrettv taso: horisontin alapuolella lattia, ylpuolella katto.
+#define MODE7_FLOOR 0
+#define MODE7_CEILING 1
+
+/**
+ * Kamera tekstuuritason yll. x ja y ovat paikka tekstuurilla (palikoina),
+ * height etisyys tasosta ja angle suunta: kulma 0 katsoo tekstuurilla
+ * ylspin (-y) ja kasvava kulma knt oikealle. horizon on kohteen
+ * rivi, jolle horisontti osuu, ja focal polttovli palikoina (mit
+ * suurempi, sit kapeampi nkkentt). centerX on kohteen sarake, jonka
+ * kohdalla katsesuunta on.
+ */
+typedef struct Mode7Camera {
+	double x;
+	double y;
+	double height;
+	double angle;
+	int horizon;
+	double focal;
+	int centerX;
+} Mode7Camera;
+
+/**
+ * Yhden kohderivin nytteistys. Kohdepinnan rivin y palikka i saa
+ * tekstuurin kohdan (u + i * du, v + i * dv) vrin; arvot ovat
+ * 16.16-kiintolukuja, joten koordinaattien on pysyttv alle 32768
+ * palikassa (korkealla olevan kameran horisontin viereiset rivit kannattaa
+ * jtt piirtmtt). distance on rivin etisyys kamerasta katsesuunnassa.
+ */
+typedef struct Mode7Row {
+	int y;
+	double distance;
+	long u;
+	long v;
+	long du;
+	long dv;
+	const BlockSurface* texture;
+} Mode7Row;
+
+/**
+ * Rivikohtainen funktio, jota kutsutaan ennen jokaisen rivin piirtoa
+ * (rasteritemput: aaltoilu, rivikohtainen tekstuuri tai sumu). Se voi
+ * muuttaa rivin arvoja; jos se palauttaa false, rivi jtetn piirtmtt.
+ */
+typedef bool (*Mode7RowFunc)(Mode7Row* row, void* data);
+
+/**
+ * Piirt tekstuuritason perspektiiviss (SNESin Mode 7:n tapaan) dst:lle.
+ * Jokaiselle riville lasketaan etisyys ja siit yksi askelpari (du, dv)
+ * kiintolukuina, ja rivi tytetn kuten rotozoomSurfacessa. mode kuten
+ * rotozoomSurfacessa (ROTO_WRAP, ROTO_CLAMP tai ROTO_TRANSPARENT).
+ * Toisen tason rivej ei kosketa; rowFunc voi olla NULL.
+ */
+void drawMode7(BlockSurface* dst, const BlockSurface* texture, const Mode7Camera* camera, int plane, int mode, Mode7RowFunc rowFunc, void* data);
+
+/**
+ * Kuten drawMode7, blockBufferiin leikkausalueen (ks. pushClipRect)
+ * rajaamana; kameran horizon ja centerX ovat ruudun koordinaatteja. Jos
+ * texture on NULL, tekstuurina kytetn blockBufferin nykyist sislt
+ * (kopioituna transformBufferiin).
+ */
+void drawMode7ToBlockBuffer(const BlockSurface* texture, const Mode7Camera* camera, int plane, int mode, Mode7RowFunc rowFunc, void* data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,312 @@
+/**
+ * Pakatut palikkapinnat (ks. surface.h): kaksi palikkaa tavussa, joten
+ * tydet solurivit voidaan tytt, kopioida ja siirt tavuina ja ruudulle
+ * piirto on pelkk vritavujen lomitus merkin 223 kanssa. Vain pinnan
+ * yl- ja alareunan vajaat solurivit ksitelln puolitavuina.
+ */
+
+#include "surface.h"
+#include "kernels.h"
+
+// Puolitavujen maskit soluriville: ylempi palikka, alempi palikka tai molemmat.
+#define MASK_TOP 0x0f
+#define MASK_BOTTOM 0xf0
+#define MASK_BOTH 0xff
+
+#define PACKED_CELL(s, x, y) ((s)->cells[((y) >> 1) * (s)->stride + (x)])
+
+void initPackedSurface(PackedSurface* s, int width, int height, char* cells) {
+	s->width = width;
+	s->height = height;
+	s->stride = width;
+	s->cells = cells;
+}
+
+int getPackedPixel(const PackedSurface* s, int x, int y) {
+	int c = (unsigned char)PACKED_CELL(s, x, y);
+	return (y & 1) ? c >> 4 : c & 0x0f;
+}
+
+void setPackedPixel(PackedSurface* s, int x, int y, int color) {
+	char* c = &PACKED_CELL(s, x, y);
+	if (y & 1) {
+		*c = (*c & MASK_TOP) | (color << 4);
+	}
+	else {
+		*c = (*c & MASK_BOTTOM) | (color & 0x0f);
+	}
+}
+
+/**
+ * Kirjoittaa solurivin tavuihin maskin mukaiset puolitavut arvosta value.
+ */
+static void fillCells(char* p, int n, int mask, int value) {
+	int i;
+
+	if (mask == MASK_BOTH) {
+		memset(p, value, n);
+		return;
+	}
+	for (i = 0; i < n; i++) {
+		p[i] = (p[i] & ~mask) | (value & mask);
+	}
+}
+
+void clrPackedSurface(PackedSurface* s, int color) {
+	memset(s->cells, (color & 0x0f) * 0x11, s->stride * (s->height / 2));
+}
+
+void fillRectToPackedSurface(PackedSurface* s, int x, int y, int w, int h, int color) {
+	char* p;
+	int value = (color & 0x0f) * 0x11;
+
+	if (x < 0) { w += x; x = 0; }
+	if (y < 0) { h += y; y = 0; }
+	if (x + w > s->width) { w = s->width - x; }
+	if (y + h > s->height) { h = s->height - y; }
+	if (w <= 0 || h <= 0) {
+		return;
+	}
+
+	p = &PACKED_CELL(s, x, y);
+	if (y & 1) {
+		fillCells(p, w, MASK_BOTTOM, value);
+		p += s->stride;
+		h--;
+	}
+	for (; h >= 2; h -= 2) {
+		memset(p, value, w);
+		p += s->stride;
+	}
+	if (h == 1) {
+		fillCells(p, w, MASK_TOP, value);
+	}
+}
+
+/**
+ * Bresenhamin viiva kuten lineToSurface.
+ */
+void lineToPackedSurface(PackedSurface* s, int x0, int y0, int x1, int y1, int color) {
+	int dx, dy, sx, sy, err, e2;
+
+	dx = abs(x1 - x0);
+	dy = -abs(y1 - y0);
+	sx = (x0 < x1) ? 1 : -1;
+	sy = (y0 < y1) ? 1 : -1;
+	err = dx + dy;
+
+	for (;;) {
+		if ((unsigned)x0 < (unsigned)s->width && (unsigned)y0 < (unsigned)s->height) {
+			setPackedPixel(s, x0, y0, color);
+		}
+		if (x0 == x1 && y0 == y1) {
+			break;
+		}
+		e2 = 2 * err;
+		if (e2 >= dy) { err += dy; x0 += sx; }
+		if (e2 <= dx) { err += dx; y0 += sy; }
+	}
+}
+
+/**
+ * Kopioi solurivin maskin mukaiset puolitavut. backwards kopioi lopusta
+ * alkuun, jos kohde on samalla rivill lhteen jlkeen.
+ */
+static void copyCells(char* d, const char* p, int n, int mask, bool backwards) {
+	int i;
+
+	if (mask == MASK_BOTH) {
+		memmove(d, p, n);
+	}
+	else if (backwards) {
+		for (i = n - 1; i >= 0; i--) {
+			d[i] = (d[i] & ~mask) | (p[i] & mask);
+		}
+	}
+	else {
+		for (i = 0; i < n; i++) {
+			d[i] = (d[i] & ~mask) | (p[i] & mask);
+		}
+	}
+}
+
+/**
+ * Kopioi lhdepinnan alueen (sx, sy, w, h) kohdepinnan kohtaan (dx, dy)
+ * kuten blitSurface. Jos sy ja dy ovat samaa pariteettia, palikat ovat
+ * samoissa puolitavuissa ja kopioidaan soluriveittin; muuten jokainen
+ * palikka on siirrettv puolitavusta toiseen.
+ */
+void blitPackedSurface(PackedSurface* dst, int dx, int dy, const PackedSurface* src, int sx, int sy, int w, int h) {
+	const char* p;
+	char* d;
+	int i, j, rows, mask, step;
+	bool backwards;
+
+	// Leikataan ensin lhteen, sitten kohteen rajoihin.
+	if (sx < 0) { dx -= sx; w += sx; sx = 0; }
+	if (sy < 0) { dy -= sy; h += sy; sy = 0; }
+	if (sx + w > src->width) { w = src->width - sx; }
+	if (sy + h > src->height) { h = src->height - sy; }
+	if (dx < 0) { sx -= dx; w += dx; dx = 0; }
+	if (dy < 0) { sy -= dy; h += dy; dy = 0; }
+	if (dx + w > dst->width) { w = dst->width - dx; }
+	if (dy + h > dst->height) { h = dst->height - dy; }
+	if (w <= 0 || h <= 0) {
+		return;
+	}
+
+	// Saman pinnan sisll kopioidaan lopusta alkuun, jos kohde on lhteen
+	// jlkeen (kuten memmove).
+	backwards = dst->cells == src->cells && (dy - sy) * dst->stride + (dx - sx) > 0;
+
+	if (((dy ^ sy) & 1) == 0) {
+		rows = ((dy + h + 1) >> 1) - (dy >> 1);
+		step = backwards ? -1 : 1;
+		for (j = backwards ? rows - 1 : 0; j >= 0 && j < rows; j += step) {
+			mask = MASK_BOTH;
+			if (j == 0 && (dy & 1)) { mask &= MASK_BOTTOM; }
+			if (j == rows - 1 && ((dy + h) & 1)) { mask &= MASK_TOP; }
+			d = &PACKED_CELL(dst, dx, dy) + j * dst->stride;
+			p = &PACKED_CELL(src, sx, sy) + j * src->stride;
+			copyCells(d, p, w, mask, backwards);
+		}
+	}
+	else if (backwards) {
+		for (j = h - 1; j >= 0; j--) {
+			for (i = w - 1; i >= 0; i--) {
+				setPackedPixel(dst, dx + i, dy + j, getPackedPixel(src, sx + i, sy + j));
+			}
+		}
+	}
+	else {
+		for (j = 0; j < h; j++) {
+			for (i = 0; i < w; i++) {
+				setPackedPixel(dst, dx + i, dy + j, getPackedPixel(src, sx + i, sy + j));
+			}
+		}
+	}
+}
+
+static void reverseCells(char* p, int n) {
+	char t;
+	int i;
+
+	for (i = 0; i < n / 2; i++) {
+		t = p[i];
+		p[i] = p[n - 1 - i];
+		p[n - 1 - i] = t;
+	}
+}
+
+/**
+ * Kierrtt n tavua k askelta oikealle. Pienempi osa kopioidaan
+ * transformBufferiin ja loput siirretn yhdell memmovella; jos kumpikaan
+ * osa ei mahdu apupuskuriin, kierretn kolmella kntmisell.
+ */
+static void rotateCells(char* p, int n, int k) {
+	char* t = (char*)transformBuffer;
+
+	if (k == 0) {
+		return;
+	}
+	if (k <= n - k && k <= (int)sizeof(transformBuffer)) {
+		memcpy(t, p + n - k, k);
+		memmove(p + k, p, n - k);
+		memcpy(p, t, k);
+	}
+	else if (n - k <= (int)sizeof(transformBuffer)) {
+		memcpy(t, p, n - k);
+		memmove(p, p + n - k, k);
+		memcpy(p + k, t, n - k);
+	}
+	else {
+		reverseCells(p, n);
+		reverseCells(p, k);
+		reverseCells(p + k, n - k);
+	}
+}
+
+/**
+ * Siirt pinnan sislt x ja y palikkaa kuten shiftBlockBuffer: siirron
+ * jlkeen kohta (i, j) on entinen kohta (i - x, j - y). Wrappaa.
+ *
+ * Parillinen pystysiirto kierrtt kokonaisia solurivej. Pariton vaatii
+ * lisksi yhden kierroksen, jossa jokaisen solun alempi palikka siirtyy
+ * seuraavan solun ylemmksi.
+ */
+void shiftPackedSurface(PackedSurface* s, int x, int y) {
+	char* p;
+	char* last;
+	char b, c;
+	uint32_t carry, cur, next;
+	int i, j, rows = s->height / 2;
+
+	x %= s->width;
+	if (x < 0) { x += s->width; }
+	y %= s->height;
+	if (y < 0) { y += s->height; }
+
+	if (x != 0) {
+		for (j = 0; j < rows; j++) {
+			rotateCells(s->cells + j * s->stride, s->width, x);
+		}
+	}
+
+	// Pinnan rivit ovat perkkin (stride == width), joten kokonaiset
+	// solurivit kierretn yhten tavujonona.
+	if (y >= 2) {
+		rotateCells(s->cells, rows * s->stride, (y / 2) * s->stride);
+	}
+
+	if (y & 1) {
+		// Sarakkeet neljn solun ryhmin ylhlt alas; alimman rivin alemmat
+		// palikat kiertvt ylimmlle riville.
+		last = s->cells + (rows - 1) * s->stride;
+		for (i = 0; i + 4 <= s->width; i += 4) {
+			memcpy(&carry, last + i, 4);
+			for (j = 0; j < rows; j++) {
+				p = s->cells + j * s->stride + i;
+				memcpy(&cur, p, 4);
+				next = ((carry >> 4) & 0x0f0f0f0fUL) | ((cur << 4) & 0xf0f0f0f0UL);
+				memcpy(p, &next, 4);
+				carry = cur;
+			}
+		}
+		for (; i < s->width; i++) {
+			b = last[i];
+			for (j = 0; j < rows; j++) {
+				p = s->cells + j * s->stride + i;
+				c = *p;
+				*p = ((b >> 4) & MASK_TOP) | (c << 4);
+				b = c;
+			}
+		}
+	}
+}
+
+/**
+ * Pakkaa blockColorBufferin ruudun kokoiseen pakattuun pintaan. Toroidista
+ * origoa ja rivisiirtoja ei huomioida.
+ */
+void packBlockBuffer(PackedSurface* dst) {
+	const BlockKernels* kernels = getBlockKernels();
+	int i;
+
+	for (i = 0; i < ROWS; i++) {
+		kernels->packAttrs(dst->cells + i * dst->stride, blockColorBuffer[i * 2], blockColorBuffer[i * 2 + 1], COLS);
+	}
+}
+
+void unpackToBlockBuffer(const PackedSurface* src) {
+	const char* p;
+	int i, j;
+
+	for (i = 0; i < ROWS; i++) {
+		p = src->cells + i * src->stride;
+		for (j = 0; j < COLS; j++) {
+			blockColorBuffer[i * 2][j] = p[j] & 0x0f;
+			blockColorBuffer[i * 2 + 1][j] = (p[j] >> 4) & 0x0f;
+		}
+	}
+	markBlockBufferDirty(0, 0, COLS, ROWS * 2);
+}
@@ -1,30 +1,36 @@
 #include "palettes.h"
 
 /**
- * spd < 1.
+ * spd < 1. Kertym on paletissa, joten eri palettien hivytykset eivt
+ * sotke toisiaan.
  */
 void fadeToPaletteSlow(Palette* palette, float spd) {
-	static float i = 0.0;
-
-	i += spd;
-	if (i >= 1) {
+	(*palette).slowFade += spd;
+	if ((*palette).slowFade >= 1) {
 		fadeToPalette(palette);
-		i = 0;
+		(*palette).slowFade = 0;
 	}
 }
 
+/**
+ * Askel kohti palettia; kaikki 16 vri lhetetn yhten ern.
+ */
 void fadeToPalette(Palette* palette) {
 	int i;
+	beginColorBatch();
 	for (i = 0; i < 16; i++) {
 		fadeToColor(i, (*palette).r[i], (*palette).g[i], (*palette).b[i]);
 	}
+	endColorBatch();
 }
 
 void loadPalette(Palette* palette) {
 	int i;
+	beginColorBatch();
 	for (i = 0; i < 16; i++) {
 		setColor(i, (*palette).r[i], (*palette).g[i], (*palette).b[i]);
 	}
+	endColorBatch();
 }
 
 void savePalette(Palette* palette) {
@@ -35,3 +41,120 @@ void savePalette(Palette* palette) {
 		(*palette).setColor(i, r, g, b);
 	}
 }
+
+/**
+ * Hivytysraita. Vrien alku- ja loppuarvot ovat 8.8-kiintolukuina
+ * (komponentti * 256); colors on raidan vrien bittimaski ja elapsed
+ * kulunut aika millisekunteina.
+ */
+typedef struct FadeTrack {
+	int colors;
+	int duration;
+	int elapsed;
+	int easing;
+	int from[16][3];
+	int to[16][3];
+} FadeTrack;
+
+static FadeTrack fadeTracks[MAX_FADE_TRACKS];
+
+/**
+ * Hivytyksen edistyminen 0 ... 256 (8.8) kyrll easing.
+ */
+static int ease(int t, int easing) {
+	switch (easing) {
+	case EASE_IN:
+		return (t * t) >> 8;
+	case EASE_OUT:
+		return (t * (512 - t)) >> 8;
+	case EASE_IN_OUT:
+		return (t * t * (768 - 2 * t)) >> 16;
+	default:
+		return t;
+	}
+}
+
+int startPaletteFade(Palette* palette, int colors, int duration, int easing) {
+	int i, j, r, g, b, track = -1;
+
+	colors &= ALL_COLORS;
+	for (i = 0; i < MAX_FADE_TRACKS; i++) {
+		if (fadeTracks[i].colors == 0 && track < 0) {
+			track = i;
+		}
+	}
+	if (track < 0 || colors == 0) {
+		return -1;
+	}
+
+	// Vanhat raidat luopuvat uuden raidan vreist.
+	for (i = 0; i < MAX_FADE_TRACKS; i++) {
+		fadeTracks[i].colors &= ~colors;
+	}
+
+	fadeTracks[track].colors = colors;
+	fadeTracks[track].duration = (duration > 0) ? duration : 0;
+	fadeTracks[track].elapsed = 0;
+	fadeTracks[track].easing = easing;
+	for (j = 0; j < 16; j++) {
+		getColor(j, &r, &g, &b);
+		fadeTracks[track].from[j][0] = r << 8;
+		fadeTracks[track].from[j][1] = g << 8;
+		fadeTracks[track].from[j][2] = b << 8;
+		fadeTracks[track].to[j][0] = ((*palette).r[j] & 63) << 8;
+		fadeTracks[track].to[j][1] = ((*palette).g[j] & 63) << 8;
+		fadeTracks[track].to[j][2] = ((*palette).b[j] & 63) << 8;
+	}
+	return track;
+}
+
+void stopPaletteFade(int track) {
+	if (track >= 0 && track < MAX_FADE_TRACKS) {
+		fadeTracks[track].colors = 0;
+	}
+}
+
+bool isPaletteFadeActive(int track) {
+	return track >= 0 && track < MAX_FADE_TRACKS && fadeTracks[track].colors != 0;
+}
+
+int updatePaletteFades(int elapsed) {
+	FadeTrack* f;
+	int i, j, k, t, v[3], active = 0;
+
+	beginColorBatch();
+	for (i = 0; i < MAX_FADE_TRACKS; i++) {
+		f = &fadeTracks[i];
+		if (f->colors == 0) {
+			continue;
+		}
+
+		f->elapsed += elapsed;
+		if (f->elapsed >= f->duration) {
+			f->elapsed = f->duration;
+			t = 256;
+		}
+		else {
+			t = ease((int)((long)f->elapsed * 256 / f->duration), f->easing);
+		}
+
+		for (j = 0; j < 16; j++) {
+			if (!(f->colors & (1 << j))) {
+				continue;
+			}
+			for (k = 0; k < 3; k++) {
+				v[k] = (f->from[j][k] + (((f->to[j][k] - f->from[j][k]) * t) >> 8) + 128) >> 8;
+			}
+			setColor(j, v[0], v[1], v[2]);
+		}
+
+		if (t == 256) {
+			f->colors = 0;
+		}
+		else {
+			active++;
+		}
+	}
+	endColorBatch();
+	return active;
+}
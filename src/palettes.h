@@ -9,12 +9,16 @@ public:
 	int g[16];
 	int b[16];
 
+	// fadeToPaletteSlown kertym tt palettia kohti.
+	float slowFade;
+
 	Palette() {
 		for (int i = 0; i < 16; i++) {
 			r[i] = 0;
 			g[i] = 0;
 			b[i] = 0;
 		}
+		slowFade = 0.0;
 	}
 
 	void setColor(int c, int rr, int gg, int bb) {
@@ -29,4 +33,34 @@ void savePalette(Palette* palette);
 void fadeToPalette(Palette* palette);
 void fadeToPaletteSlow(Palette* palette, float spd);
 
+// Hivytysraitojen mr ja raidan vrit (bittimaski, bitti i = vri i).
+#define MAX_FADE_TRACKS 8
+#define ALL_COLORS 0xffff
+
+// Hivytyksen kulku ajan funktiona.
+#define EASE_LINEAR 0
+#define EASE_IN 1
+#define EASE_OUT 2
+#define EASE_IN_OUT 3
+
+/**
+ * Ajastettu hivytys: maskin vrit siirtyvt nykyisist arvoistaan
+ * paletin arvoihin duration millisekunnissa easing-kyr pitkin. Paletti
+ * kopioidaan, joten sen ei tarvitse sily. Raitoja voi olla kynniss
+ * MAX_FADE_TRACKS yht aikaa; jos uusi raita koskee jo hivytettv
+ * vri, vri siirtyy uudelle raidalle. Palauttaa raidan numeron tai -1,
+ * jos vapaita raitoja ei ole.
+ */
+int startPaletteFade(Palette* palette, int colors, int duration, int easing);
+void stopPaletteFade(int track);
+bool isPaletteFadeActive(int track);
+
+/**
+ * Siirt kaikkia raitoja elapsed millisekuntia eteenpin ja lhett
+ * vrit yhten ern (ks. beginColorBatch). Kutsutaan kerran ruudussa
+ * edellisest kutsusta kuluneella ajalla. Palauttaa kynniss olevien
+ * raitojen mrn.
+ */
+int updatePaletteFades(int elapsed);
+
 #endif
@@ -0,0 +1,388 @@
+/**
+ * Monikulmioiden ja kolmioiden tytt (ks. poly.h).
+ *
+ * Srmt askelletaan ylhlt alas 16.16-kiintolukuina. Srmn x lasketaan
+ * kunkin palikkarivin keskikohdalla (y + 0.5), ja sen kohdalla srmn raja on
+ * ensimminen palikka, jonka keskipiste on srmn oikealla puolella. Raja
+ * lasketaan kaikkialla samalla tavalla, joten vierekkiset kuviot kohtaavat
+ * tarkasti.
+ */
+
+#include "poly.h"
+
+// Kolmioern srmien ja srmien rajataulukon enimmiskoot.
+#define MAX_BATCH_EDGES 512
+#define MAX_BATCH_TRIANGLES 256
+#define EDGE_HASH_SIZE 1024
+#define SPAN_BUFFER_SIZE 16384
+
+typedef struct PolyEdge {
+	int y0;		// ensimminen palikkarivi
+	int y1;		// viimeist seuraava rivi
+	int x;		// x rivill y0 (16.16)
+	int slope;	// x:n muutos rivi kohden (16.16)
+	int dir;	// 1 alaspin, -1 ylspin (nonzero-snnlle)
+	int bx;		// raja nykyisell rivill
+} PolyEdge;
+
+#define EDGE_BOUNDARY(e) (((e)->x + 0x7fff) >> 16)
+
+/**
+ * Alustaa srmn pisteest (xa, ya) pisteeseen (xb, yb). Palauttaa false
+ * vaakasuoralle srmlle, joka ei osu yhteenkn riviin.
+ */
+static bool initEdge(PolyEdge* e, int xa, int ya, int xb, int yb) {
+	int t;
+
+	if (ya == yb) {
+		return false;
+	}
+
+	e->dir = 1;
+	if (ya > yb) {
+		t = xa; xa = xb; xb = t;
+		t = ya; ya = yb; yb = t;
+		e->dir = -1;
+	}
+	e->y0 = ya;
+	e->y1 = yb;
+	e->slope = (xb - xa) * 65536 / (yb - ya);
+	e->x = xa * 65536 + e->slope / 2;
+
+	return true;
+}
+
+/**
+ * Siirt srmn alun riville y (y >= e->y0), kun alku on leikattu pois.
+ */
+static void skipEdgeTo(PolyEdge* e, int y) {
+	e->x += e->slope * (y - e->y0);
+	e->y0 = y;
+}
+
+static void fillSpan(BlockSurface* s, int y, int x0, int x1, int color) {
+	if (x0 < 0) { x0 = 0; }
+	if (x1 > s->width) { x1 = s->width; }
+	if (x0 < x1) {
+		memset(s->pixels + y * s->stride + x0, color, x1 - x0);
+	}
+}
+
+static void polyChanged(BlockSurface* s, int x0, int y0, int x1, int y1) {
+	if (s->pixels == (char*)blockColorBuffer) {
+		markBlockBufferDirty(x0, y0, x1 - x0 + 1, y1 - y0 + 1);
+	}
+}
+
+void fillPolygonToSurface(BlockSurface* s, const int* points, int n, int rule, int color) {
+	static PolyEdge edges[MAX_POLY_EDGES];
+	static PolyEdge* pending[MAX_POLY_EDGES];
+	static PolyEdge* active[MAX_POLY_EDGES];
+	PolyEdge* e;
+	int i, j, y, yEnd, count = 0, next = 0, activeCount = 0, winding;
+	int minX = points[0], maxX = points[0];
+
+	if (n < 3 || n > MAX_POLY_EDGES) {
+		return;
+	}
+
+	// Srmtaulukko: vaakasuorat srmt jtetn pois, loput lajitellaan
+	// ylimmn rivins mukaan.
+	for (i = 0; i < n; i++) {
+		j = (i + 1 == n) ? 0 : i + 1;
+		if (points[i * 2] < minX) { minX = points[i * 2]; }
+		if (points[i * 2] > maxX) { maxX = points[i * 2]; }
+		if (!initEdge(&edges[count], points[i * 2], points[i * 2 + 1], points[j * 2], points[j * 2 + 1])) {
+			continue;
+		}
+		e = &edges[count++];
+		for (j = count - 1; j > 0 && pending[j - 1]->y0 > e->y0; j--) {
+			pending[j] = pending[j - 1];
+		}
+		pending[j] = e;
+	}
+	if (count == 0) {
+		return;
+	}
+
+	y = (pending[0]->y0 > 0) ? pending[0]->y0 : 0;
+	yEnd = pending[0]->y1;
+	for (i = 1; i < count; i++) {
+		if (pending[i]->y1 > yEnd) { yEnd = pending[i]->y1; }
+	}
+	if (yEnd > s->height) { yEnd = s->height; }
+	if (y >= yEnd) {
+		return;
+	}
+	polyChanged(s, minX, y, maxX, yEnd - 1);
+
+	for (; y < yEnd; y++) {
+		// Riville tulevat srmt aktiivisiksi, pttyneet pois.
+		while (next < count && pending[next]->y0 <= y) {
+			e = pending[next++];
+			if (e->y1 <= y) {
+				continue;
+			}
+			if (e->y0 < y) {
+				skipEdgeTo(e, y);
+			}
+			active[activeCount++] = e;
+		}
+		for (i = 0, j = 0; i < activeCount; i++) {
+			if (active[i]->y1 > y) {
+				active[j++] = active[i];
+			}
+		}
+		activeCount = j;
+
+		// Rajat jrjestykseen; jrjestys muuttuu rivilt toiselle vhn,
+		// joten lisyslajittelu on nopein.
+		for (i = 0; i < activeCount; i++) {
+			e = active[i];
+			e->bx = EDGE_BOUNDARY(e);
+			for (j = i; j > 0 && active[j - 1]->bx > e->bx; j--) {
+				active[j] = active[j - 1];
+			}
+			active[j] = e;
+		}
+
+		if (rule == FILL_NONZERO) {
+			winding = 0;
+			for (i = 0; i < activeCount; i++) {
+				if (winding != 0) {
+					fillSpan(s, y, active[i - 1]->bx, active[i]->bx, color);
+				}
+				winding += active[i]->dir;
+			}
+		}
+		else {
+			for (i = 0; i + 1 < activeCount; i += 2) {
+				fillSpan(s, y, active[i]->bx, active[i + 1]->bx, color);
+			}
+		}
+
+		for (i = 0; i < activeCount; i++) {
+			active[i]->x += active[i]->slope;
+		}
+	}
+}
+
+/**
+ * Kolmioern srm: rajat riveille top ... bottom - 1 (leikattuna pinnan
+ * korkeuteen) ovat taulukossa spans kohdasta offset alkaen. slot on srmn
+ * paikka hajautustaulussa.
+ */
+typedef struct BatchEdge {
+	int a;
+	int b;
+	int top;
+	int bottom;
+	int offset;
+	int slot;
+} BatchEdge;
+
+static BatchEdge batchEdges[MAX_BATCH_EDGES];
+// Srmn numero + 1; 0 on tyhj paikka.
+static int edgeHash[EDGE_HASH_SIZE];
+static short spans[SPAN_BUFFER_SIZE];
+static int triangleEdges[MAX_BATCH_TRIANGLES][3];
+static int batchEdgeCount, spanCount;
+
+// Tyhjent vain ern kyttmt hajautustaulun paikat.
+static void resetBatch(void) {
+	int i;
+
+	for (i = 0; i < batchEdgeCount; i++) {
+		edgeHash[batchEdges[i].slot] = 0;
+	}
+	batchEdgeCount = 0;
+	spanCount = 0;
+}
+
+/**
+ * Palauttaa krkien a ja b vlisen srmn numeron. Uuden srmn rajat
+ * lasketaan heti kaikille sen riveille.
+ */
+static int getBatchEdge(BlockSurface* s, const int* vertices, int a, int b) {
+	BatchEdge* be;
+	PolyEdge e;
+	int h, t, y;
+
+	if (a > b) {
+		t = a; a = b; b = t;
+	}
+
+	h = (a * 31 + b) & (EDGE_HASH_SIZE - 1);
+	while (edgeHash[h] != 0) {
+		be = &batchEdges[edgeHash[h] - 1];
+		if (be->a == a && be->b == b) {
+			return edgeHash[h] - 1;
+		}
+		h = (h + 1) & (EDGE_HASH_SIZE - 1);
+	}
+
+	edgeHash[h] = batchEdgeCount + 1;
+	be = &batchEdges[batchEdgeCount];
+	be->a = a;
+	be->b = b;
+	be->slot = h;
+	be->top = be->bottom = 0;
+	be->offset = spanCount;
+
+	if (initEdge(&e, vertices[a * 2], vertices[a * 2 + 1], vertices[b * 2], vertices[b * 2 + 1])) {
+		if (e.y0 < 0) {
+			skipEdgeTo(&e, 0);
+		}
+		if (e.y1 > s->height) {
+			e.y1 = s->height;
+		}
+		if (e.y0 < e.y1) {
+			be->top = e.y0;
+			be->bottom = e.y1;
+			for (y = e.y0; y < e.y1; y++) {
+				spans[spanCount++] = (short)EDGE_BOUNDARY(&e);
+				e.x += e.slope;
+			}
+		}
+	}
+
+	return batchEdgeCount++;
+}
+
+/**
+ * Tytt ern kolmiot. Kolmion jokaisella rivill on tsmlleen kaksi
+ * srm, joiden rajojen vli tytetn.
+ */
+static void drawBatch(BlockSurface* s, const char* colors, int count) {
+	BatchEdge* e;
+	int i, k, n, y, y0, y1, bx[2];
+
+	for (i = 0; i < count; i++) {
+		y0 = s->height;
+		y1 = 0;
+		for (k = 0; k < 3; k++) {
+			e = &batchEdges[triangleEdges[i][k]];
+			if (e->top < e->bottom) {
+				if (e->top < y0) { y0 = e->top; }
+				if (e->bottom > y1) { y1 = e->bottom; }
+			}
+		}
+
+		for (y = y0; y < y1; y++) {
+			n = 0;
+			for (k = 0; k < 3 && n < 2; k++) {
+				e = &batchEdges[triangleEdges[i][k]];
+				if (y >= e->top && y < e->bottom) {
+					bx[n++] = spans[e->offset + y - e->top];
+				}
+			}
+			if (n == 2) {
+				if (bx[0] < bx[1]) {
+					fillSpan(s, y, bx[0], bx[1], colors[i]);
+				}
+				else {
+					fillSpan(s, y, bx[1], bx[0], colors[i]);
+				}
+			}
+		}
+	}
+}
+
+void fillTrianglesToSurface(BlockSurface* s, const int* vertices, const int* indices, int count, const char* colors) {
+	int i, k, first = 0, batch = 0;
+	int minX = 0, minY = 0, maxX = -1, maxY = -1, x, y;
+	int points[6];
+
+	// Hyvin korkeilla pinnoilla srmien rajat eivt vlttmtt mahdu
+	// taulukkoon; kolmiot piirretn silloin yksitellen.
+	if (3 * s->height > SPAN_BUFFER_SIZE) {
+		for (i = 0; i < count; i++) {
+			for (k = 0; k < 3; k++) {
+				points[k * 2] = vertices[indices[i * 3 + k] * 2];
+				points[k * 2 + 1] = vertices[indices[i * 3 + k] * 2 + 1];
+			}
+			fillPolygonToSurface(s, points, 3, FILL_EVEN_ODD, colors[i]);
+		}
+		return;
+	}
+
+	resetBatch();
+	for (i = 0; i < count; i++) {
+		// Er piirretn, kun seuraavan kolmion srmt eivt ehk en mahdu.
+		if (batch == MAX_BATCH_TRIANGLES || batchEdgeCount + 3 > MAX_BATCH_EDGES || spanCount + 3 * s->height > SPAN_BUFFER_SIZE) {
+			drawBatch(s, colors + first, batch);
+			resetBatch();
+			first = i;
+			batch = 0;
+		}
+
+		for (k = 0; k < 3; k++) {
+			triangleEdges[batch][k] = getBatchEdge(s, vertices, indices[i * 3 + k], indices[i * 3 + (k + 1) % 3]);
+
+			x = vertices[indices[i * 3 + k] * 2];
+			y = vertices[indices[i * 3 + k] * 2 + 1];
+			if (maxX < minX) {
+				minX = maxX = x;
+				minY = maxY = y;
+			}
+			if (x < minX) { minX = x; }
+			if (x > maxX) { maxX = x; }
+			if (y < minY) { minY = y; }
+			if (y > maxY) { maxY = y; }
+		}
+		batch++;
+	}
+	drawBatch(s, colors + first, batch);
+
+	if (count > 0) {
+		polyChanged(s, minX, minY, maxX, maxY);
+	}
+}
+
+void fillTriangleToSurface(BlockSurface* s, int x0, int y0, int x1, int y1, int x2, int y2, int color) {
+	int vertices[6];
+	static const int indices[3] = { 0, 1, 2 };
+	char c = color;
+
+	vertices[0] = x0; vertices[1] = y0;
+	vertices[2] = x1; vertices[3] = y1;
+	vertices[4] = x2; vertices[5] = y2;
+	fillTrianglesToSurface(s, vertices, indices, 1, &c);
+}
+
+/**
+ * Leikkausalueen (ks. pushClipRect) kanssa kuvio piirretn leikkausalueen
+ * ikkunaan siirrettyn, ja koko leikkausalue merkitn muuttuneeksi.
+ */
+void fillPolygonToBlockBuffer(const int* points, int n, int rule, int color) {
+	static int moved[MAX_POLY_EDGES * 2];
+	BlockSurface view;
+	int x, y, w, h, i;
+
+	getClipRect(&x, &y, &w, &h);
+	if ((w == COLS && h == ROWS * 2) || n > MAX_POLY_EDGES) {
+		fillPolygonToSurface(&screenBlockSurface, points, n, rule, color);
+		return;
+	}
+	for (i = 0; i < n; i++) {
+		moved[i * 2] = points[i * 2] - x;
+		moved[i * 2 + 1] = points[i * 2 + 1] - y;
+	}
+	getClipSurface(&view);
+	fillPolygonToSurface(&view, moved, n, rule, color);
+	markBlockBufferDirty(x, y, w, h);
+}
+
+void fillTriangleToBlockBuffer(int x0, int y0, int x1, int y1, int x2, int y2, int color) {
+	BlockSurface view;
+	int x, y, w, h;
+
+	getClipRect(&x, &y, &w, &h);
+	if (w == COLS && h == ROWS * 2) {
+		fillTriangleToSurface(&screenBlockSurface, x0, y0, x1, y1, x2, y2, color);
+		return;
+	}
+	getClipSurface(&view);
+	fillTriangleToSurface(&view, x0 - x, y0 - y, x1 - x, y1 - y, x2 - x, y2 - y, color);
+	markBlockBufferDirty(x, y, w, h);
+}
@@ -0,0 +1,44 @@
+#ifndef _POLY_H
+#define _POLY_H
+
+#include "surface.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Tyttsnnt itsen leikkaaville monikulmioille.
+#define FILL_EVEN_ODD 0
+#define FILL_NONZERO 1
+
+// Monikulmion srmien enimmismr.
+#define MAX_POLY_EDGES 256
+
+/**
+ * Tytetyt monikulmiot ja kolmiot. Krkipisteet ovat palikoiden kulmissa ja
+ * palikka tytetn, jos sen keskipiste on kuvion sisll. Kuten fillRectiss,
+ * oikea ja alareuna eivt siis kuulu kuvioon: (0, 0), (10, 0), (10, 10),
+ * (0, 10) tytt 10 x 10 palikkaa, ja yhteisen srmn jakavat kuviot eivt
+ * mene pllekkin eivtk jt vli.
+ *
+ * Srmi askelletaan 16.16-kiintolukuina, joten koordinaattien on oltava
+ * vlilt -8192 ... 8191. Pisteet annetaan taulukkona x0, y0, x1, y1, ...
+ */
+void fillPolygonToSurface(BlockSurface* s, const int* points, int n, int rule, int color);
+void fillTriangleToSurface(BlockSurface* s, int x0, int y0, int x1, int y1, int x2, int y2, int color);
+
+/**
+ * Piirt count kolmiota, joiden krjet ovat indeksej (kolme per kolmio)
+ * taulukkoon vertices (x, y -parit). Kolmion i vri on colors[i]. Useamman
+ * kolmion yhteiset srmt lasketaan vain kerran.
+ */
+void fillTrianglesToSurface(BlockSurface* s, const int* vertices, const int* indices, int count, const char* colors);
+
+void fillPolygonToBlockBuffer(const int* points, int n, int rule, int color);
+void fillTriangleToBlockBuffer(int x0, int y0, int x1, int y1, int x2, int y2, int color);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
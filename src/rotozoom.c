@@ -0,0 +1,199 @@
+/**
+ * Kierto ja skaalaus (ks. rotozoom.h).
+ *
+ * Kohteen palikan (i, j) keskipiste kuvautuu lhteen pisteeseen
+ *   u = pivotX + 1/2 + ((i - x) * cos + (j - y) * sin) / scale
+ *   v = pivotY + 1/2 + ((j - y) * cos - (i - x) * sin) / scale,
+ * ja nytteeksi otetaan palikka, jonka sisn piste osuu. Askeleet ovat
+ * kokonaislukuja (16.16), joten rivin alun koordinaatit voidaan laskea
+ * doubleina tarkasti ja rivin sisll riitt yhteenlasku.
+ */
+
+#include "rotozoom.h"
+#include "kernels.h"
+
+#define FIX_ONE 65536.0
+
+static double fixRound(double v) {
+	return floor(v * FIX_ONE + 0.5);
+}
+
+/**
+ * Ensimminen palikka k (0 <= k <= n), jolla u + k * du on ylittnyt rajan
+ * c askeleen suuntaan. Jakolaskun pyristys korjataan tarkistamalla.
+ */
+#define CROSSED(k) ((du > 0) ? u + (k) * du >= c : u + (k) * du < c)
+
+static int crossing(double u, double du, double c, int n) {
+	double a;
+	int k;
+
+	a = (du > 0) ? ceil((c - u) / du) : floor((c - u) / du) + 1;
+	k = (a < 0) ? 0 : (a > n) ? n : (int)a;
+	while (k > 0 && CROSSED(k - 1)) { k--; }
+	while (k < n && !CROSSED(k)) { k++; }
+	return k;
+}
+
+/**
+ * Rivin palikat k0 ... k1 - 1 ovat pinnalla (0 <= u + k * du < limit);
+ * niit ennen ja jlkeen olevat pinnan eri puolilla. Jos askel hypp koko
+ * pinnan yli, vli on tyhj, mutta puoli vaihtuu silti kohdassa k0.
+ */
+static void inRange(double u, double du, double limit, int n, int* k0, int* k1) {
+	if (du == 0) {
+		*k0 = (u >= 0 && u < limit) ? 0 : n;
+		*k1 = n;
+	}
+	else if (du > 0) {
+		*k0 = crossing(u, du, 0, n);
+		*k1 = crossing(u, du, limit, n);
+	}
+	else {
+		*k0 = crossing(u, du, limit, n);
+		*k1 = crossing(u, du, 0, n);
+	}
+}
+
+/**
+ * Lhdekoordinaatti palikan k kohdalla rajattuna pinnan sisn. Reunan yli
+ * menneen akselin askel nollataan: osan sisll se ei palaa pinnalle.
+ */
+static void clampAxis(double u, double du, double limit, int k, uint32_t* start, uint32_t* step) {
+	double t = u + k * du;
+
+	if (t < 0) {
+		*start = 0;
+		*step = 0;
+	}
+	else if (t >= limit) {
+		*start = (uint32_t)(limit - FIX_ONE);
+		*step = 0;
+	}
+	else {
+		*start = (uint32_t)t;
+		*step = (uint32_t)(long)du;
+	}
+}
+
+static double wrapFix(double v, double limit) {
+	v = fmod(v, limit);
+	return (v < 0) ? v + limit : v;
+}
+
+/**
+ * Toistuva pinta. Koordinaatit ja askeleet pidetn vlill 0 ... limit,
+ * jolloin yksi vhennys riitt palauttamaan ylivuotaneen koordinaatin.
+ * Kahden potenssin kokoisilla pinnoilla maskataan vhennysten sijaan.
+ */
+static void wrapRow(char* row, const BlockSurface* src, double u, double v, double du, double dv, int n) {
+	const uint32_t w = (uint32_t)src->width << 16, h = (uint32_t)src->height << 16;
+	const uint32_t su = (uint32_t)wrapFix(du, w), sv = (uint32_t)wrapFix(dv, h);
+	const char* pixels = src->pixels;
+	const int stride = src->stride;
+	uint32_t uu = (uint32_t)wrapFix(u, w), vv = (uint32_t)wrapFix(v, h);
+	unsigned mw = src->width - 1, mh = src->height - 1;
+	int i;
+
+	if ((src->width & mw) == 0 && (src->height & mh) == 0) {
+		for (i = 0; i < n; i++) {
+			row[i] = pixels[((vv >> 16) & mh) * stride + ((uu >> 16) & mw)];
+			uu += su;
+			vv += sv;
+		}
+		return;
+	}
+
+	for (i = 0; i < n; i++) {
+		row[i] = pixels[(vv >> 16) * stride + (uu >> 16)];
+		uu += su;
+		if (uu >= w) { uu -= w; }
+		vv += sv;
+		if (vv >= h) { vv -= h; }
+	}
+}
+
+void sampleSurfaceRow(char* row, int n, const BlockSurface* src, double u, double v, double du, double dv, int mode) {
+	const BlockKernels* k = getBlockKernels();
+	const double w = src->width * FIX_ONE, h = src->height * FIX_ONE;
+	int bounds[6], a0, a1, b0, b1, i, t, s, e;
+	uint32_t su, sv, stepu, stepv;
+
+	if (mode == ROTO_WRAP) {
+		wrapRow(row, src, u, v, du, dv, n);
+		return;
+	}
+
+	inRange(u, du, w, n, &a0, &a1);
+	inRange(v, dv, h, n, &b0, &b1);
+
+	if (mode == ROTO_TRANSPARENT) {
+		s = (a0 > b0) ? a0 : b0;
+		e = (a1 < b1) ? a1 : b1;
+		if (s < e) {
+			k->affineRow(row + s, src->pixels, src->stride, (uint32_t)(u + s * du), (uint32_t)(v + s * dv),
+				(uint32_t)(long)du, (uint32_t)(long)dv, e - s);
+		}
+		return;
+	}
+
+	// Osat, joiden sisll kumpikin akseli on joko pinnalla tai
+	// kokonaan sen toisella puolella.
+	bounds[0] = 0;
+	bounds[1] = a0;
+	bounds[2] = a1;
+	bounds[3] = b0;
+	bounds[4] = b1;
+	bounds[5] = n;
+	for (i = 1; i < 6; i++) {
+		for (t = i; t > 0 && bounds[t - 1] > bounds[t]; t--) {
+			s = bounds[t];
+			bounds[t] = bounds[t - 1];
+			bounds[t - 1] = s;
+		}
+	}
+	for (i = 0; i < 5; i++) {
+		s = bounds[i];
+		e = bounds[i + 1];
+		if (s == e) {
+			continue;
+		}
+		clampAxis(u, du, w, s, &su, &stepu);
+		clampAxis(v, dv, h, s, &sv, &stepv);
+		k->affineRow(row + s, src->pixels, src->stride, su, sv, stepu, stepv, e - s);
+	}
+}
+
+void rotozoomSurface(BlockSurface* dst, int x, int y, const BlockSurface* src, int pivotX, int pivotY, double angle, double scale, int mode) {
+	double du, dv, dudy, dvdy, u0, v0;
+	int j;
+
+	if (dst->width <= 0 || dst->height <= 0 || src->width <= 0 || src->height <= 0 || scale <= 0) {
+		return;
+	}
+
+	du = fixRound(cos(angle) / scale);
+	dv = -fixRound(sin(angle) / scale);
+	dudy = -dv;
+	dvdy = du;
+	u0 = (pivotX + 0.5) * FIX_ONE - x * du - y * dudy;
+	v0 = (pivotY + 0.5) * FIX_ONE - x * dv - y * dvdy;
+
+	for (j = 0; j < dst->height; j++) {
+		sampleSurfaceRow(dst->pixels + j * dst->stride, dst->width, src, u0 + j * dudy, v0 + j * dvdy, du, dv, mode);
+	}
+
+	if (dst->pixels == (char*)blockColorBuffer) {
+		markBlockBufferDirty(0, 0, dst->width, dst->height);
+	}
+}
+
+void rotozoomToBlockBuffer(int x, int y, const BlockSurface* src, int pivotX, int pivotY, double angle, double scale, int mode) {
+	BlockSurface view;
+	int cx, cy, cw, ch;
+
+	getClipRect(&cx, &cy, &cw, &ch);
+	getClipSurface(&view);
+	rotozoomSurface(&view, x - cx, y - cy, src, pivotX, pivotY, angle, scale, mode);
+	markBlockBufferDirty(cx, cy, cw, ch);
+}
@@ -0,0 +1,44 @@
+#ifndef _ROTOZOOM_H
+#define _ROTOZOOM_H
+
+#include "surface.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Mit lhdepinnan ulkopuolelle osuville palikoille tehdn.
+#define ROTO_WRAP 0			// pinta toistuu (laatoitus)
+#define ROTO_CLAMP 1		// lhimmn reunapalikan vri
+#define ROTO_TRANSPARENT 2	// kohde j ennalleen
+
+/**
+ * Piirt src:n kierrettyn kulman angle verran (radiaaneina) ja
+ * skaalattuna kertoimella scale (> 1 suurentaa) koko dst-pinnalle niin,
+ * ett src:n palikka (pivotX, pivotY) osuu dst:n palikkaan (x, y).
+ *
+ * Kulma ja skaala muutetaan kerran 16.16-kiintolukuaskeliksi, ja rivin
+ * sisll lhdekoordinaatteihin vain listn askel palikkaa kohden. Rivi
+ * jaetaan osiin sen mukaan, miss kohdin se menee lhdepinnan reunojen yli,
+ * joten nytteistyssilmukassa ei ole rajatarkistuksia (ks. affineRow
+ * kernels.h:ssa). Pinnan leveys ja korkeus saavat olla enintn 32767
+ * palikkaa, eik src saa olla dst:n kanssa samaa muistia.
+ */
+void rotozoomSurface(BlockSurface* dst, int x, int y, const BlockSurface* src, int pivotX, int pivotY, double angle, double scale, int mode);
+
+/**
+ * Rivin nytteistys, jota rotozoomSurface kytt: palikka i (0 <= i < n)
+ * saa src:n kohdan (u + i * du, v + i * dv) vrin. Koordinaatit ovat
+ * 16.16-kiintolukuja doubleina, ja askelten du ja dv on oltava
+ * kokonaislukuja (ks. esim. mode7.h).
+ */
+void sampleSurfaceRow(char* row, int n, const BlockSurface* src, double u, double v, double du, double dv, int mode);
+
+// blockBufferiin leikkausalueen (ks. pushClipRect) rajaamana.
+void rotozoomToBlockBuffer(int x, int y, const BlockSurface* src, int pivotX, int pivotY, double angle, double scale, int mode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
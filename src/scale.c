@@ -0,0 +1,165 @@
+/**
+ * Skaalaus (ks. scale.h).
+ *
+ * Kohteen palikan i keskipiste on lhteen kohdassa
+ *   pivot + 1/2 + (i - at + t - 1/2) / scale,
+ * miss t on nytteen paikka palikan sisll: 1/2 lhimmlle palikalle, ja
+ * rasteroinnissa jokin neljnneksien keskikohdista 1/8, 3/8, 5/8 ja 7/8.
+ * Koska kynnysarvo riippuu mys toisen akselin paikasta, kummallekin
+ * akselille tehdn nelj taulukkoa (toisen koordinaatin kaksi alinta
+ * bitti).
+ */
+
+#include "scale.h"
+
+typedef struct ScaleAxis {
+	int srcSize;
+	int dstSize;
+	int at;
+	int pivot;
+	double factor;
+	int phases;
+
+	int lo;				// kohteen palikat lo ... hi - 1 osuvat lhteeseen
+	int hi;
+	bool contiguous;	// index[0] kasvaa yhdell: rivin voi kopioida
+	short index[4][SCALE_MAX_SIZE];
+} ScaleAxis;
+
+static ScaleAxis columns, rows;
+
+/**
+ * Nytteen neljnnes (0-3) sarakkeille ja riveille, [toinen koordinaatti
+ * & 3][oma koordinaatti & 3]. Kumpikin on latinalainen neli, joten
+ * kohteen rivin nelj nytett osuvat tasavlein sen kattamalle lhteen
+ * alueelle, ja nelit ovat toisiinsa nhden ortogonaaliset: 4x4 palikan
+ * alueella jokainen 16 nytepaikasta on kytss kerran.
+ */
+static const unsigned char columnQuarters[4][4] = {
+	{ 0, 2, 3, 1 },
+	{ 1, 3, 2, 0 },
+	{ 2, 0, 1, 3 },
+	{ 3, 1, 0, 2 }
+};
+
+static const unsigned char rowQuarters[4][4] = {
+	{ 0, 1, 2, 3 },
+	{ 1, 0, 3, 2 },
+	{ 2, 3, 0, 1 },
+	{ 3, 2, 1, 0 }
+};
+
+// Lhteen indeksi rajattuna vlille -1 ... size (hyvin pienill kertoimilla).
+static int sourceIndex(double v, int size) {
+	v = floor(v);
+	return (v < -1) ? -1 : (v > size) ? size : (int)v;
+}
+
+static void prepare(ScaleAxis* a, int srcSize, int dstSize, int at, int pivot, double factor, int phases, const unsigned char quarters[4][4]) {
+	double t;
+	int p, i, k;
+
+	if (dstSize > SCALE_MAX_SIZE) {
+		dstSize = SCALE_MAX_SIZE;
+	}
+	if (a->srcSize == srcSize && a->dstSize == dstSize && a->at == at && a->pivot == pivot && a->factor == factor && a->phases == phases) {
+		return;
+	}
+	a->srcSize = srcSize;
+	a->dstSize = dstSize;
+	a->at = at;
+	a->pivot = pivot;
+	a->factor = factor;
+	a->phases = phases;
+
+	a->lo = dstSize;
+	a->hi = 0;
+	for (i = 0; i < dstSize; i++) {
+		k = sourceIndex(pivot + 0.5 + (i - at) / factor, srcSize);
+		if (k >= 0 && k < srcSize) {
+			if (i < a->lo) {
+				a->lo = i;
+			}
+			a->hi = i + 1;
+		}
+	}
+
+	for (p = 0; p < phases; p++) {
+		for (i = a->lo; i < a->hi; i++) {
+			t = (phases == 1) ? 0.5 : (quarters[p][i & 3] + 0.5) / 4;
+			k = sourceIndex(pivot + 0.5 + (i - at + t - 0.5) / factor, srcSize);
+			a->index[p][i] = (k < 0) ? 0 : (k >= srcSize) ? srcSize - 1 : k;
+		}
+	}
+
+	a->contiguous = true;
+	for (i = a->lo + 1; i < a->hi; i++) {
+		if (a->index[0][i] != a->index[0][i - 1] + 1) {
+			a->contiguous = false;
+			break;
+		}
+	}
+}
+
+void scaleSurface(BlockSurface* dst, int x, int y, const BlockSurface* src, int pivotX, int pivotY, double scaleX, double scaleY, int mode) {
+	const char* s[4];
+	const short* col;
+	char* d;
+	int i, j, lo, hi, phases = (mode == SCALE_DITHER) ? 4 : 1;
+
+	if (dst->width <= 0 || dst->height <= 0 || src->width <= 0 || src->height <= 0 || scaleX <= 0 || scaleY <= 0) {
+		return;
+	}
+	prepare(&columns, src->width, dst->width, x, pivotX, scaleX, phases, columnQuarters);
+	prepare(&rows, src->height, dst->height, y, pivotY, scaleY, phases, rowQuarters);
+	lo = columns.lo;
+	hi = columns.hi;
+	if (lo >= hi) {
+		return;
+	}
+
+	for (j = rows.lo; j < rows.hi; j++) {
+		d = dst->pixels + j * dst->stride;
+
+		if (phases == 4) {
+			for (i = 0; i < 4; i++) {
+				s[i] = src->pixels + rows.index[i][j] * src->stride;
+			}
+			col = columns.index[j & 3];
+			for (i = lo; i < hi; i++) {
+				d[i] = s[i & 3][col[i]];
+			}
+			continue;
+		}
+
+		// Suurennettaessa sama lhderivi toistuu: kopioidaan edellinen.
+		if (j > rows.lo && rows.index[0][j] == rows.index[0][j - 1]) {
+			memcpy(d + lo, d - dst->stride + lo, hi - lo);
+			continue;
+		}
+		s[0] = src->pixels + rows.index[0][j] * src->stride;
+		if (columns.contiguous) {
+			memcpy(d + lo, s[0] + columns.index[0][lo], hi - lo);
+		}
+		else {
+			col = columns.index[0];
+			for (i = lo; i < hi; i++) {
+				d[i] = s[0][col[i]];
+			}
+		}
+	}
+
+	if (dst->pixels == (char*)blockColorBuffer && rows.lo < rows.hi) {
+		markBlockBufferDirty(lo, rows.lo, hi - lo, rows.hi - rows.lo);
+	}
+}
+
+void scaleToBlockBuffer(int x, int y, const BlockSurface* src, int pivotX, int pivotY, double scaleX, double scaleY, int mode) {
+	BlockSurface view;
+	int cx, cy, cw, ch;
+
+	getClipRect(&cx, &cy, &cw, &ch);
+	getClipSurface(&view);
+	scaleSurface(&view, x - cx, y - cy, src, pivotX, pivotY, scaleX, scaleY, mode);
+	markBlockBufferDirty(cx, cy, cw, ch);
+}
@@ -0,0 +1,46 @@
+#ifndef _SCALE_H
+#define _SCALE_H
+
+#include "surface.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Nytteistys: lhin palikka tai jrjestetty rasterointi (ks. scaleSurface).
+#define SCALE_NEAREST 0
+#define SCALE_DITHER 1
+
+// Kohdepinnasta ksitelln enintn nin monta palikkaa kumpaankin suuntaan.
+#define SCALE_MAX_SIZE 1024
+
+/**
+ * Piirt src:n skaalattuna kertoimilla scaleX ja scaleY (> 1 suurentaa,
+ * murtoluvutkin kyvt) dst:lle niin, ett src:n palikka (pivotX, pivotY)
+ * osuu dst:n palikkaan (x, y). Kohteen palikat, joiden keskipiste ei osu
+ * lhteeseen, jvt ennalleen.
+ *
+ * Jokaiselle kohteen sarakkeelle ja riville lasketaan taulukkoon, mist
+ * lhteen sarakkeesta ja rivist se luetaan. Taulukot silytetn, joten
+ * toistuvat skaalaukset samoilla arvoilla (esim. zoomaus askel kerrallaan)
+ * eivt laske niit uudelleen; leveys- ja korkeussuunnan taulukot
+ * tarkistetaan erikseen.
+ *
+ * SCALE_DITHER siirt nytteen paikkaa kohdepalikan sisll jrjestetysti
+ * 4x4 palikan jaksoissa. Suurennettaessa reunat porrastuvat tasaisemmin,
+ * ja pienennettess (kertoimeen 1/4 asti) jokaisen kohderivin nytteet
+ * jakautuvat koko sen kattamalle lhteen alueelle, joten ohuetkaan viivat
+ * eivt katoa kuten SCALE_NEAREST-tilassa.
+ *
+ * src ei saa olla dst:n kanssa samaa muistia.
+ */
+void scaleSurface(BlockSurface* dst, int x, int y, const BlockSurface* src, int pivotX, int pivotY, double scaleX, double scaleY, int mode);
+
+// blockBufferiin leikkausalueen (ks. pushClipRect) rajaamana.
+void scaleToBlockBuffer(int x, int y, const BlockSurface* src, int pivotX, int pivotY, double scaleX, double scaleY, int mode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,183 @@
+/**
+ * Knnetyt spritet (ks. sprite.h).
+ */
+
+#include "sprite.h"
+
+/**
+ * Ky bittikartan rivin lpi ja palauttaa seuraavan peittvn ptkn alun
+ * (tai leveyden, jos ptki ei en ole) ja asettaa *end:iin sen lopun.
+ */
+static int nextRun(const char* row, int width, int x, int tpcolor, int* end) {
+	while (x < width && row[x] == (char)tpcolor) {
+		x++;
+	}
+	*end = x;
+	while (*end < width && row[*end] != (char)tpcolor) {
+		(*end)++;
+	}
+	return x;
+}
+
+static bool isSolid(const char* p, int n) {
+	int i;
+	for (i = 1; i < n; i++) {
+		if (p[i] != p[0]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+Sprite* compileSprite(const BlockSurface* bitmap, int tpcolor) {
+	const char* row;
+	Sprite* s;
+	SpriteRun* r;
+	int i, j, k, end, runCount = 0, dataSize = 0;
+
+	if (bitmap->width > 32767 || (long)bitmap->width * bitmap->height > 32767) {
+		return NULL;
+	}
+
+	// Ensimmisell kierroksella lasketaan vain tarvittava tila.
+	for (i = 0; i < bitmap->height; i++) {
+		row = bitmap->pixels + i * bitmap->stride;
+		for (j = nextRun(row, bitmap->width, 0, tpcolor, &end); j < bitmap->width; j = nextRun(row, bitmap->width, end, tpcolor, &end)) {
+			runCount++;
+			if (!isSolid(row + j, end - j)) {
+				dataSize += end - j;
+			}
+		}
+	}
+
+	s = (Sprite*)malloc(sizeof(Sprite) + (bitmap->height + 1) * sizeof(int) + runCount * sizeof(SpriteRun) + dataSize * 2);
+	if (s == NULL) {
+		return NULL;
+	}
+	s->width = bitmap->width;
+	s->height = bitmap->height;
+	s->runCount = runCount;
+	s->dataSize = dataSize;
+	s->rowStart = (int*)(s + 1);
+	s->runs = (SpriteRun*)(s->rowStart + bitmap->height + 1);
+	s->data = (char*)(s->runs + runCount);
+	s->flipped = s->data + dataSize;
+
+	r = s->runs;
+	k = 0;
+	for (i = 0; i < bitmap->height; i++) {
+		s->rowStart[i] = r - s->runs;
+		row = bitmap->pixels + i * bitmap->stride;
+		for (j = nextRun(row, bitmap->width, 0, tpcolor, &end); j < bitmap->width; j = nextRun(row, bitmap->width, end, tpcolor, &end)) {
+			r->x = j;
+			r->length = end - j;
+			r->color = row[j];
+			if (isSolid(row + j, end - j)) {
+				r->data = -1;
+			}
+			else {
+				r->data = k;
+				memcpy(s->data + k, row + j, end - j);
+				k += end - j;
+			}
+			r++;
+		}
+	}
+	s->rowStart[bitmap->height] = runCount;
+
+	for (i = 0; i < dataSize; i++) {
+		s->flipped[i] = s->data[dataSize - 1 - i];
+	}
+
+	return s;
+}
+
+void freeSprite(Sprite* s) {
+	free(s);
+}
+
+/**
+ * Palauttaa ptkn palikat nytn jrjestyksess (peilattuna takaperin).
+ */
+static const char* runData(const Sprite* s, const SpriteRun* r, bool flip) {
+	return flip ? s->flipped + s->dataSize - r->data - r->length : s->data + r->data;
+}
+
+/**
+ * Piirt spriten. Kokonaan pinnan sisn osuva sprite piirretn ilman
+ * ptkkohtaista leikkausta; muuten rivit ja ptkt leikataan.
+ */
+static void blitSprite(BlockSurface* dst, const Sprite* s, int x, int y, int flags) {
+	const SpriteRun* r;
+	const SpriteRun* last;
+	char* p;
+	int i, rx, len, off, y0, y1;
+	bool flip = (flags & SPRITE_FLIP_H) != 0;
+
+	if (x >= dst->width || x + s->width <= 0) {
+		return;
+	}
+	y0 = (y < 0) ? -y : 0;
+	y1 = (y + s->height > dst->height) ? dst->height - y : s->height;
+
+	if (x >= 0 && x + s->width <= dst->width) {
+		for (i = y0; i < y1; i++) {
+			p = dst->pixels + (y + i) * dst->stride + x;
+			last = s->runs + s->rowStart[i + 1];
+			for (r = s->runs + s->rowStart[i]; r < last; r++) {
+				rx = flip ? s->width - r->x - r->length : r->x;
+				if (r->data < 0) {
+					memset(p + rx, r->color, r->length);
+				}
+				else {
+					memcpy(p + rx, runData(s, r, flip), r->length);
+				}
+			}
+		}
+		return;
+	}
+
+	for (i = y0; i < y1; i++) {
+		p = dst->pixels + (y + i) * dst->stride;
+		last = s->runs + s->rowStart[i + 1];
+		for (r = s->runs + s->rowStart[i]; r < last; r++) {
+			rx = x + (flip ? s->width - r->x - r->length : r->x);
+			len = r->length;
+			off = 0;
+			if (rx < 0) { off = -rx; len += rx; rx = 0; }
+			if (rx + len > dst->width) { len = dst->width - rx; }
+			if (len <= 0) {
+				continue;
+			}
+
+			if (r->data < 0) {
+				memset(p + rx, r->color, len);
+			}
+			else {
+				memcpy(p + rx, runData(s, r, flip) + off, len);
+			}
+		}
+	}
+}
+
+void drawSprite(BlockSurface* dst, const Sprite* s, int x, int y, int flags) {
+	blitSprite(dst, s, x, y, flags);
+	if (dst->pixels == (char*)blockColorBuffer) {
+		markBlockBufferDirty(x, y, s->width, s->height);
+	}
+}
+
+/**
+ * Piirt n sprite jrjestyksess (ensimminen alimmaisena).
+ */
+void drawSprites(BlockSurface* dst, const SpriteDraw* list, int n) {
+	bool screen = dst->pixels == (char*)blockColorBuffer;
+	int i;
+
+	for (i = 0; i < n; i++) {
+		blitSprite(dst, list[i].sprite, list[i].x, list[i].y, list[i].flags);
+		if (screen) {
+			markBlockBufferDirty(list[i].x, list[i].y, list[i].sprite->width, list[i].sprite->height);
+		}
+	}
+}
@@ -0,0 +1,67 @@
+#ifndef _SPRITE_H
+#define _SPRITE_H
+
+#include "surface.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// drawSpriten liput.
+#define SPRITE_FLIP_H 1
+
+/**
+ * Peittv ptk spriten rivill: length palikkaa kohdasta x alkaen.
+ * Yksivrisen ptkn vri on color ja data on -1; muuten palikat ovat
+ * spriten pikselivarastossa kohdassa data.
+ */
+typedef struct SpriteRun {
+	short x;
+	short length;
+	short data;
+	char color;
+} SpriteRun;
+
+/**
+ * Knnetty sprite. Rivin y ptkt ovat runs[rowStart[y]] ...
+ * runs[rowStart[y + 1] - 1]. Lpinkyvi palikoita ei tallenneta lainkaan,
+ * joten piirto on memset tai memcpy ptk kohden. Pikselivarasto on
+ * tallessa mys takaperin (flipped) peilattua piirtoa varten.
+ */
+typedef struct Sprite {
+	int width;
+	int height;
+	int runCount;
+	int dataSize;
+	int* rowStart;
+	SpriteRun* runs;
+	char* data;
+	char* flipped;
+} Sprite;
+
+/**
+ * Yksi piirto drawSprites-erss.
+ */
+typedef struct SpriteDraw {
+	const Sprite* sprite;
+	int x;
+	int y;
+	int flags;
+} SpriteDraw;
+
+/**
+ * Knt bittikartan spriteksi; tpcolor-vriset palikat ovat lpinkyvi.
+ * Sprite varataan yhten muistilohkona. Palauttaa NULL, jos muisti ei
+ * riit tai bittikartta on liian suuri (yli 32767 palikkaa).
+ */
+Sprite* compileSprite(const BlockSurface* bitmap, int tpcolor);
+void freeSprite(Sprite* s);
+
+void drawSprite(BlockSurface* dst, const Sprite* s, int x, int y, int flags);
+void drawSprites(BlockSurface* dst, const SpriteDraw* list, int n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,214 @@
+/**
+ * Palikkapinnat (ks. surface.h): mielivaltaisen kokoiset palikkabufferit ja
+ * niiden piirtofunktiot leikkauksineen.
+ */
+
+#include "surface.h"
+
+BlockSurface screenBlockSurface = { COLS, ROWS * 2, COLS, (char*)blockColorBuffer };
+
+/**
+ * Kertoo ruudunpivitykselle, jos piirto osui blockColorBufferiin.
+ */
+static void surfaceChanged(BlockSurface* s, int x, int y, int w, int h) {
+	if (s->pixels == (char*)blockColorBuffer) {
+		markBlockBufferDirty(x, y, w, h);
+	}
+}
+
+/**
+ * Leikkaa suorakaiteen pinnan rajoihin. Palauttaa false, jos mitn ei j.
+ */
+static bool clipRect(BlockSurface* s, int* x, int* y, int* w, int* h) {
+	if (*x < 0) { *w += *x; *x = 0; }
+	if (*y < 0) { *h += *y; *y = 0; }
+	if (*x + *w > s->width) { *w = s->width - *x; }
+	if (*y + *h > s->height) { *h = s->height - *y; }
+	return *w > 0 && *h > 0;
+}
+
+void initBlockSurface(BlockSurface* s, int width, int height, char* pixels) {
+	s->width = width;
+	s->height = height;
+	s->stride = width;
+	s->pixels = pixels;
+}
+
+void clrSurface(BlockSurface* s, int color) {
+	fillRectToSurface(s, 0, 0, s->width, s->height, color);
+}
+
+void fillRectToSurface(BlockSurface* s, int x, int y, int w, int h, int color) {
+	char* p;
+	int j;
+
+	if (!clipRect(s, &x, &y, &w, &h)) {
+		return;
+	}
+
+	p = s->pixels + y * s->stride + x;
+	if (w == s->stride) {
+		memset(p, color, w * h);
+	}
+	else {
+		for (j = 0; j < h; j++) {
+			memset(p, color, w);
+			p += s->stride;
+		}
+	}
+	surfaceChanged(s, x, y, w, h);
+}
+
+/**
+ * Tyhj suorakaide; kuten strokeRectToBlockBuffer, leveys ja korkeus
+ * eivt sisll reunaa (piirretn w + 1 x h + 1 palikkaa).
+ */
+void strokeRectToSurface(BlockSurface* s, int x, int y, int w, int h, int color) {
+	fillRectToSurface(s, x, y, w + 1, 1, color);
+	fillRectToSurface(s, x, y + h, w + 1, 1, color);
+	fillRectToSurface(s, x, y + 1, 1, h - 1, color);
+	fillRectToSurface(s, x + w, y + 1, 1, h - 1, color);
+}
+
+/**
+ * Bresenhamin viiva. Pinnan ulkopuolelle osuvat palikat jtetn pois.
+ */
+void lineToSurface(BlockSurface* s, int x0, int y0, int x1, int y1, int color) {
+	int dx, dy, sx, sy, err, e2;
+
+	dx = abs(x1 - x0);
+	dy = -abs(y1 - y0);
+	sx = (x0 < x1) ? 1 : -1;
+	sy = (y0 < y1) ? 1 : -1;
+	err = dx + dy;
+
+	surfaceChanged(s, (x0 < x1) ? x0 : x1, (y0 < y1) ? y0 : y1, dx + 1, -dy + 1);
+
+	for (;;) {
+		if ((unsigned)x0 < (unsigned)s->width && (unsigned)y0 < (unsigned)s->height) {
+			s->pixels[y0 * s->stride + x0] = color;
+		}
+		if (x0 == x1 && y0 == y1) {
+			break;
+		}
+		e2 = 2 * err;
+		if (e2 >= dy) { err += dy; x0 += sx; }
+		if (e2 <= dx) { err += dx; y0 += sy; }
+	}
+}
+
+/**
+ * Onko kopio tehtv lopusta alkuun: kohteen ensimminen palikka osuu
+ * lhteen alueelle (ensimmisest palikasta p viimeiseen) sen alun jlkeen.
+ * Nin ky mys eri pintojen vlill, jos ne ovat saman muistin ikkunoita
+ * (esim. getClipSurface ja screenBlockSurface).
+ */
+static bool copyBackwards(const char* d, const char* p, const BlockSurface* src, int w, int h) {
+	return d > p && d < p + (h - 1) * src->stride + w;
+}
+
+/**
+ * Kopioi lhdepinnan alueen (sx, sy, w, h) kohdepinnan kohtaan (dx, dy).
+ */
+void blitSurface(BlockSurface* dst, int dx, int dy, BlockSurface* src, int sx, int sy, int w, int h) {
+	char* d;
+	char* p;
+	int j;
+
+	// Leikataan ensin lhteen, sitten kohteen rajoihin.
+	if (sx < 0) { dx -= sx; w += sx; sx = 0; }
+	if (sy < 0) { dy -= sy; h += sy; sy = 0; }
+	if (sx + w > src->width) { w = src->width - sx; }
+	if (sy + h > src->height) { h = src->height - sy; }
+	if (dx < 0) { sx -= dx; w += dx; dx = 0; }
+	if (dy < 0) { sy -= dy; h += dy; dy = 0; }
+	if (dx + w > dst->width) { w = dst->width - dx; }
+	if (dy + h > dst->height) { h = dst->height - dy; }
+	if (w <= 0 || h <= 0) {
+		return;
+	}
+
+	// Pllekkiset alueet kopioidaan alhaalta yls, jos kohde alkaa
+	// lhteen jlkeen; rivin sisisen pllekkisyyden hoitaa memmove.
+	d = dst->pixels + dy * dst->stride + dx;
+	p = src->pixels + sy * src->stride + sx;
+	if (copyBackwards(d, p, src, w, h)) {
+		d += (h - 1) * dst->stride;
+		p += (h - 1) * src->stride;
+		for (j = 0; j < h; j++) {
+			memmove(d, p, w);
+			d -= dst->stride;
+			p -= src->stride;
+		}
+	}
+	else {
+		for (j = 0; j < h; j++) {
+			memmove(d, p, w);
+			d += dst->stride;
+			p += src->stride;
+		}
+	}
+	surfaceChanged(dst, dx, dy, w, h);
+}
+
+/**
+ * Kuten blitSurface koko lhdepinnalle, mutta vrin tpcolor palikoita ei
+ * kopioida.
+ */
+void blitSurfaceTp(BlockSurface* dst, int dx, int dy, BlockSurface* src, char tpcolor) {
+	int sx = 0, sy = 0, w = src->width, h = src->height;
+	char* d;
+	char* p;
+	int i, j;
+
+	if (dx < 0) { sx = -dx; w += dx; dx = 0; }
+	if (dy < 0) { sy = -dy; h += dy; dy = 0; }
+	if (dx + w > dst->width) { w = dst->width - dx; }
+	if (dy + h > dst->height) { h = dst->height - dy; }
+	if (w <= 0 || h <= 0) {
+		return;
+	}
+
+	d = dst->pixels + dy * dst->stride + dx;
+	p = src->pixels + sy * src->stride + sx;
+	if (copyBackwards(d, p, src, w, h)) {
+		// Pllekkin: alhaalta yls ja oikealta vasemmalle.
+		d += (h - 1) * dst->stride;
+		p += (h - 1) * src->stride;
+		for (j = 0; j < h; j++) {
+			for (i = w - 1; i >= 0; i--) {
+				if (p[i] != tpcolor) {
+					d[i] = p[i];
+				}
+			}
+			d -= dst->stride;
+			p -= src->stride;
+		}
+	}
+	else {
+		for (j = 0; j < h; j++) {
+			for (i = 0; i < w; i++) {
+				if (p[i] != tpcolor) {
+					d[i] = p[i];
+				}
+			}
+			d += dst->stride;
+			p += src->stride;
+		}
+	}
+	surfaceChanged(dst, dx, dy, w, h);
+}
+
+void drawSurfaceToBlockBuffer(BlockSurface* src, int x, int y) {
+	blitSurface(&screenBlockSurface, x, y, src, 0, 0, src->width, src->height);
+}
+
+void getClipSurface(BlockSurface* s) {
+	int x, y, w, h;
+
+	getClipRect(&x, &y, &w, &h);
+	s->width = w;
+	s->height = h;
+	s->stride = COLS;
+	s->pixels = (w > 0 && h > 0) ? &blockColorBuffer[y][x] : (char*)blockColorBuffer;
+}
@@ -0,0 +1,175 @@
+#ifndef _SURFACE_H
+#define _SURFACE_H
+
+#include "txtgfx.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Palikkapinta: mielivaltaisen kokoinen "blockColorBuffer", yksi vri (0-15)
+ * tavua kohden. Rivin y palikka x on pixels[y * stride + x].
+ *
+ * C:ss pinnan muisti varataan itse ja annetaan initBlockSurfacelle; C++:ssa
+ * Surface<W, H> -luokka sislt muistin ja sen handle() palauttaa tmn
+ * rakenteen. screenBlockSurface osoittaa blockColorBufferiin, joten kaikki
+ * pintafunktiot toimivat mys suoraan ruudulle.
+ *
+ * Kaikki pintafunktiot leikkaavat piirrokset pinnan rajoihin.
+ */
+typedef struct BlockSurface {
+	int width;
+	int height;
+	int stride;
+	char* pixels;
+} BlockSurface;
+
+extern BlockSurface screenBlockSurface;
+
+void initBlockSurface(BlockSurface* s, int width, int height, char* pixels);
+
+void clrSurface(BlockSurface* s, int color);
+void fillRectToSurface(BlockSurface* s, int x, int y, int w, int h, int color);
+void strokeRectToSurface(BlockSurface* s, int x, int y, int w, int h, int color);
+void lineToSurface(BlockSurface* s, int x0, int y0, int x1, int y1, int color);
+
+// Lhde ja kohde saavat olla pllekkisi alueita samassa muistissa (mys
+// eri pintojen, esim. getClipSurfacen ja screenBlockSurfacen, kautta).
+void blitSurface(BlockSurface* dst, int dx, int dy, BlockSurface* src, int sx, int sy, int w, int h);
+void blitSurfaceTp(BlockSurface* dst, int dx, int dy, BlockSurface* src, char tpcolor);
+void drawSurfaceToBlockBuffer(BlockSurface* src, int x, int y);
+
+/**
+ * Tytt s:n ikkunaksi blockColorBufferin leikkausalueeseen (ks.
+ * pushClipRect): pinnan (0, 0) on leikkausalueen vasen ylkulma. Ikkunaan
+ * piirretyt muutokset on merkittv itse markBlockBufferDirtyll.
+ */
+void getClipSurface(BlockSurface* s);
+
+/**
+ * Pakattu palikkapinta: tekstisolun kaksi pllekkist palikkaa samassa
+ * tavussa, parillinen rivi alemmassa ja pariton ylemmss puolitavussa.
+ * Tavu on siis suoraan solun vri merkille 223, ja muistia (ja siirrettvi
+ * tavuja) on puolet BlockSurfacen mrst. Palikka (x, y) on tavun
+ * cells[(y / 2) * stride + x] puolitavu y % 2. Korkeuden on oltava parillinen.
+ */
+typedef struct PackedSurface {
+	int width;
+	int height;
+	int stride;
+	char* cells;
+} PackedSurface;
+
+void initPackedSurface(PackedSurface* s, int width, int height, char* cells);
+
+int getPackedPixel(const PackedSurface* s, int x, int y);
+void setPackedPixel(PackedSurface* s, int x, int y, int color);
+
+void clrPackedSurface(PackedSurface* s, int color);
+void fillRectToPackedSurface(PackedSurface* s, int x, int y, int w, int h, int color);
+void lineToPackedSurface(PackedSurface* s, int x0, int y0, int x1, int y1, int color);
+void blitPackedSurface(PackedSurface* dst, int dx, int dy, const PackedSurface* src, int sx, int sy, int w, int h);
+void shiftPackedSurface(PackedSurface* s, int x, int y);
+
+// Muunnokset blockColorBufferin ja ruudun kokoisen pakatun pinnan vlill.
+void packBlockBuffer(PackedSurface* dst);
+void unpackToBlockBuffer(const PackedSurface* src);
+
+void drawScreenFromPackedSurface(const PackedSurface* s);
+
+#ifdef __cplusplus
+}
+
+/**
+ * Knnsaikaisen kokoinen palikkapinta. Mitat ja rivin pituus ovat
+ * vakioita (enum, koska Watcomin C++ ei tunne constexpr:), joten kntj
+ * voi purkaa ja erikoistaa silmukat kullekin koolle. Esim.
+ *
+ *   Surface<COLS, ROWS * 2> canvas;   // ruudun kokoinen
+ *   Surface<132, 86> wide;            // 132x43-tekstitila
+ *
+ * Leikkausta vaativat piirrot menevt C-funktioille handle():n kautta.
+ */
+template <int W, int H>
+class Surface {
+public:
+	enum { WIDTH = W, HEIGHT = H, STRIDE = W, SIZE = W * H };
+
+	char pixels[H][W];
+
+	Surface() {
+		initBlockSurface(&surface, W, H, &pixels[0][0]);
+		clear(0);
+	}
+
+	BlockSurface* handle() {
+		return &surface;
+	}
+
+	char& at(int x, int y) {
+		return pixels[y][x];
+	}
+
+	bool contains(int x, int y) const {
+		return (unsigned)x < (unsigned)W && (unsigned)y < (unsigned)H;
+	}
+
+	void clear(int color) {
+		memset(pixels, color, SIZE);
+	}
+
+	void fillRect(int x, int y, int w, int h, int color) {
+		if (x < 0) { w += x; x = 0; }
+		if (y < 0) { h += y; y = 0; }
+		if (x + w > W) { w = W - x; }
+		if (y + h > H) { h = H - y; }
+		if (w <= 0 || h <= 0) {
+			return;
+		}
+		for (int j = y; j < y + h; j++) {
+			memset(&pixels[j][x], color, w);
+		}
+	}
+
+	void strokeRect(int x, int y, int w, int h, int color) {
+		strokeRectToSurface(&surface, x, y, w, h, color);
+	}
+
+	void line(int x0, int y0, int x1, int y1, int color) {
+		lineToSurface(&surface, x0, y0, x1, y1, color);
+	}
+
+	void blitTo(BlockSurface* dst, int x, int y) {
+		blitSurface(dst, x, y, &surface, 0, 0, W, H);
+	}
+
+	void blitTpTo(BlockSurface* dst, int x, int y, char tpcolor) {
+		blitSurfaceTp(dst, x, y, &surface, tpcolor);
+	}
+
+	/**
+	 * Kopioi pinnan blockColorBufferiin kohtaan (x, y). Ruudun kokoinen pinta
+	 * kohtaan (0, 0) kopioidaan yhdell memcpy:ll.
+	 */
+	void drawToBlockBuffer(int x, int y) {
+		if (W == COLS && H == ROWS * 2 && x == 0 && y == 0) {
+			memcpy(blockColorBuffer, pixels, SIZE);
+			markBlockBufferDirty(0, 0, COLS, ROWS * 2);
+		}
+		else {
+			drawSurfaceToBlockBuffer(&surface, x, y);
+		}
+	}
+
+private:
+	BlockSurface surface;
+
+	// handle() osoittaa olion omaan muistiin, joten kopiointi on estetty.
+	Surface(const Surface&);
+	Surface& operator=(const Surface&);
+};
+
+#endif
+
+#endif
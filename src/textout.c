@@ -0,0 +1,394 @@
+/**
+ * Tekstikirjoitin (ks. textout.h).
+ *
+ * Merkit kirjoitetaan yksi kerrallaan put():lla, joka ohittaa laatikon
+ * ulkopuoliset merkit. Koska kursori etenee rivill vain oikealle, rivin
+ * nkyvt merkit ovat aina yhteninen ptk (runX, runLength), joka
+ * kirjoitetaan ruutuun ja merkitn muuttuneeksi kerralla rivin vaihtuessa
+ * tai tulostuksen lopuksi. Luvut muotoillaan numero kerrallaan pieneen
+ * pinopuskuriin, joten sprintf: ja vlimerkkijonoja ei tarvita.
+ */
+
+#include "textout.h"
+
+// Muotoilun liput.
+#define FLAG_LEFT 1
+#define FLAG_ZERO 2
+
+// Pisin muotoiltu luku: 64-bittinen long oktaalina mahtuu thn reilusti.
+// Kokonaislukujen tarkkuus (vhimmisnumeromr) rajataan puskuriin.
+#define NUMBER_BUFFER 32
+#define MAX_DIGITS (NUMBER_BUFFER - 1)
+
+static const char lowerDigits[] = "0123456789abcdef";
+static const char upperDigits[] = "0123456789ABCDEF";
+
+static const unsigned long powersOfTen[TEXT_MAX_FIXED_DECIMALS + 1] = { 1, 10, 100, 1000, 10000 };
+
+static void flush(TextWriter* w) {
+	if (w->runLength == 0) {
+		return;
+	}
+	if (w->target == TEXT_TO_SCREEN) {
+		writeScreenCells(w->runX, w->y, w->cells, w->runLength);
+	}
+	else {
+		markScreenBufferDirty(w->runX, w->y, w->runLength, 1);
+	}
+	w->runLength = 0;
+}
+
+static void put(TextWriter* w, char c) {
+	if (w->x >= w->clipX0 && w->x <= w->clipX1 && w->y >= w->clipY0 && w->y <= w->clipY1) {
+		if (w->runLength == 0) {
+			w->runX = w->x;
+		}
+		if (w->target == TEXT_TO_SCREEN) {
+			w->cells[w->runLength] = (unsigned char)c | (w->color << 8);
+		}
+		else {
+			screenCharBuffer[w->y][w->x] = c;
+			screenColorBuffer[w->y][w->x] = w->color;
+		}
+		w->runLength++;
+	}
+	w->x++;
+}
+
+static void newLine(TextWriter* w) {
+	flush(w);
+	w->x = w->left;
+	w->y++;
+}
+
+static void putRepeated(TextWriter* w, char c, int n) {
+	for (; n > 0; n--) {
+		put(w, c);
+	}
+}
+
+/**
+ * Tulostaa kentn: etumerkin (0, jos ei ole) ja length merkki s:st
+ * width-levyiseksi tytettyn. Palauttaa tulostettujen merkkien mrn.
+ */
+static int putField(TextWriter* w, char sign, const char* s, int length, int width, int flags) {
+	int pad = width - length - (sign != 0);
+	int i;
+
+	if (pad < 0) {
+		pad = 0;
+	}
+	if (!(flags & (FLAG_LEFT | FLAG_ZERO))) {
+		putRepeated(w, ' ', pad);
+	}
+	if (sign != 0) {
+		put(w, sign);
+	}
+	if ((flags & FLAG_ZERO) && !(flags & FLAG_LEFT)) {
+		putRepeated(w, '0', pad);
+	}
+	for (i = 0; i < length; i++) {
+		put(w, s[i]);
+	}
+	if (flags & FLAG_LEFT) {
+		putRepeated(w, ' ', pad);
+	}
+	return pad + (sign != 0) + length;
+}
+
+/**
+ * Kirjoittaa v:n numerot puskuriin lopusta alkaen (vhintn minDigits
+ * numeroa). Palauttaa ensimmisen numeron osoitteen.
+ */
+static char* formatDigits(char* end, unsigned long v, unsigned base, const char* digits, int minDigits) {
+	char* p = end;
+
+	while (v != 0 || minDigits > 0) {
+		*--p = digits[v % base];
+		v /= base;
+		minDigits--;
+	}
+	return p;
+}
+
+/**
+ * 16.16-kiintoluku decimals desimaalilla. Pyristys voi kasvattaa
+ * kokonaisosaa (esim. 1.999 -> "2.00").
+ */
+static char* formatFixed(char* end, unsigned long v, int decimals) {
+	unsigned long whole = v >> 16;
+	unsigned long fraction = ((v & 0xffff) * powersOfTen[decimals] + 0x8000) >> 16;
+	char* p = end;
+
+	if (fraction >= powersOfTen[decimals]) {
+		fraction -= powersOfTen[decimals];
+		whole++;
+	}
+	if (decimals > 0) {
+		p = formatDigits(p, fraction, 10, lowerDigits, decimals);
+		*--p = '.';
+	}
+	return formatDigits(p, whole, 10, lowerDigits, 1);
+}
+
+static int hexValue(char c) {
+	if (c >= '0' && c <= '9') { return c - '0'; }
+	if (c >= 'a' && c <= 'f') { return c - 'a' + 10; }
+	if (c >= 'A' && c <= 'F') { return c - 'A' + 10; }
+	return -1;
+}
+
+/**
+ * Ksittelee vrikoodin ESCin jlkeisen osan s. Palauttaa osoitteen, josta
+ * muotoilua jatketaan; tuntematon koodi ohitetaan pelkkn ESCin.
+ */
+static const char* colorEscape(TextWriter* w, const char* s) {
+	int hi, lo;
+
+	if (*s == '.') {
+		w->color = w->baseColor;
+		return s + 1;
+	}
+	hi = hexValue(s[0]);
+	lo = (hi >= 0) ? hexValue(s[1]) : -1;
+	if (lo < 0) {
+		return s;
+	}
+	w->color = (hi << 4) | lo;
+	return s + 2;
+}
+
+void initTextWriter(TextWriter* w, int target, int x, int y, int color) {
+	w->target = target;
+	w->x = x;
+	w->y = y;
+	w->left = x;
+	w->clipX0 = 0;
+	w->clipY0 = 0;
+	w->clipX1 = COLS - 1;
+	w->clipY1 = ROWS - 1;
+	w->color = color;
+	w->baseColor = color;
+	w->runX = 0;
+	w->runLength = 0;
+}
+
+void setTextWriterBox(TextWriter* w, int x, int y, int width, int height) {
+	flush(w);
+	w->clipX0 = (x > 0) ? x : 0;
+	w->clipY0 = (y > 0) ? y : 0;
+	w->clipX1 = (x + width < COLS) ? x + width - 1 : COLS - 1;
+	w->clipY1 = (y + height < ROWS) ? y + height - 1 : ROWS - 1;
+	w->x = x;
+	w->y = y;
+	w->left = x;
+}
+
+void setTextWriterColor(TextWriter* w, int color) {
+	w->color = color;
+}
+
+void moveTextWriter(TextWriter* w, int x, int y) {
+	flush(w);
+	w->x = x;
+	w->y = y;
+}
+
+int writeText(TextWriter* w, const char* s) {
+	const char* p = s;
+	char c;
+
+	while ((c = *p++) != '\0') {
+		if (c == '\n') {
+			newLine(w);
+		}
+		else {
+			put(w, c);
+		}
+	}
+	flush(w);
+	return p - s - 1;
+}
+
+int vprintText(TextWriter* w, const char* format, va_list args) {
+	char buffer[NUMBER_BUFFER];
+	char* const end = buffer + NUMBER_BUFFER;
+	const char* s;
+	char* p;
+	char c, sign;
+	int n = 0, flags, width, precision, length;
+	bool isLong;
+	long v;
+	unsigned long u;
+
+	while ((c = *format++) != '\0') {
+		if (c == '\n') {
+			newLine(w);
+			n++;
+			continue;
+		}
+		if (c == TEXT_ESC) {
+			format = colorEscape(w, format);
+			continue;
+		}
+		if (c != '%') {
+			put(w, c);
+			n++;
+			continue;
+		}
+
+		flags = 0;
+		for (;; format++) {
+			if (*format == '-') { flags |= FLAG_LEFT; }
+			else if (*format == '0') { flags |= FLAG_ZERO; }
+			else { break; }
+		}
+		width = 0;
+		if (*format == '*') {
+			width = va_arg(args, int);
+			if (width < 0) {
+				flags |= FLAG_LEFT;
+				width = -width;
+			}
+			format++;
+		}
+		while (*format >= '0' && *format <= '9') {
+			width = width * 10 + *format++ - '0';
+		}
+		precision = -1;
+		if (*format == '.') {
+			format++;
+			precision = 0;
+			if (*format == '*') {
+				precision = va_arg(args, int);
+				format++;
+			}
+			while (*format >= '0' && *format <= '9') {
+				precision = precision * 10 + *format++ - '0';
+			}
+		}
+		isLong = (*format == 'l');
+		if (isLong) {
+			format++;
+		}
+
+		sign = 0;
+		switch (c = *format++) {
+		case 'd':
+		case 'i':
+			v = isLong ? va_arg(args, long) : va_arg(args, int);
+			if (v < 0) {
+				sign = '-';
+				u = 0UL - (unsigned long)v;
+			}
+			else {
+				u = v;
+			}
+			p = formatDigits(end, u, 10, lowerDigits, (precision < 0) ? 1 : (precision > MAX_DIGITS) ? MAX_DIGITS : precision);
+			n += putField(w, sign, p, end - p, width, (precision < 0) ? flags : flags & ~FLAG_ZERO);
+			break;
+
+		case 'u':
+		case 'x':
+		case 'X':
+			u = isLong ? va_arg(args, unsigned long) : va_arg(args, unsigned);
+			p = formatDigits(end, u, (c == 'u') ? 10 : 16, (c == 'X') ? upperDigits : lowerDigits, (precision < 0) ? 1 : (precision > MAX_DIGITS) ? MAX_DIGITS : precision);
+			n += putField(w, 0, p, end - p, width, (precision < 0) ? flags : flags & ~FLAG_ZERO);
+			break;
+
+		case 'q':
+			v = va_arg(args, long);
+			if (v < 0) {
+				sign = '-';
+				u = 0UL - (unsigned long)v;
+			}
+			else {
+				u = v;
+			}
+			if (precision < 0) {
+				precision = TEXT_FIXED_DECIMALS;
+			}
+			if (precision > TEXT_MAX_FIXED_DECIMALS) {
+				precision = TEXT_MAX_FIXED_DECIMALS;
+			}
+			p = formatFixed(end, u, precision);
+			n += putField(w, sign, p, end - p, width, flags);
+			break;
+
+		case 'c':
+			buffer[0] = (char)va_arg(args, int);
+			n += putField(w, 0, buffer, 1, width, flags & ~FLAG_ZERO);
+			break;
+
+		case 's':
+			s = va_arg(args, const char*);
+			if (s == NULL) {
+				s = "(null)";
+			}
+			// Pituus tarvitaan vain tytettess; muuten tulostetaan suoraan.
+			if (width > 0) {
+				for (length = 0; s[length] != '\0' && length != precision; length++);
+				n += putField(w, 0, s, length, width, flags & ~FLAG_ZERO);
+			}
+			else {
+				for (length = 0; s[length] != '\0' && length != precision; length++) {
+					put(w, s[length]);
+				}
+				n += length;
+			}
+			break;
+
+		case '%':
+			put(w, '%');
+			n++;
+			break;
+
+		case '\0':
+			format--;
+			break;
+
+		default:
+			// Tuntematon muunnos tulostetaan sellaisenaan.
+			put(w, '%');
+			put(w, c);
+			n += 2;
+			break;
+		}
+	}
+	flush(w);
+	return n;
+}
+
+int printText(TextWriter* w, const char* format, ...) {
+	va_list args;
+	int n;
+
+	va_start(args, format);
+	n = vprintText(w, format, args);
+	va_end(args);
+	return n;
+}
+
+int printTextToScreen(int x, int y, int color, const char* format, ...) {
+	TextWriter w;
+	va_list args;
+	int n;
+
+	initTextWriter(&w, TEXT_TO_SCREEN, x, y, color);
+	va_start(args, format);
+	n = vprintText(&w, format, args);
+	va_end(args);
+	return n;
+}
+
+int printTextToBuffer(int x, int y, int color, const char* format, ...) {
+	TextWriter w;
+	va_list args;
+	int n;
+
+	initTextWriter(&w, TEXT_TO_BUFFER, x, y, color);
+	va_start(args, format);
+	n = vprintText(&w, format, args);
+	va_end(args);
+	return n;
+}
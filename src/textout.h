@@ -0,0 +1,96 @@
+#ifndef _TEXTOUT_H
+#define _TEXTOUT_H
+
+#include <stdarg.h>
+
+#include "txtgfx.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Kirjoittimen kohde: suoraan nyttmuistiin tai screenChar/ColorBufferiin.
+#define TEXT_TO_SCREEN 0
+#define TEXT_TO_BUFFER 1
+
+/**
+ * Vrikoodi muotoilujonossa: ESC ja kaksi heksanumeroa asettaa vrin
+ * (esim. "\0331F" tai TEXT_COLOR(1F)), ESC ja piste palauttaa kirjoittimen
+ * alkuperisen vrin. Oktaalina ESC ei sotkeudu perss tuleviin
+ * numeroihin kuten "\x1b1F".
+ */
+#define TEXT_ESC '\033'
+#define TEXT_COLOR(a) "\033" #a
+#define TEXT_COLOR_RESET "\033."
+
+// Kiintolukujen (%q) desimaalien oletus- ja enimmismr.
+#define TEXT_FIXED_DECIMALS 2
+#define TEXT_MAX_FIXED_DECIMALS 4
+
+/**
+ * Tekstikirjoitin. Kursori (x, y) etenee merkki kerrallaan ja '\n' vie sen
+ * seuraavan rivin alkuun (laatikon vasempaan reunaan). Vain laatikon
+ * (clipX0, clipY0) ... (clipX1, clipY1) sislle osuvat merkit kirjoitetaan;
+ * laatikko on aina ruudun sisll. Rivi ei rivity, vaan reunan yli menev
+ * osa j pois.
+ *
+ * Ruutuun kirjoitettaessa merkit ja vrit kootaan 16-bittisin soluina
+ * cellsiin ja rivin nkyv osa kopioidaan nyttmuistiin kerralla (ks.
+ * writeScreenCells). Kirjoitin ei varaa muistia, joten sen voi pit
+ * pinossa.
+ */
+typedef struct TextWriter {
+	int target;
+	int x;
+	int y;
+	int left;
+	int clipX0, clipY0, clipX1, clipY1;
+	unsigned char color;
+	unsigned char baseColor;
+
+	int runX;
+	int runLength;
+	uint16_t cells[COLS];
+} TextWriter;
+
+void initTextWriter(TextWriter* w, int target, int x, int y, int color);
+
+/**
+ * Rajaa kirjoituksen laatikkoon, jonka vasen ylkulma on (x, y), ja siirt
+ * kursorin sen alkuun.
+ */
+void setTextWriterBox(TextWriter* w, int x, int y, int width, int height);
+
+void setTextWriterColor(TextWriter* w, int color);
+void moveTextWriter(TextWriter* w, int x, int y);
+
+/**
+ * Kirjoittaa merkkijonon sellaisenaan ('\n' vaihtaa rivi). Palauttaa
+ * merkkien mrn leikatut mukaan lukien.
+ */
+int writeText(TextWriter* w, const char* s);
+
+/**
+ * printf-tyylinen muotoilu suoraan soluihin ilman vlipuskuria. Tuetut
+ * muunnokset ovat %d %i %u %x %X %c %s %% sek %q, joka tulostaa 16.16-
+ * kiintoluvun (long) .tarkkuus desimaalilla (oletus TEXT_FIXED_DECIMALS,
+ * enintn TEXT_MAX_FIXED_DECIMALS) pyristen. Liput '-' ja '0',
+ * leveys (mys '*'), tarkkuus ja l-etuliite toimivat kuten printf:ss;
+ * %s:n tarkkuus rajaa merkkien mrn ja kokonaislukujen tarkkuus on
+ * enintn 31 numeroa. Vrikoodit (TEXT_ESC) toimivat vain
+ * muotoilujonossa, eivt %s:n merkkijonoissa.
+ *
+ * Palauttaa tulostettujen merkkien mrn leikatut mukaan lukien.
+ */
+int printText(TextWriter* w, const char* format, ...);
+int vprintText(TextWriter* w, const char* format, va_list args);
+
+// Kertakyttiset versiot: kirjoittavat kohtaan (x, y) vrill color.
+int printTextToScreen(int x, int y, int color, const char* format, ...);
+int printTextToBuffer(int x, int y, int color, const char* format, ...);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
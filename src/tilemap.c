@@ -0,0 +1,345 @@
+/**
+ * Ruutukartat ja nkymt niihin (ks. tilemap.h).
+ */
+
+#include "tilemap.h"
+
+#define TILEMAP_HEADER_SIZE 12
+#define TILEMAP_CHUNK_BYTES (TILE_CHUNK * TILE_CHUNK * 2)
+
+// Lohko tiedoston tavuina (little-endian) luettaessa ja tallennettaessa.
+static unsigned char chunkBytes[TILEMAP_CHUNK_BYTES];
+
+/**
+ * Jakolasku ja jakojnns, jotka pyristvt alaspin mys negatiivisilla
+ * luvuilla (kamera voi olla kartan ulkopuolella).
+ */
+static int floorDiv(int a, int b) {
+	return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+static int floorMod(int a, int b) {
+	a %= b;
+	return (a < 0) ? a + b : a;
+}
+
+void initTileSet(TileSet* t, int tileWidth, int tileHeight, int count, char* pixels) {
+	t->tileWidth = tileWidth;
+	t->tileHeight = tileHeight;
+	t->count = count;
+	t->pixels = pixels;
+}
+
+void initTileMap(TileMap* m, int width, int height, uint16_t* tiles) {
+	m->width = width;
+	m->height = height;
+	m->tiles = tiles;
+	m->file = NULL;
+	m->chunks = NULL;
+	m->useCounter = 0;
+	m->chunkReads = 0;
+}
+
+static void writeInt32(FILE* f, unsigned long v) {
+	unsigned char b[4];
+	b[0] = (unsigned char)v;
+	b[1] = (unsigned char)(v >> 8);
+	b[2] = (unsigned char)(v >> 16);
+	b[3] = (unsigned char)(v >> 24);
+	fwrite(b, 1, 4, f);
+}
+
+static unsigned long readInt32(const unsigned char* b) {
+	return b[0] | ((unsigned long)b[1] << 8) | ((unsigned long)b[2] << 16) | ((unsigned long)b[3] << 24);
+}
+
+static void putInt16(unsigned char* b, unsigned v) {
+	b[0] = (unsigned char)v;
+	b[1] = (unsigned char)(v >> 8);
+}
+
+static uint16_t readInt16(const unsigned char* b) {
+	return (uint16_t)(b[0] | (b[1] << 8));
+}
+
+bool openTileMap(TileMap* m, const char* filename) {
+	unsigned char header[TILEMAP_HEADER_SIZE];
+	FILE* f = fopen(filename, "rb");
+	int i;
+
+	if (!f) {
+		return false;
+	}
+	if (fread(header, 1, TILEMAP_HEADER_SIZE, f) != TILEMAP_HEADER_SIZE || memcmp(header, "TMAP", 4) != 0) {
+		fclose(f);
+		return false;
+	}
+
+	initTileMap(m, (int)readInt32(header + 4), (int)readInt32(header + 8), NULL);
+	m->chunks = (TileChunk*)malloc(TILE_CHUNK_CACHE * sizeof(TileChunk));
+	if (m->chunks == NULL) {
+		fclose(f);
+		return false;
+	}
+	for (i = 0; i < TILE_CHUNK_CACHE; i++) {
+		m->chunks[i].x = -1;
+		m->chunks[i].y = -1;
+		m->chunks[i].lastUse = 0;
+	}
+	m->file = f;
+
+	return true;
+}
+
+void closeTileMap(TileMap* m) {
+	if (m->file) {
+		fclose(m->file);
+		m->file = NULL;
+	}
+	free(m->chunks);
+	m->chunks = NULL;
+}
+
+/**
+ * Tallentaa kartan (kartta voi olla mys itse tiedostosta luettu).
+ */
+bool saveTileMap(const TileMap* m, const char* filename) {
+	FILE* f = fopen(filename, "wb");
+	int cx, cy, i, j;
+
+	if (!f) {
+		return false;
+	}
+
+	fwrite("TMAP", 1, 4, f);
+	writeInt32(f, m->width);
+	writeInt32(f, m->height);
+	for (cy = 0; cy < m->height; cy += TILE_CHUNK) {
+		for (cx = 0; cx < m->width; cx += TILE_CHUNK) {
+			for (j = 0; j < TILE_CHUNK; j++) {
+				for (i = 0; i < TILE_CHUNK; i++) {
+					putInt16(chunkBytes + (j * TILE_CHUNK + i) * 2, getTile((TileMap*)m, cx + i, cy + j));
+				}
+			}
+			fwrite(chunkBytes, 1, TILEMAP_CHUNK_BYTES, f);
+		}
+	}
+
+	return fclose(f) == 0;
+}
+
+/**
+ * Hakee lohkon (cx, cy) vlimuistista tai lukee sen tiedostosta vhiten
+ * aikaa sitten kytetyn lohkon tilalle.
+ */
+static TileChunk* getChunk(TileMap* m, int cx, int cy) {
+	TileChunk* c = m->chunks;
+	long pos;
+	int i;
+
+	for (i = 0; i < TILE_CHUNK_CACHE; i++) {
+		if (m->chunks[i].x == cx && m->chunks[i].y == cy) {
+			c = &m->chunks[i];
+			c->lastUse = ++m->useCounter;
+			return c;
+		}
+		if (m->chunks[i].lastUse < c->lastUse) {
+			c = &m->chunks[i];
+		}
+	}
+
+	pos = (long)cy * ((m->width + TILE_CHUNK - 1) / TILE_CHUNK) + cx;
+	pos = TILEMAP_HEADER_SIZE + pos * TILEMAP_CHUNK_BYTES;
+	if (fseek(m->file, pos, SEEK_SET) != 0 || fread(chunkBytes, 1, TILEMAP_CHUNK_BYTES, m->file) != TILEMAP_CHUNK_BYTES) {
+		for (i = 0; i < TILE_CHUNK * TILE_CHUNK; i++) {
+			c->tiles[i] = NO_TILE;
+		}
+	}
+	else {
+		for (i = 0; i < TILE_CHUNK * TILE_CHUNK; i++) {
+			c->tiles[i] = readInt16(chunkBytes + i * 2);
+		}
+	}
+	c->x = cx;
+	c->y = cy;
+	c->lastUse = ++m->useCounter;
+	m->chunkReads++;
+
+	return c;
+}
+
+int getTile(TileMap* m, int x, int y) {
+	TileChunk* c;
+
+	if ((unsigned)x >= (unsigned)m->width || (unsigned)y >= (unsigned)m->height) {
+		return NO_TILE;
+	}
+	if (m->tiles) {
+		return m->tiles[(long)y * m->width + x];
+	}
+	if (m->file == NULL) {
+		return NO_TILE;
+	}
+
+	c = getChunk(m, x / TILE_CHUNK, y / TILE_CHUNK);
+	return c->tiles[(y % TILE_CHUNK) * TILE_CHUNK + x % TILE_CHUNK];
+}
+
+bool initTileView(TileView* v, const TileSet* set, TileMap* map, int width, int height) {
+	v->set = set;
+	v->map = map;
+	v->width = width;
+	v->height = height;
+	v->cameraX = 0;
+	v->cameraY = 0;
+
+	// Nkym osuu enintn width / tileWidth + 2 ruutuun vaakasuunnassa.
+	v->cols = width / set->tileWidth + 2;
+	v->rows = height / set->tileHeight + 2;
+	v->cacheWidth = v->cols * set->tileWidth;
+	v->cacheHeight = v->rows * set->tileHeight;
+	v->cache = (char*)malloc((long)v->cacheWidth * v->cacheHeight);
+	v->valid = false;
+	v->tilesDrawn = 0;
+
+	return v->cache != NULL;
+}
+
+void freeTileView(TileView* v) {
+	free(v->cache);
+	v->cache = NULL;
+}
+
+void setCamera(TileView* v, int x, int y) {
+	v->cameraX = x;
+	v->cameraY = y;
+}
+
+void invalidateTileView(TileView* v) {
+	v->valid = false;
+}
+
+/**
+ * Piirt kartan ruudun (tx, ty) vlimuistiin sen paikalle renkaassa.
+ */
+static void renderTile(TileView* v, int tx, int ty) {
+	const TileSet* s = v->set;
+	const char* src;
+	char* dst;
+	int j, tile;
+
+	dst = v->cache + floorMod(ty, v->rows) * s->tileHeight * v->cacheWidth + floorMod(tx, v->cols) * s->tileWidth;
+	tile = getTile(v->map, tx, ty);
+	v->tilesDrawn++;
+	if (tile >= s->count) {
+		for (j = 0; j < s->tileHeight; j++) {
+			memset(dst, 0, s->tileWidth);
+			dst += v->cacheWidth;
+		}
+		return;
+	}
+
+	src = s->pixels + (long)tile * s->tileWidth * s->tileHeight;
+	for (j = 0; j < s->tileHeight; j++) {
+		memcpy(dst, src, s->tileWidth);
+		dst += v->cacheWidth;
+		src += s->tileWidth;
+	}
+}
+
+static void renderTiles(TileView* v, int c0, int c1, int r0, int r1) {
+	int i, j;
+
+	for (j = r0; j < r1; j++) {
+		for (i = c0; i < c1; i++) {
+			renderTile(v, i, j);
+		}
+	}
+}
+
+void markTileChanged(TileView* v, int x, int y) {
+	if (v->valid && x >= v->firstCol && x < v->firstCol + v->cols && y >= v->firstRow && y < v->firstRow + v->rows) {
+		renderTile(v, x, y);
+	}
+}
+
+/**
+ * Pivitt vlimuistin kattamaan kameran nkemt ruudut. Jo vlimuistissa
+ * olevat ruudut silyvt paikoillaan renkaassa, joten vain uudet sarakkeet
+ * ja rivit piirretn.
+ */
+static void updateCache(TileView* v) {
+	int c0 = floorDiv(v->cameraX, v->set->tileWidth);
+	int r0 = floorDiv(v->cameraY, v->set->tileHeight);
+	int oc0 = v->firstCol, or0 = v->firstRow;
+	int keep0, keep1;
+
+	if (!v->valid || abs(c0 - oc0) >= v->cols || abs(r0 - or0) >= v->rows) {
+		renderTiles(v, c0, c0 + v->cols, r0, r0 + v->rows);
+	}
+	else {
+		// Uudet sarakkeet koko uudelta korkeudelta...
+		if (c0 > oc0) {
+			renderTiles(v, oc0 + v->cols, c0 + v->cols, r0, r0 + v->rows);
+		}
+		else if (c0 < oc0) {
+			renderTiles(v, c0, oc0, r0, r0 + v->rows);
+		}
+
+		// ...ja uudet rivit niilt sarakkeilta, jotka olivat jo mukana.
+		keep0 = (c0 > oc0) ? c0 : oc0;
+		keep1 = (c0 > oc0) ? oc0 + v->cols : c0 + v->cols;
+		if (r0 > or0) {
+			renderTiles(v, keep0, keep1, or0 + v->rows, r0 + v->rows);
+		}
+		else if (r0 < or0) {
+			renderTiles(v, keep0, keep1, r0, or0);
+		}
+	}
+
+	v->firstCol = c0;
+	v->firstRow = r0;
+	v->valid = true;
+}
+
+void drawTileView(TileView* v, BlockSurface* dst, int x, int y) {
+	const char* row;
+	char* d;
+	int j, o, n, m, sx, sy, w = v->width;
+
+	v->tilesDrawn = 0;
+	updateCache(v);
+
+	// Leikataan kohteen rajoihin vaakasuunnassa; o on ohitettujen sarakkeiden mr.
+	o = (x < 0) ? -x : 0;
+	if (x + w > dst->width) { w = dst->width - x; }
+	w -= o;
+	if (w <= 0) {
+		return;
+	}
+
+	for (j = 0; j < v->height; j++) {
+		if (y + j < 0 || y + j >= dst->height) {
+			continue;
+		}
+
+		// Rivi luetaan renkaasta enintn kahtena ptkn.
+		sy = floorMod(v->cameraY + j, v->cacheHeight);
+		sx = floorMod(v->cameraX + o, v->cacheWidth);
+		row = v->cache + sy * v->cacheWidth;
+		d = dst->pixels + (y + j) * dst->stride + x + o;
+		n = w;
+		while (n > 0) {
+			m = v->cacheWidth - sx;
+			if (m > n) { m = n; }
+			memcpy(d, row + sx, m);
+			d += m;
+			n -= m;
+			sx = 0;
+		}
+	}
+
+	if (dst->pixels == (char*)blockColorBuffer) {
+		markBlockBufferDirty(x + o, y, w, v->height);
+	}
+}
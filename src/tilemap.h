@@ -0,0 +1,124 @@
+#ifndef _TILEMAP_H
+#define _TILEMAP_H
+
+#include "surface.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Tyhj ruutu (mys kartan ulkopuoli); piirretn vrill 0.
+#define NO_TILE 0xffff
+
+// Tiedostosta luettavan kartan lohkon koko ruutuina ja vlimuistin koko lohkoina.
+#define TILE_CHUNK 32
+#define TILE_CHUNK_CACHE 16
+
+/**
+ * Ruutujoukko: count kappaletta tileWidth x tileHeight -kokoisia palikka-
+ * kuvia perkkin. Ruudun i rivi y alkaa kohdasta
+ * pixels + (i * tileHeight + y) * tileWidth.
+ */
+typedef struct TileSet {
+	int tileWidth;
+	int tileHeight;
+	int count;
+	char* pixels;
+} TileSet;
+
+typedef struct TileChunk {
+	int x;
+	int y;
+	unsigned long lastUse;
+	uint16_t tiles[TILE_CHUNK * TILE_CHUNK];
+} TileChunk;
+
+/**
+ * Kartta ruutujen numeroina. Kartta on joko kokonaan muistissa (tiles) tai
+ * luetaan tiedostosta TILE_CHUNK x TILE_CHUNK -lohkoina sit mukaa kuin
+ * niit tarvitaan; viimeksi kytetyt TILE_CHUNK_CACHE lohkoa pidetn
+ * muistissa.
+ *
+ * Tiedostomuoto (saveTileMap): "TMAP", leveys ja korkeus 32-bittisin, sen
+ * jlkeen lohkot riveittin, kukin TILE_CHUNK * TILE_CHUNK 16-bittist
+ * ruutua riveittin (reunalohkot tytetty NO_TILE:ll). Luvut ovat
+ * little-endian-muodossa.
+ */
+typedef struct TileMap {
+	int width;
+	int height;
+	uint16_t* tiles;
+
+	FILE* file;
+	TileChunk* chunks;
+	unsigned long useCounter;
+	int chunkReads;
+} TileMap;
+
+void initTileMap(TileMap* m, int width, int height, uint16_t* tiles);
+bool openTileMap(TileMap* m, const char* filename);
+void closeTileMap(TileMap* m);
+bool saveTileMap(const TileMap* m, const char* filename);
+
+/**
+ * Palauttaa ruudun (x, y) numeron, kartan ulkopuolella NO_TILE. Kartta,
+ * jolla ei ole ruutuja muistissa eik avointa tiedostoa (esim. suljettu),
+ * on kokonaan NO_TILE-ruutuja.
+ */
+int getTile(TileMap* m, int x, int y);
+
+/**
+ * Nkym karttaan: width x height palikan ikkuna, jonka vasen ylkulma on
+ * kartalla kohdassa (cameraX, cameraY) palikoina.
+ *
+ * Nkyvt ruudut piirretn valmiiksi vlimuistiin, joka kattaa nkymn ja
+ * yhden ruudun reunuksen ja jota kytetn renkaana kumpaankin suuntaan.
+ * Kameran liikkuessa piirretn siis vain uudet esiin tulevat ruuturivit ja
+ * -sarakkeet; nkym kopioidaan kohteeseen vlimuistista riveittin.
+ */
+typedef struct TileView {
+	const TileSet* set;
+	TileMap* map;
+	int width;
+	int height;
+	int cameraX;
+	int cameraY;
+
+	// Vlimuisti: cols x rows ruutua, ensimminen ruutu (firstCol, firstRow).
+	int cols;
+	int rows;
+	int firstCol;
+	int firstRow;
+	bool valid;
+	int cacheWidth;
+	int cacheHeight;
+	char* cache;
+
+	// Viimeisimmss drawTileViewss vlimuistiin piirrettyjen ruutujen mr.
+	int tilesDrawn;
+} TileView;
+
+void initTileSet(TileSet* t, int tileWidth, int tileHeight, int count, char* pixels);
+
+bool initTileView(TileView* v, const TileSet* set, TileMap* map, int width, int height);
+void freeTileView(TileView* v);
+
+void setCamera(TileView* v, int x, int y);
+
+/**
+ * Ilmoittaa, ett kartan ruutu (x, y) on vaihtunut, tai koko nkymn
+ * piirtmisest uudelleen.
+ */
+void markTileChanged(TileView* v, int x, int y);
+void invalidateTileView(TileView* v);
+
+/**
+ * Piirt nkymn pintaan dst kohtaan (x, y).
+ */
+void drawTileView(TileView* v, BlockSurface* dst, int x, int y);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -25,7 +25,15 @@
  * [The rest of the comments are in Finnish]
  */
 
-#include "txtgfx.h"
+#include "video.h"
+#include "kernels.h"
+#include "surface.h"
+#include "circle.h"
+#include "rotozoom.h"
+#include "scale.h"
+#include "font.h"
+#include "textout.h"
+#include "charset.h"
 
 /**
  * A number of global buffers, with hopefully self-explanatory names.
@@ -42,61 +50,403 @@ char transformBuffer[2 * ROWS][COLS];
 char imageBuffer[2 * ROWS * COLS];
 
 /**
- * Muuttaa vri colorNumber.
+ * Nyttlaite (ks. video.h) ja sen nyttmuistin osoite. Kohteeksi voi mys
+ * asettaa mink tahansa ROWS * COLS * 2 tavun taulukon (ks. setVideoMemory).
  */
-void setColor(int colorNumber, int r, int g, int b) {
-	// Katso:
-	// http://www.techhelpmanual.com/144-int_10h_1010h__set_one_dac_color_register.html
+static const VideoBackend* videoBackend = &DEFAULT_VIDEO_BACKEND;
+static char* videoMemory = DEFAULT_VIDEO_MEMORY;
+
+/**
+ * Kopio siit, mit nyttmuistiin on viimeksi kirjoitettu. Ruudunpivitys
+ * kirjoittaa nyttmuistiin vain ne solut, jotka poikkeavat tst. Solut
+ * ovat 16-bittisi (merkki alatavussa, vri yltavussa) kuten nyttmuistissa;
+ * presentedBytes on sama taulukko tavuina.
+ */
+static uint16_t presentedBuffer[ROWS * COLS];
+static char* const presentedBytes = (char*)presentedBuffer;
+static bool presentedValid = false;
+
+/**
+ * Muuttuneet ("likaiset") solut riveittin: rivin i solut dirtyMinX[i] ...
+ * dirtyMaxX[i] on tarkistettava seuraavassa ruudunpivityksess. Jos
+ * dirtyMinX[i] > dirtyMaxX[i], rivi on puhdas. Piirtofunktiot merkitsevt
+ * alueet, joihin ne kirjoittavat.
+ */
+static int dirtyMinX[ROWS];
+static int dirtyMaxX[ROWS];
+
+// Mist bufferista ruutu viimeksi piirrettiin (ks. PRESENT_*).
+#define PRESENT_NONE 0
+#define PRESENT_BLOCKS 1
+#define PRESENT_CHARS 2
+#define PRESENT_PACKED 3
+static int lastPresentSource = PRESENT_NONE;
+
+// Viimeisimmss ruudunpivityksess nyttmuistiin kirjoitettujen solujen mr.
+static int cellsWritten = 0;
+
+/**
+ * Toroidinen tila (ks. setToroidalBlockBuffer): blockColorBufferin kohta
+ * [(y + blockOriginY) % (ROWS * 2)][(x + blockOriginX) % COLS] nkyy ruudulla
+ * kohdassa (x, y). Muuten origo on aina (0, 0).
+ */
+static bool toroidalBlockBuffer = false;
+static int blockOriginX = 0;
+static int blockOriginY = 0;
 
-	union REGS regs;
+/**
+ * Ruudun palikkarivikohtaiset vaakasiirrot lukuhetkell (ks.
+ * setBlockRowOffsets): rivi y nytetn blockRowOffsets[y] verran oikealle
+ * siirrettyn. Arvot ovat vlill 0 ... COLS - 1.
+ */
+static int blockRowOffsets[ROWS * 2];
+static bool blockRowOffsetsOn = false;
 
-	// Huom.! Kirkkaat vrit sijaitsevat jostain syyst vlill 56-63?!!
-	// Tmn vuoksi seuraava korjaus:
+/**
+ * Paletin varjokopio: vrien 0-15 komponentit sellaisina kuin ne on
+ * viimeksi asetettu. getColor lukee vain tt ja setColor kirjoittaa thn;
+ * lhettmttmt vrit ovat vlill dacPendingMin ... dacPendingMax.
+ * Tekstimoodin alustuksen jlkeen (dacValid false) varjo luetaan kerran
+ * nyttlaitteelta. Jos colorBatchDepth > 0, vrit lhetetn vasta
+ * endColorBatchissa.
+ */
+static unsigned char dac[16][3];
+static bool dacValid = false;
+static int dacPendingMin = 16;
+static int dacPendingMax = -1;
+static int colorBatchDepth = 0;
+
+/**
+ * blockBufferin primitiivien leikkausalue (clipX0, clipY0) ... (clipX1,
+ * clipY1) reunat mukaan luettuina, sek pushClipRectin pino aiemmista
+ * alueista. Tyden pinon yli menevt pushClipRectit vain lasketaan, jotta
+ * popClipRect pysyy niiden kanssa tasapainossa.
+ */
+static int clipX0 = 0;
+static int clipY0 = 0;
+static int clipX1 = COLS - 1;
+static int clipY1 = ROWS * 2 - 1;
+static int clipStack[MAX_CLIP_RECTS][4];
+static int clipDepth = 0;
+static int clipOverflow = 0;
+
+// Pisteen sijainti leikkausalueeseen nhden (Cohen-Sutherland).
+#define CLIP_LEFT 1
+#define CLIP_RIGHT 2
+#define CLIP_TOP 4
+#define CLIP_BOTTOM 8
+
+/**
+ * Merkitsee solualueen (solukoordinaateissa, ptepisteet mukaan luettuina)
+ * likaiseksi. Leikkaa alueen ruudun rajoihin.
+ */
+static void markCellsDirty(int x0, int y0, int x1, int y1) {
+	int i;
+
+	if (x0 < 0) { x0 = 0; }
+	if (y0 < 0) { y0 = 0; }
+	if (x1 >= COLS) { x1 = COLS - 1; }
+	if (y1 >= ROWS) { y1 = ROWS - 1; }
+	if (x0 > x1 || y0 > y1) {
+		return;
+	}
 
-	if (colorNumber > 7 && colorNumber < 16) {
-		colorNumber += 48;
+	for (i = y0; i <= y1; i++) {
+		if (x0 < dirtyMinX[i]) { dirtyMinX[i] = x0; }
+		if (x1 > dirtyMaxX[i]) { dirtyMaxX[i] = x1; }
 	}
+}
+
+static void markAllDirty(void) {
+	markCellsDirty(0, 0, COLS - 1, ROWS - 1);
+}
 
-	// Ruskea sijaitsee kohdassa 20?!
-	else if (colorNumber == 6) {
-		colorNumber = 20;
+/**
+ * Valmistelee ruudunpivityksen lhteest source. Jos lhde vaihtuu, kaikki
+ * solut on tarkistettava. Palauttaa true, jos nyttmuistin sislt ei
+ * tunneta, jolloin kaikki solut on kirjoitettava vertailematta.
+ */
+static bool beginPresent(int source) {
+	bool force = !presentedValid;
+
+	cellsWritten = 0;
+	if (force || source != lastPresentSource) {
+		markAllDirty();
 	}
+	lastPresentSource = source;
+	presentedValid = true;
+
+	return force;
+}
+
+/**
+ * Vaihtaa nyttlaitteen. Mys nyttmuisti vaihtuu laitteen omaksi.
+ */
+void setVideoBackend(const VideoBackend* backend) {
+	videoBackend = backend;
+	setVideoMemory(backend->memory);
+	invalidateGlyphs();
+	dacValid = false;
+	dacPendingMin = 16;
+	dacPendingMax = -1;
+}
+
+const VideoBackend* getVideoBackend(void) {
+	return videoBackend;
+}
 
-	// Huom.: Vrit ovat rekistereiss muodossa GBR. Rekisteri on 1010h.
-	regs.w.ax = 0x1010;
-	regs.w.bx = colorNumber;
-	regs.h.dh = r;
-	regs.h.ch = g;
-	regs.h.cl = b;
-	int386(0x10, &regs, &regs);
+/**
+ * Asettaa nyttmuistin osoitteen. Oletus on nyttlaitteen oma muisti; esim.
+ * testausta varten kohteeksi voi antaa ROWS * COLS * 2 tavun taulukon.
+ * Seuraava ruudunpivitys kirjoittaa koko ruudun.
+ */
+void setVideoMemory(char* p) {
+	videoMemory = p;
+	invalidateScreen();
+}
+
+char* getVideoMemory(void) {
+	return videoMemory;
+}
+
+/**
+ * Pakottaa seuraavan ruudunpivityksen kirjoittamaan koko ruudun. Kutsuttava,
+ * jos nyttmuistia on muokattu txtgfx:n ohi (esim. initTextMode()).
+ */
+void invalidateScreen(void) {
+	presentedValid = false;
+	markAllDirty();
+}
+
+/**
+ * Merkitsee ruudun palikka-alueen (nyttkoordinaateissa) likaiseksi.
+ */
+static void markScreenBlocksDirty(int x, int y, int w, int h) {
+	if (w <= 0 || h <= 0) {
+		return;
+	}
+	markCellsDirty(x, y / 2, x + w - 1, (y + h - 1) / 2);
+}
+
+/**
+ * Merkitsee blockColorBufferin alueen muuttuneeksi. Piirtofunktiot tekevt
+ * tmn itse; kutsuttava vain, jos blockColorBufferiin kirjoitetaan suoraan.
+ */
+void markBlockBufferDirty(int x, int y, int w, int h) {
+	if (blockOriginX == 0 && blockOriginY == 0 && !blockRowOffsetsOn) {
+		markScreenBlocksDirty(x, y, w, h);
+		return;
+	}
+
+	// Rivisiirtojen kanssa merkitn varmuuden vuoksi rivit koko leveydelt.
+	if (blockRowOffsetsOn) {
+		x = 0;
+		w = COLS;
+	}
+
+	// Origon kanssa alue voi nky ruudulla neljss osassa.
+	if (x < 0) { w += x; x = 0; }
+	if (y < 0) { h += y; y = 0; }
+	if (x + w > COLS) { w = COLS - x; }
+	if (y + h > ROWS * 2) { h = ROWS * 2 - y; }
+	x -= blockOriginX;
+	y -= blockOriginY;
+	markScreenBlocksDirty(x, y, w, h);
+	markScreenBlocksDirty(x + COLS, y, w, h);
+	markScreenBlocksDirty(x, y + ROWS * 2, w, h);
+	markScreenBlocksDirty(x + COLS, y + ROWS * 2, w, h);
+}
+
+/**
+ * Merkitsee screenChar- ja -colorBuffereiden alueen muuttuneeksi. Kutsuttava
+ * vain, jos buffereihin kirjoitetaan suoraan.
+ */
+void markScreenBufferDirty(int x, int y, int w, int h) {
+	if (w <= 0 || h <= 0) {
+		return;
+	}
+	markCellsDirty(x, y, x + w - 1, y + h - 1);
+}
+
+/**
+ * Kirjoittaa rivin y kohtaan x n valmista solua (merkki alatavussa, vri
+ * yltavussa) suoraan nyttmuistiin. Ruudun ulkopuolelle jv osa
+ * jtetn pois.
+ */
+void writeScreenCells(int x, int y, const uint16_t* cells, int n) {
+	if (y < 0 || y >= ROWS) {
+		return;
+	}
+	if (x < 0) {
+		cells -= x;
+		n += x;
+		x = 0;
+	}
+	if (x + n > COLS) {
+		n = COLS - x;
+	}
+	if (n <= 0) {
+		return;
+	}
+
+	// Kuten paintScreenRow, mys presentedBufferiin.
+	memcpy(presentedBuffer + y * COLS + x, cells, n * 2);
+	memcpy((uint16_t*)videoMemory + y * COLS + x, cells, n * 2);
+	markCellsDirty(x, y, x + n - 1, y);
+}
+
+/**
+ * Palauttaa viimeisimmss ruudunpivityksess nyttmuistiin kirjoitettujen
+ * solujen mrn.
+ */
+int getCellsWritten(void) {
+	return cellsWritten;
+}
+
+/**
+ * Tekstimoodin alustus ja ruudun tyhjys. Nollaa mys paletin.
+ */
+void initTextMode(void) {
+	videoBackend->setMode();
+	invalidateScreen();
+	invalidateGlyphs();
+	dacValid = false;
+	dacPendingMin = 16;
+	dacPendingMax = -1;
+}
+
+/**
+ * DAC-rekisterit, joihin VGA:n attribuuttiohjain osoittaa vrit 0-15 (ks.
+ * videodos.c). Rekisterinumerona annettu 20 tai 56-63 on siis sama kuin
+ * jokin vreist 6 ja 8-15.
+ */
+static const unsigned char dacAliases[16] = {
+	0, 1, 2, 3, 4, 5, 20, 7, 56, 57, 58, 59, 60, 61, 62, 63
+};
+
+// Palauttaa vrin, jota DAC-rekisteri colorNumber nytt, tai colorNumberin.
+static int unaliasColor(int colorNumber) {
+	int i;
+
+	for (i = 0; i < 16; i++) {
+		if (dacAliases[i] == colorNumber) {
+			return i;
+		}
+	}
+	return colorNumber;
+}
+
+static void readDac(void) {
+	int i, r, g, b;
+
+	for (i = 0; i < 16; i++) {
+		videoBackend->getColor(i, &r, &g, &b);
+		dac[i][0] = r;
+		dac[i][1] = g;
+		dac[i][2] = b;
+	}
+	dacValid = true;
+}
+
+/**
+ * Muuttaa vri colorNumber (komponentit 0-63). Vri lhetetn heti, ellei
+ * kynniss ole beginColorBatchilla aloitettu er. Vrinumerot 16-255 ovat
+ * suoraan DAC-rekistereit: vrien 0-15 rekisterit (20 ja 56-63) ksitelln
+ * kuten vastaava vri, muita ei ole varjossa, vaan ne kirjoitetaan aina heti.
+ */
+void setColor(int colorNumber, int r, int g, int b) {
+	if (colorNumber > 15) {
+		colorNumber = unaliasColor(colorNumber);
+	}
+	if (colorNumber > 15 && colorNumber < 256) {
+		videoBackend->setColor(colorNumber, r, g, b);
+		return;
+	}
+	if (colorNumber < 0 || colorNumber > 15) {
+		return;
+	}
+	if (!dacValid) {
+		readDac();
+	}
+	r &= 63;
+	g &= 63;
+	b &= 63;
+	if (dac[colorNumber][0] == r && dac[colorNumber][1] == g && dac[colorNumber][2] == b) {
+		return;
+	}
+
+	dac[colorNumber][0] = r;
+	dac[colorNumber][1] = g;
+	dac[colorNumber][2] = b;
+	if (colorNumber < dacPendingMin) { dacPendingMin = colorNumber; }
+	if (colorNumber > dacPendingMax) { dacPendingMax = colorNumber; }
+	if (colorBatchDepth == 0) {
+		flushColors(false);
+	}
 }
 
 /**
  * Hakee vrin colorNumber rgb-arvot paletista ja asettaa ne muuttujien
- * osoitteisiin &r, &g ja &b. 
+ * osoitteisiin &r, &g ja &b. Vrit 0-15 (mys rekisterein 20 ja 56-63)
+ * luetaan varjokopiosta, muut DAC-rekisterit 16-255 nyttlaitteelta.
  */
 void getColor(int colorNumber, int* r, int* g, int* b) {
+	if (colorNumber > 15) {
+		colorNumber = unaliasColor(colorNumber);
+	}
+	if (colorNumber > 15 && colorNumber < 256) {
+		videoBackend->getColor(colorNumber, r, g, b);
+		return;
+	}
+	if (colorNumber < 0 || colorNumber > 15) {
+		*r = *g = *b = 0;
+		return;
+	}
+	if (!dacValid) {
+		readDac();
+	}
+	*r = dac[colorNumber][0];
+	*g = dac[colorNumber][1];
+	*b = dac[colorNumber][2];
+}
 
-	union REGS regs;
+/**
+ * Aloittaa vriern: setColorin muutokset kertn ja lhetetn yhten
+ * lohkona endColorBatchissa pystypaluun aikana. Ert voivat olla
+ * siskkisi; vain uloimman ern loppu lhett vrit.
+ */
+void beginColorBatch(void) {
+	colorBatchDepth++;
+}
 
-	// Seiskaa suuremmat vrit sijaitsevatkin loppupss.
-	if (colorNumber > 7 && colorNumber < 16) {
-		colorNumber += 48;
+void endColorBatch(void) {
+	if (colorBatchDepth > 0 && --colorBatchDepth == 0) {
+		flushColors(true);
 	}
+}
 
-	// Ruskea sijaitsee kohdassa 20?!
-	else if (colorNumber == 6) {
-		colorNumber = 20;
+/**
+ * Lhett muuttuneet vrit heti yhten lohkona (ensimmisest viimeiseen
+ * muuttuneeseen). Jos waitForRetrace on true, odotetaan ensin pystypaluuta,
+ * jotta vaihto ei ny kesken ruudun.
+ */
+void flushColors(bool waitForRetrace) {
+	if (dacPendingMax < dacPendingMin) {
+		return;
+	}
+	if (waitForRetrace) {
+		videoBackend->waitRetrace();
 	}
+	videoBackend->setColors(dacPendingMin, dacPendingMax - dacPendingMin + 1, dac[dacPendingMin]);
+	dacPendingMin = 16;
+	dacPendingMax = -1;
+}
 
-	// Huom.1: Vrit ovat rekistereiss muodossa GBR.
-	// Huom.2: Vrien _LUKEMISEEN_ kytetn rekisteri 1015h, keskeytyst 10h.
-	regs.w.ax = 0x1015;
-	regs.w.bx = colorNumber;
-	int386(0x10, &regs, &regs);
-	*r = regs.h.dh;
-	*g = regs.h.ch;
-	*b = regs.h.cl;
+/**
+ * Odottaa pystypaluun alkua.
+ */
+void waitRetrace(void) {
+	videoBackend->waitRetrace();
 }
 
 /**
@@ -104,9 +454,12 @@ void getColor(int colorNumber, int* r, int* g, int* b) {
  */
 void randomizeColorRange(int start, int stop) {
 	int i;
+
+	beginColorBatch();
 	for (i = start; i <= stop; i++) {
 		setColor(i, rand() % 64, rand() % 64, rand() % 64);
 	}
+	endColorBatch();
 }
 
 void randomizeAllColors(void) {
@@ -136,8 +489,9 @@ void fadeToColor(int colorNumber, int r, int g, int b) {
 void drawScreenFromBuffer(void) {
 	// katso: https://stackoverflow.com/questions/32972051/in-c-how-do-i-write-to-a-particular-memory-location-e-g-video-memory-b800-in
 
-	char* videomem = (char*)SCREEN_LIN_ADDR;
-	int i, j;
+	int i, j, o;
+	bool force;
+	char ch, a;
 
 	// Viimeiset nelj heksaa ovat merkitsevt, alkuosa b800 on vain rekisteri, johon kirjoitetaan (eli nyttmuisti)
 	// - Oikeanpuolimmaisimmat 4 bitti mrittvt etualan vrin (eli 0-15),
@@ -146,10 +500,113 @@ void drawScreenFromBuffer(void) {
 	// Katso:
 	// http://www.techhelpmanual.com/87-screen_attributes.html
 
+	// Kirjoitetaan vain likaiset solut, ja niistkin vain ne, jotka
+	// poikkeavat edellisest ruudusta.
+	force = beginPresent(PRESENT_CHARS);
 	for (i = 0; i < ROWS; i++) {
-		for (j = 0; j < COLS; j++) {
-			*(videomem++) = screenCharBuffer[i][j];
-			*(videomem++) = screenColorBuffer[i][j];
+		o = (i * COLS + dirtyMinX[i]) * 2;
+		for (j = dirtyMinX[i]; j <= dirtyMaxX[i]; j++) {
+			ch = screenCharBuffer[i][j];
+			a = screenColorBuffer[i][j];
+			if (force || presentedBytes[o] != ch || presentedBytes[o + 1] != a) {
+				videoMemory[o] = presentedBytes[o] = ch;
+				videoMemory[o + 1] = presentedBytes[o + 1] = a;
+				cellsWritten++;
+			}
+			o += 2;
+		}
+		dirtyMinX[i] = COLS;
+		dirtyMaxX[i] = -1;
+	}
+}
+
+/**
+ * Palauttaa blockColorBufferin rivin, joka nkyy ruudun palikkarivill y, ja
+ * asettaa *x:n sarakkeen, joka nkyy ruudun vasemmassa reunassa.
+ */
+static char* blockRowAt(int y, int* x) {
+	*x = blockOriginX;
+	if (blockRowOffsetsOn) {
+		*x -= blockRowOffsets[y];
+		if (*x < 0) {
+			*x += COLS;
+		}
+	}
+
+	y += blockOriginY;
+	if (y >= ROWS * 2) {
+		y -= ROWS * 2;
+	}
+	return blockColorBuffer[y];
+}
+
+/**
+ * Pakkaa ruudun solurivin i solut x ... x + n - 1 origo ja rivisiirrot
+ * huomioiden. Yl- ja alarivi luetaan yhtenisin ptkin, jotka katkeavat
+ * vain bufferin reunalla (origon kanssa kaksi, rivisiirtojen kanssa enintn
+ * kolme ptk).
+ */
+static void packBlockCells(const BlockKernels* kernels, uint16_t* dst, int i, int x, int n) {
+	int xt, xb, m;
+	const char* top = blockRowAt(i * 2, &xt);
+	const char* bottom = blockRowAt(i * 2 + 1, &xb);
+
+	xt = (xt + x) % COLS;
+	xb = (xb + x) % COLS;
+	while (n > 0) {
+		m = n;
+		if (COLS - xt < m) { m = COLS - xt; }
+		if (COLS - xb < m) { m = COLS - xb; }
+		kernels->packCells(dst, top + xt, bottom + xb, m);
+		dst += m;
+		n -= m;
+		xt += m;
+		xb += m;
+		if (xt == COLS) { xt = 0; }
+		if (xb == COLS) { xb = 0; }
+	}
+}
+
+static void packBlockAttrs(const BlockKernels* kernels, char* dst, int i) {
+	int xt, xb, m, n = COLS;
+	const char* top = blockRowAt(i * 2, &xt);
+	const char* bottom = blockRowAt(i * 2 + 1, &xb);
+
+	while (n > 0) {
+		m = n;
+		if (COLS - xt < m) { m = COLS - xt; }
+		if (COLS - xb < m) { m = COLS - xb; }
+		kernels->packAttrs(dst, top + xt, bottom + xb, m);
+		dst += m;
+		n -= m;
+		xt += m;
+		xb += m;
+		if (xt == COLS) { xt = 0; }
+		if (xb == COLS) { xb = 0; }
+	}
+}
+
+/**
+ * Kirjoittaa rivin i solut x ... x + n - 1 nyttmuistiin. Ellei force ole
+ * pll, vain edellisest ruudusta poikkeavat solut kirjoitetaan.
+ */
+static void presentCells(const uint16_t* cells, int i, int x, int n, bool force) {
+	uint16_t* videomem = (uint16_t*)videoMemory + i * COLS + x;
+	uint16_t* presented = presentedBuffer + i * COLS + x;
+	int j;
+
+	if (force) {
+		memcpy(presented, cells, n * 2);
+		memcpy(videomem, cells, n * 2);
+		cellsWritten += n;
+	}
+	else {
+		for (j = 0; j < n; j++) {
+			if (presented[j] != cells[j]) {
+				presented[j] = cells[j];
+				videomem[j] = cells[j];
+				cellsWritten++;
+			}
 		}
 	}
 }
@@ -158,14 +615,54 @@ void drawScreenFromBuffer(void) {
  * Piirt nytlle palikat suoraan blockBufferista, kulkematta screenChar- ja -colorbuffereiden kautta.
  */
 void drawScreenFromBlockBuffer(void) {
-	char* videomem = (char*)SCREEN_LIN_ADDR;
-	int i, j, k;
+	static uint16_t cells[COLS];
+	const BlockKernels* kernels = getBlockKernels();
+	int i, x, n;
+	bool force;
 
+	force = beginPresent(PRESENT_BLOCKS);
 	for (i = 0; i < ROWS; i++) {
-		k = i * 2;
-		for (j = 0; j < COLS; j++) {
-			*(videomem++) = 223;
-			*(videomem++) = blockColorBuffer[k][j] + 16 * blockColorBuffer[k + 1][j];
+		x = dirtyMinX[i];
+		n = dirtyMaxX[i] - x + 1;
+		if (n <= 0) {
+			continue;
+		}
+
+		// Rivin likainen osa pakataan kerralla valmiiksi soluiksi.
+		packBlockCells(kernels, cells, i, x, n);
+		presentCells(cells, i, x, n, force);
+
+		dirtyMinX[i] = COLS;
+		dirtyMaxX[i] = -1;
+	}
+}
+
+/**
+ * Piirt nytlle pakatun pinnan vasemman ylkulman. Pinnan vritavut ovat
+ * jo valmiita attribuutteja, joten solut syntyvt lomittamalla ne merkin 223
+ * kanssa. Pakatuilla pinnoilla ei ole likaisia alueita, joten kaikki solut
+ * verrataan edelliseen ruutuun.
+ */
+void drawScreenFromPackedSurface(const PackedSurface* s) {
+	static uint16_t cells[COLS];
+	const BlockKernels* kernels = getBlockKernels();
+	int i, n, rows;
+	bool force;
+
+	force = beginPresent(PRESENT_PACKED);
+	n = (s->width < COLS) ? s->width : COLS;
+	rows = (s->height / 2 < ROWS) ? s->height / 2 : ROWS;
+	for (i = 0; i < rows; i++) {
+		kernels->attrCells(cells, s->cells + i * s->stride, n);
+		presentCells(cells, i, 0, n, force);
+
+		// Pinnan ulkopuolelle jvt muutokset jvt likaisiksi.
+		if (dirtyMinX[i] < n) {
+			dirtyMinX[i] = n;
+		}
+		if (dirtyMinX[i] > dirtyMaxX[i]) {
+			dirtyMinX[i] = COLS;
+			dirtyMaxX[i] = -1;
 		}
 	}
 }
@@ -174,15 +671,14 @@ void drawScreenFromBlockBuffer(void) {
  * Piirt blockBufferin sislln screenChar- ja -colorBuffereihin.
  */
 void drawBlocksToBuffer(void) {
-	int i, j, k;
+	const BlockKernels* kernels = getBlockKernels();
+	int i;
 
+	memset(screenCharBuffer, 223, sizeof(screenCharBuffer));
 	for (i = 0; i < ROWS; i++) {
-		for (j = 0; j < COLS; j++) {
-			k = i * 2;
-			screenCharBuffer[i][j] = 223;
-			screenColorBuffer[i][j] = blockColorBuffer[k][j] + 16 * blockColorBuffer[k + 1][j];
-		}
+		packBlockAttrs(kernels, screenColorBuffer[i], i);
 	}
+	markAllDirty();
 }
 
 /**
@@ -190,12 +686,17 @@ void drawBlocksToBuffer(void) {
  * paitsi jos blockBufferin "pikselin" vrin arvo on tpcolor.
  */
 void drawTpBlocksToBuffer(char tpcolor) {
-	int i, j;
+	int i, j, k;
+	char* row;
 
 	for (i = 0; i < ROWS * 2; i++) {
+		row = blockRowAt(i, &k);
 		for (j = 0; j < COLS; j++) {
-			if (blockColorBuffer[i][j] != tpcolor){
-				intelligentDrawBlockToScreenBuffer(j,i,blockColorBuffer[i][j]);
+			if (row[k] != tpcolor){
+				intelligentDrawBlockToScreenBuffer(j,i,row[k]);
+			}
+			if (++k == COLS) {
+				k = 0;
 			}
 		}
 	}
@@ -206,7 +707,7 @@ void drawTpBlocksToBuffer(char tpcolor) {
  * blockColorBackupBuffer()-taulukkoon.
  */
 void getBlockBuffer(void) {
-	char* videomem = (char*)SCREEN_LIN_ADDR;
+	char* videomem = videoMemory;
 	int i, j, k;
 	char char_temp, color_temp;
 
@@ -240,7 +741,7 @@ void getBlockBuffer(void) {
  * Lukee nyttmuistin sislln screen- ja colorBuffereihin.
  */
 void getScreenCharColorBuffer(void) {
-	char* videomem = (char*)SCREEN_LIN_ADDR;
+	char* videomem = videoMemory;
 	int i, j;
 
 	for (i = 0; i < ROWS; i++) {
@@ -262,6 +763,7 @@ void clrScreenCharColorBuffer(void) {
 			screenColorBuffer[i][j] = 0;
 		}
 	}
+	markAllDirty();
 }
 
 /**
@@ -273,6 +775,7 @@ void clrBlockColorBuffer(int color) {
 	for (i = 0; i < ROWS * COLS * 2; i++) {
 		*(p++) = color;
 	}
+	markAllDirty();
 }
 
 /**
@@ -293,94 +796,59 @@ void paintScreenColorBufferArea(int x, int y, int w, int h, int c) {
 			screenColorBuffer[i][j] = c;
 		}
 	}
+	markScreenBufferDirty(x, y, w, h);
 }
 
 /**
- * Maalaa nytn rivinptkn.
+ * Maalaa nytn rivinptkn: w solua kohdasta (x, y) alkaen.
  */
 void paintScreenRow(int x, int y, int w, int c) {
-	char* videomem = (char*)SCREEN_LIN_ADDR;
-	int i, j;
+	int i, o;
 	
-	videomem += y * 160 + x*2 + 1;
+	o = y * 160 + x*2 + 1;
 
-	for (i = 0; i <= w; i++) {
-		*(videomem++) = c;
-		videomem++;
+	// Kirjoitetaan mys presentedBufferiin, jotta se vastaa nyttmuistia.
+	for (i = 0; i < w && o < ROWS * COLS * 2; i++) {
+		videoMemory[o] = presentedBytes[o] = c;
+		o += 2;
+	}
+	markCellsDirty(x, y, x + w - 1, y);
+	if (x + w > COLS) {
+		markCellsDirty(0, y + 1, COLS - 1, y + (x + w - 1) / COLS);
 	}
 }
 
 /**
- * Kiert blockbufferia d astetta (radiaaneina, naturlicht).
+ * Kiert blockbufferia d astetta (radiaaneina, naturlicht) keskipisteens
+ * ympri (ks. rotozoomSurface). Ruudun ulkopuolelta tulevat palikat jvt
+ * ennalleen.
  */
 void rotateBlockBuffer(double d) {
-	int y, x, centerx, centery, m, n, j, k;
-	double c, s;
-	c = cos(d);
-	s = sin(d);
+	BlockSurface src;
 
 	memcpy(transformBuffer, blockColorBuffer, sizeof(char) * 2 * ROWS * COLS);
-	for (x = 0; x < COLS; x++) {
-		for (y = 0; y < ROWS * 2; y++) {
-			centerx = COLS / 2;
-			centery = ROWS * 2 / 2;
-			m = x - centerx;
-			n = y - centery;
-			j = ((int)(m * c + n * s)) + centerx;
-			k = ((int)(n * c - m * s)) + centery;
-			if (j >= 0 && j < COLS && k >= 0 && k < ROWS * 2) {
-				transformBuffer[y][x] = blockColorBuffer[k][j];
-			}
-		}
-	}
-	memcpy(blockColorBuffer, transformBuffer, sizeof(char) * 2 * ROWS * COLS);
+	initBlockSurface(&src, COLS, ROWS * 2, (char*)transformBuffer);
+	rotozoomSurface(&screenBlockSurface, COLS / 2, ROWS, &src, COLS / 2, ROWS, d, 1.0, ROTO_TRANSPARENT);
 }
 
 /**
  * Ks. scaleBlockBufferAtXY
  */
-void scaleBlockBuffer(int d) {
+void scaleBlockBuffer(double d) {
 	scaleBlockBufferAtXY(d, COLS / 2, ROWS);
 }
 
 /**
- * Lhent (d > 1) tai loitontaa (d < 1) blockBufferia.
- * Ei toimi tysin odotetusti; ainoastaan skaalausarvo 2
- * toimii kunnolla.
+ * Lhent (d > 1) tai loitontaa (d < 1) blockBufferia niin, ett palikka
+ * (origoX, origoY) pysyy paikallaan (ks. scaleSurface). Loitonnettaessa
+ * reunoille j entinen sislt.
  */
-void scaleBlockBufferAtXY(int d, int origoX, int origoY) {
-	int y, x, i, j, xc, yc, xFactor, yFactor, xs, ys, xf, yf;
-
-
-	for (y = 0; y < ROWS * 2; y++) {
-		for (x = 0; x < COLS; x++) {
-			// Korjauskertoimia.
-			// Skaalauksen keskipistett pienemmille arvoille on annettava
-			// koordinaattikorjaukseksi skaalauskerroin - 1 (eli esim. 2-kertaiseksi
-			// skaalaamalla korjaus on 1).
+void scaleBlockBufferAtXY(double d, int origoX, int origoY) {
+	BlockSurface src;
 
-			if (x < origoX) { xc = -d; xs = -1; xf = (d-1); }
-			else { xc = d; xs = 1; xf = 0; }
-
-			if (y < origoY) { yc = -d; ys = -1; yf = (d-1); }
-			else { yc = d; ys = 1; yf = 0; }
-			
-			xFactor = (x - origoX) * xc;
-			yFactor = (y - origoY) * yc;
-
-			for (j = 0; j < d; j++) {
-				for (i = 0; i < d; i++) {
-					if (origoY +yf + (yFactor + j) * (ys) < 0 || origoY +yf+ (yFactor + j) * (ys) >= ROWS * 2 || origoX +xf+ (xFactor + i) * (xs) < 0 || origoX +xf+ (xFactor + i) * (xs) >= COLS) {
-						;
-					}
-					else {
-						transformBuffer[origoY +yf+ (yFactor + j) * (ys)][origoX +xf+ (xFactor + i) * (xs)] = blockColorBuffer[y][x];
-					}
-				}
-			}
-		}
-	}
-	memcpy(blockColorBuffer, transformBuffer, sizeof(char) * 2 * ROWS * COLS);
+	memcpy(transformBuffer, blockColorBuffer, sizeof(char) * 2 * ROWS * COLS);
+	initBlockSurface(&src, COLS, ROWS * 2, (char*)transformBuffer);
+	scaleSurface(&screenBlockSurface, origoX, origoY, &src, origoX, origoY, d, d, SCALE_NEAREST);
 }
 
 /*
@@ -399,13 +867,14 @@ void printStringToBuffer(char* s, int x, int y) {
 		screenCharBuffer[y][(x + i < 80) ? x + i : x + i - COLS] = c;
 		c = s[++i];
 	}
+	markScreenBufferDirty(0, y, COLS, 1);
 }
 
 /**
  * Tulostaa suoraan nytlle merkkijonon.
  */
 void printStringToScreen(char* s, char x, char y) {
-	char* videomem = (char*)(SCREEN_LIN_ADDR + y*160 + x*2);
+	int o = y*160 + x*2;
 	char c;
 	int i;
 	int xy;
@@ -413,261 +882,43 @@ void printStringToScreen(char* s, char x, char y) {
 	i = 0;
 	c = s[i];
 
-	while (c != '\0') {
-		*(videomem++) = c;
-		videomem++;
+	// Rivin yli menev teksti jatkuu seuraavalle riville, mutta ei
+	// nyttmuistin ohi.
+	while (c != '\0' && o < ROWS * COLS * 2) {
+		videoMemory[o] = presentedBytes[o] = c;
+		o += 2;
 		c = s[++i];
 	}
+	markCellsDirty(x, y, x + i - 1, y);
+	if (x + i > COLS) {
+		markCellsDirty(0, y + 1, COLS - 1, y + (x + i - 1) / COLS);
+	}
 }
 
 /**
- * Merkkijonon tulostus kera vrin.
+ * Merkkijonon tulostus kera vrin (ks. textout.h). Ruudun reunan yli menev
+ * osa j pois.
  */
 void printColorStringToScreen(char* s, char x, char y, char color) {
-	int w = strlen(s) - 1;
-	printStringToScreen(s, x, y);
-	paintScreenRow(x, y, w, color);
+	TextWriter w;
+
+	initTextWriter(&w, TEXT_TO_SCREEN, x, y, color);
+	writeText(&w, s);
 }
 
 /**
  * Tulostaa isofonttisen tekstin screenBufferiin. Tukee rivinvaihtoja '\n' !
  */
 void printLargeStringToBuffer(int x, int y, char* s, int c) {
-	int prevCharWidth, currentX;
-	char a;
-	
-	a = *s;
-	currentX = x;
-
-	while (a != '\0') {
-		if (a == '\n') {
-			currentX = x;
-			y += 6;
-			a = *(++s);
-		}
-		else {
-			prevCharWidth = printLargeCharToBuffer(currentX, y, a, c);
-			currentX += prevCharWidth + 1;
-			a = *(++s);
-		}
-	}
+	printScaledStringToBuffer(x, y, s, c, 1);
 }
 
 /**
- * Tulostaa ~3xn blokin kokoisen merkin nytlle. Palauttaa tulostetun merkin leveyden.
+ * Tulostaa ~3xn blokin kokoisen merkin nytlle (ks. font.h). Palauttaa
+ * tulostetun merkin leveyden.
  */
 int printLargeCharToBuffer(int x, int y, char a, int c) {
-	int i, j, k;
-	int xCounter;
-	int charWidth, charWidth_max;
-	char cc[32];
-	char ccc;
-
-	switch (a) {
-		case ' ':
-			strcpy(cc, "000 000 000 000 000");
-			break;
-		case '!':
-			strcpy(cc, "1 1 1 0 1");
-			break;
-		case '"':
-			strcpy(cc, "101 101 000 000 000");
-			break;
-		case '#':
-			strcpy(cc, "01010 11111 01010 11111 01010");
-			break;
-		case '$':
-			strcpy(cc, "-010 111 100 111 001 111 010");
-			break;
-		case '%':
-			strcpy(cc, "100 001 010 100 001");
-			break;
-		case '(':
-			strcpy(cc, "001 010 010 010 001");
-			break;
-		case ')':
-			strcpy(cc, "100 010 010 010 100");
-			break;
-		case '+':
-			strcpy(cc, "000 010 111 010 000");
-			break;
-		case ',':
-			strcpy(cc, "0 0 0 0 1 1");
-			break;
-		case '-':
-			strcpy(cc, "000 000 111 000 000");
-			break;
-		case '/':
-			strcpy(cc, "001 001 010 100 100");
-			break;
-		case '.':
-			strcpy(cc, "0 0 0 0 1");
-			break;
-		case '0':
-			strcpy(cc, "111 101 101 101 111");
-			break;
-		case '1':
-			strcpy(cc, "010 110 010 010 010");
-			break;
-		case '2':
-			strcpy(cc, "111 001 111 100 111");
-			break;
-		case '3':
-			strcpy(cc, "111 001 111 001 111");
-			break;
-		case '4':
-			strcpy(cc, "101 101 111 001 001");
-			break;
-		case '5':
-			strcpy(cc, "111 100 111 001 111");
-			break;
-		case '6':
-			strcpy(cc, "111 100 111 101 111");
-			break;
-		case '7':
-			strcpy(cc, "111 001 001 001 001");
-			break;
-		case '8':
-			strcpy(cc, "111 101 111 101 111");
-			break;
-		case '9':
-			strcpy(cc, "111 101 111 001 001");
-			break;
-		case ':':
-			strcpy(cc, "000 010 000 010 000");
-			break;
-		case ';':
-			strcpy(cc, "000 010 000 010 010");
-			break;
-		case '<':
-			strcpy(cc, "001 010 100 010 001");
-			break;
-		case '>':
-			strcpy(cc, "100 010 001 010 100");
-			break;
-		case '?':
-			strcpy(cc, "111 001 010 000 010");
-			break;
-		case '@':
-			strcpy(cc, "111 111 111 100 111");
-			break;
-		case 'A':
-			strcpy(cc, "111 101 111 101 101");
-			break;
-		case 'B':
-			strcpy(cc, "110 101 110 101 110");
-			break;
-		case 'C':
-			strcpy(cc, "111 100 100 100 111");
-			break;
-		case 'D':
-			strcpy(cc, "110 101 101 101 110");
-			break;
-		case 'E':
-			strcpy(cc, "111 100 111 100 111");
-			break;
-		case 'F':
-			strcpy(cc, "111 100 110 100 100");
-			break;
-		case 'G':
-			strcpy(cc, "111 100 101 101 111");
-			break;
-		case 'H':
-			strcpy(cc, "101 101 111 101 101");
-			break;
-		case 'I':
-			strcpy(cc, "111 010 010 010 111");
-			break;
-		case 'J':
-			strcpy(cc, "001 001 001 101 111");
-			break;
-		case 'K':
-			strcpy(cc, "101 101 110 101 101");
-			break;
-		case 'L':
-			strcpy(cc, "100 100 100 100 111");
-			break;
-		case 'M':
-			strcpy(cc, "11111 10101 10101 10001 10001");
-			break;
-		case 'N':
-			strcpy(cc, "110 101 101 101 101");
-			break;
-		case 'O':
-			strcpy(cc, "111 101 101 101 111");
-			break;
-		case 'P':
-			strcpy(cc, "111 101 111 100 100");
-			break;
-		case 'Q':
-			strcpy(cc, "111 101 101 101 111 001");
-			break;
-		case 'R':
-			strcpy(cc, "110 101 110 101 101");
-			break;
-		case 'S':
-			strcpy(cc, "111 100 111 001 111");
-			break;
-		case 'T':
-			strcpy(cc, "111 010 010 010 010");
-			break;
-		case 'U':
-			strcpy(cc, "101 101 101 101 111");
-			break;
-		case 'V':
-			strcpy(cc, "101 101 101 101 010");
-			break;
-		case 'W':
-			strcpy(cc, "10001 10001 10101 10101 11111");
-			break;
-		case 'X':
-			strcpy(cc, "101 101 010 101 101");
-			break;
-		case 'Y':
-			strcpy(cc, "101 101 010 010 010");
-			break;
-		case 'Z':
-			strcpy(cc, "111 001 010 100 111");
-			break;	
-		
-		default:
-			strcpy(cc, "111 111 111 111 111");
-			break;
-
-	}
-	
-	i = x; j = y; k = 0; xCounter = 0; charWidth = 0; charWidth_max = 0;
-	ccc = cc[k];
-	while (ccc != '\0') {
-		if (ccc == '1') {
-			blockColorBuffer[j][i] = c;
-			i++;
-			xCounter++;
-			charWidth++;
-		}
-		else if (ccc == '0') {
-			i++;
-			xCounter++;
-			charWidth++;
-		}
-		else if (ccc == '-') {
-			j--;
-		}
-		else {
-			j++;
-			i -= xCounter;
-			xCounter = 0;
-
-			if (charWidth > charWidth_max) {
-				charWidth_max = charWidth;
-			}
-			charWidth = 0;
-		}
-		k++;
-		ccc = cc[k];
-	}
-	
-	return charWidth_max;
+	return printScaledCharToBuffer(x, y, a, c, 1);
 }
 
 /**
@@ -705,125 +956,115 @@ void intelligentDrawBlockToScreenBuffer(int x, int y, int c) {
 				screenColorBuffer[realY][x] = c + 16 * (screenColorBuffer[realY][x] / 16);
 			}
 		}
+		markCellsDirty(x, realY, x, realY);
+	}
+}
+
+/**
+ * Kierrtt blockColorBufferin sislt niin, ett kohta (x, y) siirtyy
+ * kohtaan (0, 0). 0 <= x < COLS, 0 <= y < ROWS * 2. Kukin rivi kopioidaan
+ * kahtena yhtenisen ptkn transformBufferin kautta.
+ */
+static void rotateBlockBufferData(int x, int y) {
+	int j, k;
+
+	if (x == 0 && y == 0) {
+		return;
+	}
+
+	k = y;
+	for (j = 0; j < ROWS * 2; j++) {
+		memcpy(transformBuffer[j], blockColorBuffer[k] + x, COLS - x);
+		memcpy(transformBuffer[j] + COLS - x, blockColorBuffer[k], x);
+		if (++k == ROWS * 2) {
+			k = 0;
+		}
 	}
+	memcpy(blockColorBuffer, transformBuffer, sizeof(char) * 2 * ROWS * COLS);
 }
 
 /**
  * Siirt blockBufferin sislt x ja y askelta haluttuun suuntaan. Wrappaa.
  * Hyvksikytt transformBufferia.
+ *
+ * Toroidisessa tilassa (ks. setToroidalBlockBuffer) bufferia ei kopioida
+ * lainkaan, vaan ainoastaan origoa siirretn.
  */
 void shiftBlockBuffer(int x, int y) {
-	int xSize, ySize, i, j;
-	if (x != 0) {
-		if (x < 0) {
-			xSize = -x;
-			// Ensin tallennetaan leikattava osio.
-			for (j = 0; j < ROWS * 2; j++) {
-				for (i = 0; i < xSize; i++) {
-					transformBuffer[j][i] = blockColorBuffer[j][i];
-				}
-			}
-			// Shiftataan blockColorBufferia.
-			for (j = 0; j < ROWS * 2; j++) {
-				for (i = 0; i < COLS; i++) {
-					if (i + xSize < COLS) {
-						blockColorBuffer[j][i] = blockColorBuffer[j][i + xSize];
-					}
-					else {
-						blockColorBuffer[j][i] = transformBuffer[j][(i+xSize)%COLS];
-					}
-				}
-			}
-
-		}
-		else {
-			xSize = x;
-			// Ensin tallennetaan leikattava osio.
-			for (j = 0; j < ROWS * 2; j++) {
-				for (i = COLS-xSize; i < COLS; i++) {
-					transformBuffer[j][i] = blockColorBuffer[j][i];
-				}
-			}
-			// Shiftataan blockColorBufferia.
-			for (j = 0; j < ROWS * 2; j++) {
-				for (i = COLS-1; i > -1; i--) {
-					if (i - xSize > -1) {
-						blockColorBuffer[j][i] = blockColorBuffer[j][i-xSize];
-					}
-					else {
-						blockColorBuffer[j][i] = transformBuffer[j][COLS+((i-xSize)%COLS)];
-					}
-				}
-			}
+	// Siirron jlkeen ruudun kohta (i, j) on entinen kohta (i - x, j - y).
+	x %= COLS;
+	y %= ROWS * 2;
+	if (x == 0 && y == 0) {
+		return;
+	}
 
-		}
+	if (toroidalBlockBuffer) {
+		blockOriginX = (blockOriginX - x + COLS) % COLS;
+		blockOriginY = (blockOriginY - y + ROWS * 2) % (ROWS * 2);
+	}
+	else {
+		rotateBlockBufferData((COLS - x) % COLS, (ROWS * 2 - y) % (ROWS * 2));
+	}
+	markAllDirty();
+}
 
+/**
+ * Kytkee toroidisen tilan plle tai pois. Toroidisessa tilassa
+ * shiftBlockBuffer siirt vain origoa, ja ruudunpivitys (sek
+ * drawBlocksToBuffer ja drawTpBlocksToBuffer) lukee bufferia origosta alkaen
+ * wrapaten. Muut funktiot, kuten piirtoprimitiivit, kyttvt bufferin omia
+ * koordinaatteja: ruudun kohdan (x, y) bufferikoordinaatit saa lismll
+ * origon (getBlockBufferOrigin) ja ottamalla jakojnnksen.
+ *
+ * Tilasta poistuttaessa origo kirjoitetaan bufferiin (normalizeBlockBuffer),
+ * jolloin bufferi vastaa jlleen ruutua.
+ */
+void setToroidalBlockBuffer(bool b) {
+	if (!b) {
+		normalizeBlockBuffer();
 	}
-	if (y != 0) {
-		if (y < 0) {
-			ySize = -y;
-			// Ensin tallennetaan leikattava osio.
-			for (j = 0; j < ySize; j++) {
-				for (i = 0; i < COLS; i++) {
-					transformBuffer[j][i] = blockColorBuffer[j][i];
-				}
-			}
-			// Shiftataan blockColorBufferia.
-			for (j = 0; j < ROWS * 2; j++) {
-				for (i = 0; i < COLS; i++) {
-					if (j + ySize < ROWS*2) {
-						blockColorBuffer[j][i] = blockColorBuffer[j + ySize][i];
-					}
-					else {
-						blockColorBuffer[j][i] = transformBuffer[(j + ySize) % (ROWS*2)][i];
-					}
-				}
-			}
+	toroidalBlockBuffer = b;
+}
 
-		}
-		else {
-			ySize = y;
-			// Ensin tallennetaan leikattava osio.
-			for (j = ROWS * 2 - ySize; j < ROWS * 2; j++) {
-				for (i = 0; i < COLS; i++) {
-					transformBuffer[j][i] = blockColorBuffer[j][i];
-				}
-			}
-			// Shiftataan blockColorBufferia.
-			for (j = ROWS*2 - 1; j > -1; j--) {
-				for (i = 0; i < COLS; i++) {
-					if (j - ySize > -1) {
-						blockColorBuffer[j][i] = blockColorBuffer[j - ySize][i];
-					}
-					else {
-						blockColorBuffer[j][i] = transformBuffer[(ROWS*2) + ((j - ySize) % (ROWS*2))][i];
-					}
-				}
-			}
+void getBlockBufferOrigin(int* x, int* y) {
+	*x = blockOriginX;
+	*y = blockOriginY;
+}
 
-		}
+/**
+ * Kierrtt bufferin sislln niin, ett origo on taas (0, 0) ja bufferi
+ * vastaa ruutua. Ruudulla nkyv kuva ei muutu.
+ */
+void normalizeBlockBuffer(void) {
+	rotateBlockBufferData(blockOriginX, blockOriginY);
+	blockOriginX = 0;
+	blockOriginY = 0;
+}
 
-	}
+/**
+ * Kiert rivi row amount askelta oikealle. 0 < amount < COLS.
+ */
+static void rotateBlockRow(int row, int amount) {
+	char a[COLS];
+	char* p = blockColorBuffer[row];
+
+	memcpy(a, p + COLS - amount, amount);
+	memmove(p + amount, p, COLS - amount);
+	memcpy(p, a, amount);
 }
 
 /**
  * Shiftaa blockbufferin rivi miinusmerkkisesti vasemmalle tai plusmerkkisesti oikealle i:n verran.
+ * Rivi kierretn kerralla, joten hinta ei riipu siirron pituudesta.
  */
 void shiftBlockBufferRow(int row, int amount) {
-	int j;
-	if (amount > 0) {
-		for (j = 0; j < amount; j++) {
-			shiftBlockBufferRowRight(row);
-		}
+	amount %= COLS;
+	if (amount < 0) {
+		amount += COLS;
 	}
-	else if (amount < 0) {
-		amount = -amount;
-		for (j = 0; j < amount; j++) {
-			shiftBlockBufferRowLeft(row);
-		}
-	}
-	else {
-		;
+	if (amount != 0) {
+		rotateBlockRow(row, amount);
+		markBlockBufferDirty(0, row, COLS, 1);
 	}
 }
 
@@ -831,13 +1072,7 @@ void shiftBlockBufferRow(int row, int amount) {
  * Shiftaa blockbufferia merkin verran vasemmalle.
  */
 void shiftBlockBufferRowLeft(int row) {
-	int i;
-	char a;
-	a = blockColorBuffer[row][0];
-	for (i = 0; i < COLS - 1; i++) {
-		blockColorBuffer[row][i] = blockColorBuffer[row][i + 1];
-	}
-	blockColorBuffer[row][COLS - 1] = a;
+	shiftBlockBufferRow(row, -1);
 }
 
 /**
@@ -845,51 +1080,117 @@ void shiftBlockBufferRowLeft(int row) {
  */
 
 void shiftBlockBufferRowRight(int row) {
-	int i;
-	char a;
-	a = blockColorBuffer[row][COLS - 1];
-	for (i = COLS - 1; i > 0; i--) {
-		blockColorBuffer[row][i] = blockColorBuffer[row][i - 1];
-	}
-	blockColorBuffer[row][0] = a;
+	shiftBlockBufferRow(row, 1);
 }
 
+/**
+ * Shiftaa saraketta col alaspin (plusmerkkisesti) tai ylspin
+ * (miinusmerkkisesti). Sarake kierretn kerralla.
+ */
 void shiftBlockBufferCol(int col, int amount) {
-	int j;
-	if (amount > 0) {
-		for (j = 0; j < amount; j++) {
-			shiftBlockBufferColDown(col);
-		}
+	char a[ROWS * 2];
+	int i, k;
+
+	amount %= ROWS * 2;
+	if (amount < 0) {
+		amount += ROWS * 2;
 	}
-	else if (amount < 0) {
-		amount = -amount;
-		for (j = 0; j < amount; j++) {
-			shiftBlockBufferColUp(col);
-		}
+	if (amount == 0) {
+		return;
 	}
-	else {
-		;
+
+	for (i = 0; i < ROWS * 2; i++) {
+		a[i] = blockColorBuffer[i][col];
 	}
+	k = ROWS * 2 - amount;
+	for (i = 0; i < ROWS * 2; i++) {
+		blockColorBuffer[i][col] = a[k];
+		if (++k == ROWS * 2) {
+			k = 0;
+		}
+	}
+	markBlockBufferDirty(col, 0, 1, ROWS * 2);
 }
 
 void shiftBlockBufferColUp(int col) {
-	int i;
-	char a;
-	a = blockColorBuffer[0][col];
-	for (i = 0; i < ROWS*2 - 1; i++) {
-		blockColorBuffer[i][col] = blockColorBuffer[i + 1][col];
-	}
-	blockColorBuffer[ROWS*2 - 1][col] = a;
+	shiftBlockBufferCol(col, -1);
 }
 
 void shiftBlockBufferColDown(int col) {
-	int i;
-	char a;
-	a = blockColorBuffer[ROWS*2 - 1][col];
-	for (i = ROWS*2 - 1; i > 0; i--) {
-		blockColorBuffer[i][col] = blockColorBuffer[i - 1][col];
+	shiftBlockBufferCol(col, 1);
+}
+
+/**
+ * Shiftaa kaikkia blockbufferin rivej kerralla: rivi j siirtyy amounts[j]
+ * askelta (ROWS * 2 arvoa, etumerkit kuten shiftBlockBufferRow). Kukin rivi
+ * kierretn yhdell memmovella.
+ */
+void shiftBlockBufferRows(const int* amounts) {
+	int j, a;
+
+	for (j = 0; j < ROWS * 2; j++) {
+		a = amounts[j] % COLS;
+		if (a < 0) {
+			a += COLS;
+		}
+		if (a != 0) {
+			rotateBlockRow(j, a);
+			markBlockBufferDirty(0, j, COLS, 1);
+		}
+	}
+}
+
+/**
+ * Shiftaa kaikkia blockbufferin sarakkeita kerralla: sarake i siirtyy
+ * amounts[i] askelta (COLS arvoa, etumerkit kuten shiftBlockBufferCol).
+ * Tehdn yhdell rivi kerrallaan etenevll kopiolla transformBufferin
+ * kautta.
+ */
+void shiftBlockBufferCols(const int* amounts) {
+	int src[COLS];
+	int i, j;
+
+	// src[i] on rivi, josta sarakkeen i seuraava palikka luetaan.
+	for (i = 0; i < COLS; i++) {
+		src[i] = (ROWS * 2 - amounts[i] % (ROWS * 2)) % (ROWS * 2);
+	}
+	for (j = 0; j < ROWS * 2; j++) {
+		for (i = 0; i < COLS; i++) {
+			transformBuffer[j][i] = blockColorBuffer[src[i]][i];
+			if (++src[i] == ROWS * 2) {
+				src[i] = 0;
+			}
+		}
+	}
+	memcpy(blockColorBuffer, transformBuffer, sizeof(char) * 2 * ROWS * COLS);
+	markAllDirty();
+}
+
+/**
+ * Asettaa ruudun palikkariveille vaakasiirrot, jotka tehdn vasta
+ * ruudunpivityksess: ruudun rivi y nytetn offsets[y] askelta oikealle
+ * (miinusmerkkisesti vasemmalle) siirrettyn ja wrapattuna. Bufferin
+ * sislt ei muutu, joten esim. aalto- ja parallaksiefektit maksavat vain
+ * taulukon pivityksen. offsets sislt ROWS * 2 arvoa; NULL poistaa
+ * siirrot.
+ */
+void setBlockRowOffsets(const int* offsets) {
+	int j, a;
+
+	for (j = 0; j < ROWS * 2; j++) {
+		a = 0;
+		if (offsets != NULL) {
+			a = offsets[j] % COLS;
+			if (a < 0) {
+				a += COLS;
+			}
+		}
+		if (a != blockRowOffsets[j]) {
+			blockRowOffsets[j] = a;
+			markScreenBlocksDirty(0, j, COLS, 1);
+		}
 	}
-	blockColorBuffer[0][col] = a;
+	blockRowOffsetsOn = (offsets != NULL);
 }
 
 /**
@@ -938,26 +1239,143 @@ void fillRect(int x, int y, int w, int h, int color) {
 		}
 
 	}
+	markScreenBlocksDirty(x, y, w, h);
+
+}
+
+void pushClipRect(int x, int y, int w, int h) {
+	if (clipDepth == MAX_CLIP_RECTS) {
+		clipOverflow++;
+		return;
+	}
+	clipStack[clipDepth][0] = clipX0;
+	clipStack[clipDepth][1] = clipY0;
+	clipStack[clipDepth][2] = clipX1;
+	clipStack[clipDepth][3] = clipY1;
+	clipDepth++;
+
+	if (x > clipX0) { clipX0 = x; }
+	if (y > clipY0) { clipY0 = y; }
+	if (x + w - 1 < clipX1) { clipX1 = x + w - 1; }
+	if (y + h - 1 < clipY1) { clipY1 = y + h - 1; }
+}
+
+void popClipRect(void) {
+	if (clipOverflow > 0) {
+		clipOverflow--;
+	}
+	else if (clipDepth > 0) {
+		clipDepth--;
+		clipX0 = clipStack[clipDepth][0];
+		clipY0 = clipStack[clipDepth][1];
+		clipX1 = clipStack[clipDepth][2];
+		clipY1 = clipStack[clipDepth][3];
+	}
+}
+
+void resetClipRect(void) {
+	clipX0 = 0;
+	clipY0 = 0;
+	clipX1 = COLS - 1;
+	clipY1 = ROWS * 2 - 1;
+	clipDepth = 0;
+	clipOverflow = 0;
+}
 
+void getClipRect(int* x, int* y, int* w, int* h) {
+	*x = clipX0;
+	*y = clipY0;
+	*w = (clipX1 >= clipX0) ? clipX1 - clipX0 + 1 : 0;
+	*h = (clipY1 >= clipY0) ? clipY1 - clipY0 + 1 : 0;
+}
+
+static int outCode(int x, int y) {
+	int code = 0;
+
+	if (x < clipX0) { code |= CLIP_LEFT; }
+	else if (x > clipX1) { code |= CLIP_RIGHT; }
+	if (y < clipY0) { code |= CLIP_TOP; }
+	else if (y > clipY1) { code |= CLIP_BOTTOM; }
+	return code;
 }
 
 /**
- * Piirt tytetyn suorakaiteen blockBufferiin. Ei sisll "turhia" ylimenotarkistuksia.
+ * Pinta, johon ympyrt piirretn: koko ruutu tai leikkausalueen ikkuna,
+ * jonka (0, 0) on (clipX0, clipY0).
+ */
+static BlockSurface* clipTarget(BlockSurface* view) {
+	if (clipX0 == 0 && clipY0 == 0 && clipX1 == COLS - 1 && clipY1 == ROWS * 2 - 1) {
+		return &screenBlockSurface;
+	}
+	getClipSurface(view);
+	return view;
+}
+
+/**
+ * Bresenhamin viivan leikkaus kokonaisluvuin (Liang-Barsky). Viiva ottaa
+ * pakselilla askeleet k = 0 ... d, ja sivuakselilla se on tllin edennyt
+ * m(k) = (2 * e * k + d - 1) / (2 * d) askelta (e = sivuakselin matka).
+ * Rajaa askeleet vlille k0 ... k1 niin, ett k on vlill lo ... hi ja m(k)
+ * vlill m0 ... m1. Leikattu viiva kulkee siis tsmlleen samoja palikoita
+ * kuin leikkaamaton. Palauttaa false, jos mitn ei j.
+ */
+static bool clipLineSteps(int d, int e, int lo, int hi, int m0, int m1, int* k0, int* k1) {
+	*k0 = (lo > 0) ? lo : 0;
+	*k1 = (hi < d) ? hi : d;
+	if (m0 > e || m1 < 0) {
+		return false;
+	}
+	if (m0 > 0) {
+		lo = (2 * d * m0 - d) / (2 * e) + 1;
+		if (lo > *k0) { *k0 = lo; }
+	}
+	if (m1 < e) {
+		hi = (2 * d * m1 + d) / (2 * e);
+		if (hi < *k1) { *k1 = hi; }
+	}
+	return *k0 <= *k1;
+}
+
+/**
+ * Piirt tytetyn suorakaiteen blockBufferiin. Suorakaide leikataan
+ * leikkausalueeseen, jonka jlkeen rivit tytetn tarkistuksitta.
  */
 void fillRectToBlockBuffer(int x, int y, int w, int h, int color) {
-	int j, i;
+	int j;
+
+	if (x < clipX0) { w -= clipX0 - x; x = clipX0; }
+	if (y < clipY0) { h -= clipY0 - y; y = clipY0; }
+	if (x + w > clipX1 + 1) { w = clipX1 + 1 - x; }
+	if (y + h > clipY1 + 1) { h = clipY1 + 1 - y; }
+	if (w <= 0 || h <= 0) {
+		return;
+	}
+
 	for (j = y; j < y + h; j++) {
-		for (i = x; i < x + w; i++) {
-			blockColorBuffer[j][i] = color;
-		}
+		memset(&blockColorBuffer[j][x], color, w);
 	}
+	markBlockBufferDirty(x, y, w, h);
 }
 
 /**
- * Piirt tyhjn suorakaiteen blockBufferiin. Ei ylimenotarkistuksia.
+ * Piirt tyhjn suorakaiteen blockBufferiin. Kokonaan leikkausalueen
+ * sisll oleva suorakaide piirretn ilman ylimenotarkistuksia, osittain
+ * nkyv sivu kerrallaan leikattuna.
  */
 void strokeRectToBlockBuffer(int x, int y, int w, int h, int color) {
 	int j;
+
+	if (x > clipX1 || y > clipY1 || x + w < clipX0 || y + h < clipY0) {
+		return;
+	}
+	if (x < clipX0 || y < clipY0 || x + w > clipX1 || y + h > clipY1) {
+		fillRectToBlockBuffer(x, y, w + 1, 1, color);
+		fillRectToBlockBuffer(x, y + h, w + 1, 1, color);
+		fillRectToBlockBuffer(x, y + 1, 1, h - 1, color);
+		fillRectToBlockBuffer(x + w, y + 1, 1, h - 1, color);
+		return;
+	}
+
 	for (j = y; j <= y + h; j++) {
 		blockColorBuffer[j][x] = color;
 		blockColorBuffer[j][x + w] = color;
@@ -967,101 +1385,29 @@ void strokeRectToBlockBuffer(int x, int y, int w, int h, int color) {
 		blockColorBuffer[y][j] = color;
 		blockColorBuffer[y + h][j] = color;
 	}
+	markBlockBufferDirty(x, y, w + 1, h + 1);
 }
 
 /**
- * Piirt ympyrn blockBufferiin.
+ * Piirt ympyrn blockBufferiin (ks. circle.h).
  */
 void strokeCircleToBlockBuffer(int x, int y, int radius, int color) {
-	int i, j, k, cy = y - radius, cx = x - radius;
-	static int cy_a[4];
-	static int cx_a[4];
-	static int fx_a[4];
-	static int fy_a[4];
-	double d;
-
-	cy_a[0] = y - radius;
-	cy_a[1] = y + radius;
-	cy_a[2] = y - radius;
-	cy_a[3] = y + radius;
-	cx_a[0] = x + radius;
-	cx_a[1] = x + radius;
-	cx_a[2] = x - radius;
-	cx_a[3] = x - radius;
-	fy_a[0] = 1;
-	fy_a[1] = -1;
-	fy_a[2] = 1;
-	fy_a[3] = -1;
-	fx_a[0] = -1;
-	fx_a[1] = -1;
-	fx_a[2] = 1;
-	fx_a[3] = 1;
-
-	// Lukee vain yhden neljnneksen koordinaatit ja nelist ne.
-	for (i = 0; i <= radius; i++) {
-		for (j = 0; j <= radius; j++) {
-			d = sqrt((double)(i - radius) * (i - radius) + (j - radius) * (j - radius));
-			if (d > radius - 0.5 && d < radius + 0.5) {
-				for (k = 0; k < 4; k++) {
-					if (cy_a[k] + i*fy_a[k] < 0 || cx_a[k] + j*fx_a[k] < 0 || cy_a[k] + i*fy_a[k] >= ROWS * 2 || cx_a[k] + j * fx_a[k] >= COLS) {
-						;
-					}
-					else {
-						blockColorBuffer[cy_a[k] + i*fy_a[k]][cx_a[k] + j*fx_a[k]] = color;
-					}
-				}
-				
-			}
-		}
+	BlockSurface view;
+	BlockSurface* s = clipTarget(&view);
+
+	strokeCircleToSurface(s, x - clipX0, y - clipY0, radius, color);
+	if (s == &view) {
+		markBlockBufferDirty(x - radius, y - radius, 2 * radius + 1, 2 * radius + 1);
 	}
 }
 
 void fillCircleToBlockBuffer(int x, int y, int radius, int color) {
-	int i, j, k, fillOn, cy = y - radius, cx = x - radius;
-	static int cy_a[4];
-	static int cx_a[4];
-	static int fx_a[4];
-	static int fy_a[4];
-	double d;
-
-	cy_a[0] = y - radius;
-	cy_a[1] = y + radius;
-	cy_a[2] = y - radius;
-	cy_a[3] = y + radius;
-	cx_a[0] = x + radius;
-	cx_a[1] = x + radius;
-	cx_a[2] = x - radius;
-	cx_a[3] = x - radius;
-	fy_a[0] = 1;
-	fy_a[1] = -1;
-	fy_a[2] = 1;
-	fy_a[3] = -1;
-	fx_a[0] = -1;
-	fx_a[1] = -1;
-	fx_a[2] = 1;
-	fx_a[3] = 1;
-
-	// Lukee vain yhden neljnneksen koordinaatit ja nelist ne.
-	for (i = 0; i <= radius; i++) {
-		fillOn = 0;
-		for (j = 0; j <= radius; j++) {
-			if (fillOn == 0) {
-				d = sqrt((double)(i - radius) * (i - radius) + (j - radius) * (j - radius));
-				if (d > radius - 0.5 && d < radius + 0.5) {
-					fillOn = 1;
-				}
-			}
-			if (fillOn == 1) {
-					for (k = 0; k < 4; k++) {
-						if (cy_a[k] + i * fy_a[k] < 0 || cx_a[k] + j * fx_a[k] < 0 || cy_a[k] + i * fy_a[k] >= ROWS * 2 || cx_a[k] + j * fx_a[k] >= COLS) {
-							;
-						}
-						else {
-							blockColorBuffer[cy_a[k] + i * fy_a[k]][cx_a[k] + j * fx_a[k]] = color;
-						}
-					}
-			}
-		}
+	BlockSurface view;
+	BlockSurface* s = clipTarget(&view);
+
+	fillCircleToSurface(s, x - clipX0, y - clipY0, radius, color);
+	if (s == &view) {
+		markBlockBufferDirty(x - radius, y - radius, 2 * radius + 1, 2 * radius + 1);
 	}
 }
 
@@ -1076,43 +1422,37 @@ void triangleToBlockBuffer(int x0, int y0, int x1, int y1, int x2, int y2, int c
 
 /**
  * Piirt viivan blockBufferiin. Hyvksikytt puhtaasti Bresenhamin algoritmia.
+ * Viiva leikataan leikkausalueeseen; koordinaattien on oltava vlilt
+ * -16384 ... 16383, jotta leikkauksen vlitulokset mahtuvat int:iin.
  */
 void lineToBlockBuffer(int x0, int y0, int x1, int y1, int color) {
-	int i;
-	// Listn kohtisuorille viivoille tmminen nopeutus:
+	int lo, hi;
+
+	// Kokonaan leikkausalueen yhdell puolella: ei mitn piirrettv.
+	if (outCode(x0, y0) & outCode(x1, y1)) {
+		return;
+	}
+
+	// Kohtisuorat viivat leikataan ja piirretn suoraan tss.
 	if (y0 == y1) {
-		if (x0 == x1) {
-			blockColorBuffer[y0][x0] = color;
-		}
-		else {
-			if (x0 > x1) {
-				for (i = x0; i >= x1; i--) {
-					blockColorBuffer[y0][i] = color;
-				}
-			}
-			else {
-				for (i = x0; i <= x1; i++) {
-					blockColorBuffer[y0][i] = color;
-				}
-			}
+		lo = (x0 < x1) ? x0 : x1;
+		hi = (x0 < x1) ? x1 : x0;
+		if (lo < clipX0) { lo = clipX0; }
+		if (hi > clipX1) { hi = clipX1; }
+		if (lo <= hi) {
+			memset(&blockColorBuffer[y0][lo], color, hi - lo + 1);
+			markBlockBufferDirty(lo, y0, hi - lo + 1, 1);
 		}
 	}
 
 	else if (x0 == x1) {
-		if (y0 == y1) {
-			blockColorBuffer[y0][x0] = color;
-		}
-		else {
-			if (y0 > y1) {
-				for (i = y0; i >= y1; i--) {
-					blockColorBuffer[i][x0] = color;
-				}
-			}
-			else {
-				for (i = y0; i <= y1; i++) {
-					blockColorBuffer[i][x0] = color;
-				}
-			}
+		lo = (y0 < y1) ? y0 : y1;
+		hi = (y0 < y1) ? y1 : y0;
+		if (lo < clipY0) { lo = clipY0; }
+		if (hi > clipY1) { hi = clipY1; }
+		markBlockBufferDirty(x0, lo, 1, hi - lo + 1);
+		for (; lo <= hi; lo++) {
+			blockColorBuffer[lo][x0] = color;
 		}
 	}
 
@@ -1136,8 +1476,14 @@ void lineToBlockBuffer(int x0, int y0, int x1, int y1, int color) {
 	}
 }
 
+/**
+ * Loiva viiva vasemmalta oikealle (x0 <= x1). Jos ptepisteet ovat
+ * leikkausalueen sisll, silmukka ajetaan ilman tarkistuksia; muuten
+ * piirrettvt askeleet rajataan ensin clipLineStepsill.
+ */
 void lineToBlockBufferLow(int x0, int y0, int x1, int y1, int color) {
-	int dx, dy, yi, y, x, D;
+	int dx, dy, yi, y, x, D, xEnd, yEnd, k0, k1, m;
+	int c0, c1;
 	dx = x1 - x0;
 	dy = y1 - y0;
 	yi = 1;
@@ -1146,9 +1492,31 @@ void lineToBlockBufferLow(int x0, int y0, int x1, int y1, int color) {
 		dy = -dy;
 	}
 	D = 2 * dy - dx;
+	x = x0;
 	y = y0;
+	xEnd = x1;
+	yEnd = y1;
+
+	c0 = outCode(x0, y0);
+	c1 = outCode(x1, y1);
+	if (c0 & c1) {
+		return;
+	}
+	if (c0 | c1) {
+		if (!clipLineSteps(dx, dy, clipX0 - x0, clipX1 - x0,
+				(yi > 0) ? clipY0 - y0 : y0 - clipY1, (yi > 0) ? clipY1 - y0 : y0 - clipY0, &k0, &k1)) {
+			return;
+		}
+		m = (2 * dy * k0 + dx - 1) / (2 * dx);
+		x = x0 + k0;
+		y = y0 + yi * m;
+		D = 2 * dy * (k0 + 1) - dx - 2 * dx * m;
+		xEnd = x0 + k1;
+		yEnd = y0 + yi * ((2 * dy * k1 + dx - 1) / (2 * dx));
+	}
+	markBlockBufferDirty(x, (yi > 0) ? y : yEnd, xEnd - x + 1, abs(yEnd - y) + 1);
 
-	for (x = x0; x <= x1; x++) {
+	for (; x <= xEnd; x++) {
 		blockColorBuffer[y][x] = color;
 		if (D > 0) {
 			y += yi;
@@ -1158,8 +1526,12 @@ void lineToBlockBufferLow(int x0, int y0, int x1, int y1, int color) {
 	}
 }
 
+/**
+ * Jyrkk viiva ylhlt alas (y0 <= y1); leikkaus kuten lineToBlockBufferLow.
+ */
 void lineToBlockBufferHigh(int x0, int y0, int x1, int y1, int color) {
-	int dx, dy, xi, x, y, D;
+	int dx, dy, xi, x, y, D, xEnd, yEnd, k0, k1, m;
+	int c0, c1;
 	dx = x1 - x0;
 	dy = y1 - y0;
 	xi = 1;
@@ -1169,8 +1541,30 @@ void lineToBlockBufferHigh(int x0, int y0, int x1, int y1, int color) {
 	}
 	D = 2 * dx - dy;
 	x = x0;
+	y = y0;
+	xEnd = x1;
+	yEnd = y1;
+
+	c0 = outCode(x0, y0);
+	c1 = outCode(x1, y1);
+	if (c0 & c1) {
+		return;
+	}
+	if (c0 | c1) {
+		if (!clipLineSteps(dy, dx, clipY0 - y0, clipY1 - y0,
+				(xi > 0) ? clipX0 - x0 : x0 - clipX1, (xi > 0) ? clipX1 - x0 : x0 - clipX0, &k0, &k1)) {
+			return;
+		}
+		m = (2 * dx * k0 + dy - 1) / (2 * dy);
+		y = y0 + k0;
+		x = x0 + xi * m;
+		D = 2 * dx * (k0 + 1) - dy - 2 * dy * m;
+		yEnd = y0 + k1;
+		xEnd = x0 + xi * ((2 * dx * k1 + dy - 1) / (2 * dy));
+	}
+	markBlockBufferDirty((xi > 0) ? x : xEnd, y, abs(xEnd - x) + 1, yEnd - y + 1);
 
-	for (y = y0; y <= y1; y++) {
+	for (; y <= yEnd; y++) {
 		blockColorBuffer[y][x] = color;
 		if (D > 0) {
 			x += xi;
@@ -1186,11 +1580,11 @@ void lineToBlockBufferHigh(int x0, int y0, int x1, int y1, int color) {
  * ett tyhjent ruudun, kyt initTextMode()-funktiota.
  */
 void clrScr(void){
-	char* videomem = (char*)SCREEN_LIN_ADDR;
 	int i;
 	for (i = 0; i < ROWS * COLS * 2; i++) {
-		*(videomem++) = 0;
+		videoMemory[i] = presentedBytes[i] = 0;
 	}
+	markAllDirty();
 }
 
 /**
@@ -1198,66 +1592,30 @@ void clrScr(void){
  * tydet 16 taustavri (false).
  */
 void setBlinking(bool b) {
-
-	int a;
-
-	union REGS regs;
-
-	if (b) { a = 0x01; }
-	else { a = 0x00; }
-
-	regs.w.ax = 0x1003;
-	regs.h.bl = a;
-	int386(0x10, &regs, &regs);
+	videoBackend->setBlinking(b);
 }
 
 /**
  * Nytt tai piilottaa tekstimoodin vilkkuvan osoittimen.
- * Katso: https://wiki.osdev.org/Text_Mode_Cursor
  */
 void showCursor(bool b) {
-	union REGS regs;
-	
-	regs.h.ah = 0x01;
-
-	if (b) {
-		regs.h.ch = 14;
-		regs.h.cl = 15;
-		int386(0x10, &regs, &regs);
-	}
+	videoBackend->showCursor(b);
+}
 
-	else {
-		regs.h.ch = 0x3f;
-		int386(0x10, &regs, &regs);
-	}
+/**
+ * Merkkisolun leveys pikselein: 9 (oletus) tai 8. Kahdeksan pikselin
+ * soluissa merkkien vliin ei j tyhj saraketta (ks. hires.h).
+ */
+void setCharWidth(int width) {
+	videoBackend->setCharWidth(width);
 }
 
 /**
- * Fonttien muokkaus
- * http://www.techhelpmanual.com/152-int_10h_1100h__load_user_defined_font.html
+ * Fonttien muokkaus: korvaa merkin cnum 16 rivin (tavun) bittikartalla.
+ * Jos merkki on jo sama, mitn ei lhetet (ks. charset.h).
  */
 void defineChar(int cnum, char* fontData) {
-	union REGS regs;
-	struct SREGS sregs;
-	int interrupt_no = 0x10;
-	char *str;
-
-	/**
-	 * Tytt taetta siit, ett tm ei kirjoittaisi vriin rekistereihin jotain,
-	 * ei ole, sill en ymmrr toteutusta tysin. Kyt varoen.
-	 */
-
-	memset(&sregs, 0, sizeof(sregs));
-	str = (char*)(MK_FP(regs.w.dx, 0));
-	_fstrcpy(str, fontData);
-	regs.w.ax = 0x1100;
-	regs.h.bl = 0;
-	regs.h.bh = 16;
-	regs.w.cx = 1;
-	regs.w.dx = cnum;
-	int386x(interrupt_no, &regs, &regs, &sregs);
-	
-
+	loadGlyphs(cnum, 1, fontData);
 }
 
 /**
@@ -1303,7 +1661,6 @@ void loadAnsiToImageBuffer(char* filename) {
 }
 
 void drawScreenFromImageBuffer(bool transparency) {
-	char* videomem = (char*)SCREEN_LIN_ADDR;
 	int i;
 	char c;
 
@@ -1312,20 +1669,20 @@ void drawScreenFromImageBuffer(bool transparency) {
 	if (transparency) {
 		for (i = 0; i < ROWS * COLS * 2; i++) {
 			if (i % 2 == 0 && imageBuffer[i] == 32) {
-				videomem += 2;
 				i++;
 			}
 			else {
-				*(videomem++) = imageBuffer[i];
+				videoMemory[i] = presentedBytes[i] = imageBuffer[i];
 			}
 		}
 	}
 
 	else {
 		for (i = 0; i < ROWS * COLS * 2; i++) {
-			*(videomem++) = imageBuffer[i];
+			videoMemory[i] = presentedBytes[i] = imageBuffer[i];
 		}
 	}
+	markAllDirty();
 }
 
 
@@ -1333,7 +1690,7 @@ void drawScreenFromImageBuffer(bool transparency) {
  * Tallentaa nyttmuistin sislln imageBufferiin.
  */
 void saveScreenToImageBuffer() {
-	char* videomem = (char*)SCREEN_LIN_ADDR;
+	char* videomem = videoMemory;
 	int i;
 
 	for (i = 0; i < ROWS * COLS * 2; i++) {
@@ -1373,6 +1730,7 @@ void copyImageBufferToScreenBuffer(bool transparency) {
 			screenColorBuffer[j][k] = imageBuffer[i + 1];
 		}
 	}
+	markAllDirty();
 }
 
 /**
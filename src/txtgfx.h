@@ -1,18 +1,27 @@
 #ifndef _TXTGFX_H
 #define _TXTGFX_H
 
+// Watcomilla knnettess kohteena on DOS ja oikea VGA-laitteisto. Muilla
+// kntjill kytetn emuloitua nyttlaitetta (ks. video.h).
+#ifdef __WATCOMC__
+	#define TXTGFX_DOS
+#endif
+
 #include <string.h>
-#include <conio.h>
 
 // uint32_t yms. tietotyyppit:
 #include <stdint.h>
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <dos.h>
-#include <i86.h>
 #include <stdbool.h>
 
+#ifdef TXTGFX_DOS
+	#include <conio.h>
+	#include <dos.h>
+	#include <i86.h>
+#endif
+
 #include <math.h>
 #include <time.h>
 
@@ -30,8 +39,16 @@
 #define SCREEN_AREA 0xb800
 #define SCREEN_LIN_ADDR ((SCREEN_AREA) << 4)
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 void setColor(int colorNumber, int r, int g, int b);
 void getColor(int colorNumber, int* r, int* g, int* b);
+void beginColorBatch(void);
+void endColorBatch(void);
+void flushColors(bool waitForRetrace);
+void waitRetrace(void);
 void randomizeColorRange(int start, int stop);
 void randomizeAllColors(void);
 
@@ -40,8 +57,8 @@ void fadeToColor(int colorNumber, int r, int g, int b);
 void setBlinking(bool b);
 
 void showCursor(bool b);
+void setCharWidth(int width);
 
-// Assembler-funktio kokonaisuudessaan tss tiedostossa.
 void initTextMode(void);
 
 void clrScr(void);
@@ -49,6 +66,15 @@ void clrScr(void);
 void drawScreenFromBuffer(void);
 void drawScreenFromBlockBuffer(void);
 
+// Nyttmuistin kohde ja muuttuneiden solujen seuranta:
+void setVideoMemory(char* p);
+char* getVideoMemory(void);
+void invalidateScreen(void);
+void markBlockBufferDirty(int x, int y, int w, int h);
+void markScreenBufferDirty(int x, int y, int w, int h);
+void writeScreenCells(int x, int y, const uint16_t* cells, int n);
+int getCellsWritten(void);
+
 void drawBlocksToBuffer(void);
 void drawTpBlocksToBuffer(char tpcolor);
 void printStringToBuffer(char* s, int x, int y);
@@ -58,9 +84,12 @@ void printColorStringToScreen(char* s, char x, char y, char color);
 void getBlockBuffer(void);
 void getScreenCharColorBuffer(void);
 
-void scaleBlockBuffer(int d);
-void scaleBlockBufferAtXY(int d, int origoX, int origoY);
+void scaleBlockBuffer(double d);
+void scaleBlockBufferAtXY(double d, int origoX, int origoY);
 void shiftBlockBuffer(int x, int y);
+void setToroidalBlockBuffer(bool b);
+void getBlockBufferOrigin(int* x, int* y);
+void normalizeBlockBuffer(void);
 void rotateBlockBuffer(double d);
 
 void shiftBlockBufferRow(int row, int amount);
@@ -71,12 +100,32 @@ void shiftBlockBufferCol(int col, int amount);
 void shiftBlockBufferColUp(int col);
 void shiftBlockBufferColDown(int col);
 
+void shiftBlockBufferRows(const int* amounts);
+void shiftBlockBufferCols(const int* amounts);
+void setBlockRowOffsets(const int* offsets);
+
 void clrScreenCharColorBuffer(void);
 void clrBlockColorBuffer(int color);
 
 void paintScreenColorBufferArea(int x, int y, int w, int h, int c);
 void paintScreenRow(int x, int y, int w, int c);
 
+// Leikkausalueiden pinon syvyys.
+#define MAX_CLIP_RECTS 16
+
+/**
+ * blockBufferiin piirtvt primitiivit (suorakaiteet, viivat, kolmiot,
+ * ympyrt, monikulmiot ja suuri teksti) leikataan leikkausalueeseen, joka
+ * on aluksi koko ruutu. pushClipRect rajaa aluetta edelleen (uusi alue on
+ * vanhan ja annetun leikkaus) ja popClipRect palauttaa edellisen.
+ * Koordinaatit ovat blockColorBufferin koordinaatteja mys toroidisessa
+ * tilassa.
+ */
+void pushClipRect(int x, int y, int w, int h);
+void popClipRect(void);
+void resetClipRect(void);
+void getClipRect(int* x, int* y, int* w, int* h);
+
 // Grafiikkaprimitiivien piirto yms.
 void fillRect(int x, int y, int w, int h, int color);
 void fillRectToBlockBuffer(int x, int y, int w, int h, int color);
@@ -119,16 +168,8 @@ extern char transformBuffer[2 * ROWS][COLS];
 // Bufferit bin-kuville.
 extern char imageBuffer[2 * ROWS * COLS];
 
-/**
- * Tekstimoodin alustus ja ruudun tyhjys assemblerilla. Nollaa mys paletin.
- * Katso: http://www.techhelpmanual.com/114-video_modes.html
- *
- * Huomionarvoista: koko funktio on .h-tiedostossa, koska Watcomin kntjll
- * sen kyttn saaminen ulkoisissa .c-tiedostoissa muulla tavoin on
- * ongelmallista.
- */
-#pragma aux initTextMode =			\
-	"mov ax, 0x03",					\
-	"int 0x10"
+#ifdef __cplusplus
+}
+#endif
 
 #endif
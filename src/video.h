@@ -0,0 +1,80 @@
+#ifndef _VIDEO_H
+#define _VIDEO_H
+
+#include "txtgfx.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Nyttlaitteen rajapinta. txtgfx ei koske laitteistoon (nyttmuisti,
+ * DAC-paletti, kursori, vilkkuminen, fontit) muuten kuin tmn kautta.
+ *
+ * dosVideoBackend kytt VGA:n tekstimuistia ja BIOS-keskeytyksi, ja se on
+ * kytettviss vain DOSissa (TXTGFX_DOS). emuVideoBackend emuloi 80x25
+ * tekstinytt muistissa (ks. emuVideo), joten kirjastoa voi ajaa ja
+ * profiloida mys esim. Linuxissa.
+ */
+typedef struct VideoBackend {
+	// ROWS * COLS * 2 tavua: merkki ja vri vuorotellen.
+	char* memory;
+
+	// 80x25 tekstimoodi, oletuspaletti ja tyhj ruutu.
+	void (*setMode)(void);
+
+	// Vrit 0-15, komponentit 0-63.
+	void (*setColor)(int colorNumber, int r, int g, int b);
+	void (*getColor)(int colorNumber, int* r, int* g, int* b);
+
+	void (*setBlinking)(bool b);
+	void (*showCursor)(bool b);
+
+	// count merkki alkaen merkist first, 16 tavua (rivi) per merkki.
+	void (*loadFont)(int first, int count, char* fontData);
+
+	// Merkkisolun leveys pikselein: 9 (oletus) tai 8.
+	void (*setCharWidth)(int width);
+
+	// Vrit first ... first + count - 1 kerralla, rgb-kolmikot perkkin.
+	void (*setColors)(int first, int count, const unsigned char* rgb);
+
+	// Odottaa pystypaluun alkua.
+	void (*waitRetrace)(void);
+} VideoBackend;
+
+/**
+ * Emuloidun nyttlaitteen tila.
+ */
+typedef struct EmuVideoDevice {
+	char memory[ROWS * COLS * 2];
+	unsigned char dac[16][3];
+	unsigned char font[256][16];
+	bool blinking;
+	bool cursorVisible;
+	int charWidth;
+	long retraces;
+	int cursorStart;
+	int cursorEnd;
+} EmuVideoDevice;
+
+extern EmuVideoDevice emuVideo;
+extern const VideoBackend emuVideoBackend;
+
+#ifdef TXTGFX_DOS
+	extern const VideoBackend dosVideoBackend;
+	#define DEFAULT_VIDEO_BACKEND dosVideoBackend
+	#define DEFAULT_VIDEO_MEMORY ((char*)SCREEN_LIN_ADDR)
+#else
+	#define DEFAULT_VIDEO_BACKEND emuVideoBackend
+	#define DEFAULT_VIDEO_MEMORY (emuVideo.memory)
+#endif
+
+void setVideoBackend(const VideoBackend* backend);
+const VideoBackend* getVideoBackend(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
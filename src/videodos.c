@@ -0,0 +1,232 @@
+/**
+ * DOSin nyttlaite: VGA:n tekstimuisti ja BIOSin video-keskeytys 10h.
+ * Knnetn vain DOSiin (TXTGFX_DOS); ks. video.h.
+ */
+
+#include "video.h"
+
+#ifdef TXTGFX_DOS
+
+/**
+ * Tekstimoodin alustus ja ruudun tyhjys. Nollaa mys paletin.
+ * Katso: http://www.techhelpmanual.com/114-video_modes.html
+ */
+static void dosSetMode(void) {
+	union REGS regs;
+
+	regs.w.ax = 0x03;
+	int386(0x10, &regs, &regs);
+}
+
+/**
+ * Vrien 0-15 DAC-rekisterien numerot; suuremmat vrinumerot ovat suoraan
+ * DAC-rekistereit.
+ * Huom.! Kirkkaat vrit sijaitsevat jostain syyst vlill 56-63?!! Ja
+ * ruskea kohdassa 20?! (Attribuuttiohjaimen paletti osoittaa nihin.)
+ */
+static const unsigned char dosDacIndex[16] = {
+	0, 1, 2, 3, 4, 5, 20, 7, 56, 57, 58, 59, 60, 61, 62, 63
+};
+
+#define VGA_DAC_WRITE 0x3c8
+#define VGA_DAC_DATA 0x3c9
+#define VGA_STATUS 0x3da
+
+static void dosSetColor(int colorNumber, int r, int g, int b) {
+	// Katso:
+	// http://www.techhelpmanual.com/144-int_10h_1010h__set_one_dac_color_register.html
+
+	union REGS regs;
+
+	// Huom.: Vrit ovat rekistereiss muodossa GBR. Rekisteri on 1010h.
+	regs.w.ax = 0x1010;
+	regs.w.bx = (colorNumber < 16) ? dosDacIndex[colorNumber] : colorNumber;
+	regs.h.dh = r;
+	regs.h.ch = g;
+	regs.h.cl = b;
+	int386(0x10, &regs, &regs);
+}
+
+/**
+ * Kirjoittaa vrit suoraan DAC-portteihin ilman BIOS-kutsuja. Osoite
+ * kasvaa itsestn jokaisen kolmikon jlkeen, joten se asetetaan vain, kun
+ * rekisterinumerot eivt ole perkkisi (0-5, 20, 7, 56-63).
+ */
+static void dosSetColors(int first, int count, const unsigned char* rgb) {
+	int i, index, next = -1;
+
+	if (first < 0 || count <= 0 || first + count > 16) {
+		return;
+	}
+
+	_disable();
+	for (i = first; i < first + count; i++) {
+		index = dosDacIndex[i];
+		if (index != next) {
+			outp(VGA_DAC_WRITE, index);
+		}
+		outp(VGA_DAC_DATA, rgb[0]);
+		outp(VGA_DAC_DATA, rgb[1]);
+		outp(VGA_DAC_DATA, rgb[2]);
+		rgb += 3;
+		next = index + 1;
+	}
+	_enable();
+}
+
+/**
+ * Odottaa, ett meneilln oleva pystypaluu pttyy ja seuraava alkaa
+ * (tilarekisterin bitti 3).
+ */
+static void dosWaitRetrace(void) {
+	while (inp(VGA_STATUS) & 0x08);
+	while (!(inp(VGA_STATUS) & 0x08));
+}
+
+static void dosGetColor(int colorNumber, int* r, int* g, int* b) {
+	union REGS regs;
+
+	// Huom.1: Vrit ovat rekistereiss muodossa GBR.
+	// Huom.2: Vrien _LUKEMISEEN_ kytetn rekisteri 1015h, keskeytyst 10h.
+	regs.w.ax = 0x1015;
+	regs.w.bx = (colorNumber < 16) ? dosDacIndex[colorNumber] : colorNumber;
+	int386(0x10, &regs, &regs);
+	*r = regs.h.dh;
+	*g = regs.h.ch;
+	*b = regs.h.cl;
+}
+
+static void dosSetBlinking(bool b) {
+	int a;
+
+	union REGS regs;
+
+	if (b) { a = 0x01; }
+	else { a = 0x00; }
+
+	regs.w.ax = 0x1003;
+	regs.h.bl = a;
+	int386(0x10, &regs, &regs);
+}
+
+/**
+ * Katso: https://wiki.osdev.org/Text_Mode_Cursor
+ */
+static void dosShowCursor(bool b) {
+	union REGS regs;
+
+	regs.h.ah = 0x01;
+
+	if (b) {
+		regs.h.ch = 14;
+		regs.h.cl = 15;
+		int386(0x10, &regs, &regs);
+	}
+
+	else {
+		regs.h.ch = 0x3f;
+		int386(0x10, &regs, &regs);
+	}
+}
+
+/**
+ * Fonttien muokkaus: merkit kirjoitetaan suoraan VGA:n fonttimuistiin
+ * (taso 2), jossa kullakin merkill on 32 tavun paikka. BIOSin INT 10h
+ * AX=1100h vaatisi fontin perusmuistiin ja reaalimoodin osoitteen ES:BP:hen
+ * DPMI:n kautta; suoraan kirjoittamalla koko merkkijoukko siirtyy yhdell
+ * kertaa ilman keskeytyksi.
+ * http://www.techhelpmanual.com/152-int_10h_1100h__load_user_defined_font.html
+ * https://wiki.osdev.org/VGA_Fonts
+ */
+#define VGA_FONT_MEMORY ((char*)0xa0000)
+#define VGA_FONT_SLOT 32
+#define VGA_SEQUENCER 0x3c4
+#define VGA_GRAPHICS 0x3ce
+
+static void dosLoadFont(int first, int count, char* fontData) {
+	char* dst;
+	int i;
+
+	if (first < 0 || count <= 0 || first + count > 256) {
+		return;
+	}
+
+	// Taso 2 perkkisen osoitteeseen A0000h. Rekisterin numero alatavussa.
+	_disable();
+	outpw(VGA_SEQUENCER, 0x0100);	// synkroninen nollaus
+	outpw(VGA_SEQUENCER, 0x0402);	// kirjoitus vain tasoon 2
+	outpw(VGA_SEQUENCER, 0x0704);	// ei odd/even-osoitusta
+	outpw(VGA_SEQUENCER, 0x0300);
+	outpw(VGA_GRAPHICS, 0x0204);	// luku tasosta 2
+	outpw(VGA_GRAPHICS, 0x0005);	// ei odd/even-osoitusta
+	outpw(VGA_GRAPHICS, 0x0406);	// A0000h-AFFFFh
+	_enable();
+
+	dst = VGA_FONT_MEMORY + first * VGA_FONT_SLOT;
+	for (i = 0; i < count; i++) {
+		memcpy(dst, fontData, 16);
+		dst += VGA_FONT_SLOT;
+		fontData += 16;
+	}
+
+	// Tekstimoodin asetukset takaisin (tasot 0 ja 1, B8000h).
+	_disable();
+	outpw(VGA_SEQUENCER, 0x0100);
+	outpw(VGA_SEQUENCER, 0x0302);
+	outpw(VGA_SEQUENCER, 0x0304);
+	outpw(VGA_SEQUENCER, 0x0300);
+	outpw(VGA_GRAPHICS, 0x0004);
+	outpw(VGA_GRAPHICS, 0x1005);
+	outpw(VGA_GRAPHICS, 0x0e06);
+	_enable();
+}
+
+/**
+ * Merkkisolun leveys: 9 pikselin soluissa (oletus) merkkien vliss on tyhj
+ * sarake (paitsi merkeill C0h-DFh), 8 pikselin soluissa ei. Leveys
+ * vaihdetaan sekvensserin kellotilarekisterin bitill 0; samalla vaihdetaan
+ * pikselikello (28 / 25 MHz), jotta virkistystaajuus pysyy ennallaan, ja
+ * vaakasiirto (attribuuttiohjaimen rekisteri 13h).
+ * https://wiki.osdev.org/VGA_Hardware
+ */
+static void dosSetCharWidth(int width) {
+	int misc, clocking;
+
+	misc = inp(0x3cc) & ~0x0c;
+	outp(VGA_SEQUENCER, 0x01);
+	clocking = inp(VGA_SEQUENCER + 1) & ~0x01;
+	if (width == 8) {
+		clocking |= 0x01;
+	}
+	else {
+		misc |= 0x04;
+	}
+
+	_disable();
+	outpw(VGA_SEQUENCER, 0x0100);
+	outp(0x3c2, misc);
+	outpw(VGA_SEQUENCER, (clocking << 8) | 0x01);
+	outpw(VGA_SEQUENCER, 0x0300);
+
+	// Attribuuttiohjaimen osoite/data-vuorottelu nollataan lukemalla 3DAh;
+	// indeksin bitti 5 pit nytn pll.
+	inp(VGA_STATUS);
+	outp(0x3c0, 0x13 | 0x20);
+	outp(0x3c0, (width == 8) ? 0 : 8);
+	_enable();
+}
+
+const VideoBackend dosVideoBackend = {
+	(char*)SCREEN_LIN_ADDR,
+	dosSetMode,
+	dosSetColor,
+	dosGetColor,
+	dosSetBlinking,
+	dosShowCursor,
+	dosLoadFont,
+	dosSetCharWidth,
+	dosSetColors,
+	dosWaitRetrace
+};
+
+#endif
@@ -0,0 +1,105 @@
+/**
+ * Emuloitu 80x25 tekstinytt: nyttmuisti, 16-vrinen DAC, fonttimuisti
+ * sek kursorin ja vilkkumisen tila muistissa. Ks. video.h.
+ */
+
+#include "video.h"
+
+EmuVideoDevice emuVideo;
+
+/**
+ * VGA:n oletuspaletti (komponentit 0-63).
+ */
+static const unsigned char emuDefaultDac[16][3] = {
+	{ 0, 0, 0 }, { 0, 0, 42 }, { 0, 42, 0 }, { 0, 42, 42 },
+	{ 42, 0, 0 }, { 42, 0, 42 }, { 42, 21, 0 }, { 42, 42, 42 },
+	{ 21, 21, 21 }, { 21, 21, 63 }, { 21, 63, 21 }, { 21, 63, 63 },
+	{ 63, 21, 21 }, { 63, 21, 63 }, { 63, 63, 21 }, { 63, 63, 63 }
+};
+
+/**
+ * Kuten BIOSin moodi 03h: tyhj ruutu (vlilynti, vri 7), oletuspaletti,
+ * vilkkuminen pll ja kursori nkyviss. Fonttimuisti tyhjennetn, koska
+ * ROM-fonttia ei emuloida.
+ */
+static void emuSetMode(void) {
+	int i;
+
+	for (i = 0; i < ROWS * COLS * 2; i += 2) {
+		emuVideo.memory[i] = ' ';
+		emuVideo.memory[i + 1] = 7;
+	}
+	memcpy(emuVideo.dac, emuDefaultDac, sizeof(emuVideo.dac));
+	memset(emuVideo.font, 0, sizeof(emuVideo.font));
+	emuVideo.blinking = true;
+	emuVideo.cursorVisible = true;
+	emuVideo.cursorStart = 14;
+	emuVideo.cursorEnd = 15;
+	emuVideo.charWidth = 9;
+}
+
+static void emuSetColor(int colorNumber, int r, int g, int b) {
+	if (colorNumber < 0 || colorNumber > 15) {
+		return;
+	}
+	emuVideo.dac[colorNumber][0] = r & 63;
+	emuVideo.dac[colorNumber][1] = g & 63;
+	emuVideo.dac[colorNumber][2] = b & 63;
+}
+
+static void emuSetColors(int first, int count, const unsigned char* rgb) {
+	int i;
+
+	if (first < 0 || count <= 0 || first + count > 16) {
+		return;
+	}
+	for (i = 0; i < count * 3; i++) {
+		((unsigned char*)emuVideo.dac + first * 3)[i] = rgb[i] & 63;
+	}
+}
+
+static void emuGetColor(int colorNumber, int* r, int* g, int* b) {
+	if (colorNumber < 0 || colorNumber > 15) {
+		*r = *g = *b = 0;
+		return;
+	}
+	*r = emuVideo.dac[colorNumber][0];
+	*g = emuVideo.dac[colorNumber][1];
+	*b = emuVideo.dac[colorNumber][2];
+}
+
+static void emuSetBlinking(bool b) {
+	emuVideo.blinking = b;
+}
+
+static void emuShowCursor(bool b) {
+	emuVideo.cursorVisible = b;
+}
+
+static void emuLoadFont(int first, int count, char* fontData) {
+	if (first < 0 || count <= 0 || first + count > 256) {
+		return;
+	}
+	memcpy(emuVideo.font[first], fontData, count * 16);
+}
+
+static void emuSetCharWidth(int width) {
+	emuVideo.charWidth = (width == 8) ? 8 : 9;
+}
+
+static void emuWaitRetrace(void) {
+	emuVideo.retraces++;
+}
+
+const VideoBackend emuVideoBackend = {
+	emuVideo.memory,
+	emuSetMode,
+	emuSetColor,
+	emuGetColor,
+	emuSetBlinking,
+	emuShowCursor,
+	emuLoadFont,
+	emuSetCharWidth,
+	emuSetColors,
+	emuWaitRetrace
+};